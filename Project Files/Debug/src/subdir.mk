@@ -6,40 +6,73 @@
 C_SRCS += \
 ../src/ADC.c \
 ../src/RTC.c \
+../src/crc.c \
+../src/event.c \
+../src/flash.c \
+../src/flashlog.c \
+../src/frame.c \
 ../src/gpio.c \
 ../src/keypad.c \
 ../src/lcd.c \
 ../src/main.c \
+../src/manchester.c \
+../src/nic.c \
+../src/pbuf.c \
 ../src/piezo.c \
+../src/prof.c \
 ../src/ringbuffer.c \
 ../src/syscalls.c \
 ../src/timer.c \
+../src/traffic.c \
+../src/tripwire.c \
 ../src/uart_driver.c 
 
 OBJS += \
 ./src/ADC.o \
 ./src/RTC.o \
+./src/crc.o \
+./src/event.o \
+./src/flash.o \
+./src/flashlog.o \
+./src/frame.o \
 ./src/gpio.o \
 ./src/keypad.o \
 ./src/lcd.o \
 ./src/main.o \
+./src/manchester.o \
+./src/nic.o \
+./src/pbuf.o \
 ./src/piezo.o \
+./src/prof.o \
 ./src/ringbuffer.o \
 ./src/syscalls.o \
 ./src/timer.o \
+./src/traffic.o \
+./src/tripwire.o \
 ./src/uart_driver.o 
 
 C_DEPS += \
 ./src/ADC.d \
 ./src/RTC.d \
+./src/crc.d \
+./src/event.d \
+./src/flash.d \
+./src/flashlog.d \
+./src/frame.d \
 ./src/gpio.d \
 ./src/keypad.d \
 ./src/lcd.d \
 ./src/main.d \
+./src/manchester.d \
+./src/nic.d \
+./src/pbuf.d \
 ./src/piezo.d \
+./src/prof.d \
 ./src/ringbuffer.d \
 ./src/syscalls.d \
 ./src/timer.d \
+./src/traffic.d \
+./src/tripwire.d \
 ./src/uart_driver.d 
 
 
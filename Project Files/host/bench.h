@@ -0,0 +1,39 @@
+/*
+ * bench.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Timing for the host benchmarks. Host nanoseconds and cycles only
+ * compare two versions of the same code, they are not target cycles.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Returns a monotonic time in nanoseconds
+ */
+static inline uint64_t bench_now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Returns the host's cycle counter, the time stamp counter on x86 and
+ * 0 elsewhere. It runs at a fixed rate near the nominal clock.
+ */
+static inline uint64_t bench_cycles(){
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
+
+#endif /* BENCH_H */
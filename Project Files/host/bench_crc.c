@@ -0,0 +1,114 @@
+/*
+ * bench_crc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Compares crc16, one table lookup per byte, with the bitwise loop and
+ * with slice-by-4 over 4 tables, for a short frame, a typical one and
+ * the longest. All three must give the standard check value and agree
+ * on every block.
+ */
+
+#include "bench.h"
+#include "crc.h"
+#include "frame.h"
+#include <string.h>
+
+#define BYTES_PER_SIZE 8000000u
+#define CHECK_VALUE 0x29B1		//CRC-16/CCITT-FALSE of "123456789"
+
+static uint16_t slice_tables[4][256];
+static uint8_t data[FRAME_MAX_SIZE];
+static volatile uint16_t sink;
+
+static uint16_t crc16_bitwise(const uint8_t* p, uint32_t length, uint16_t crc){
+	while(length--){
+		crc ^= (uint16_t)*p++ << 8;
+		for(uint32_t i=0;i<8;i++){
+			crc = (crc & 0x8000) ? (uint16_t)((crc<<1) ^ CRC16_POLY) : (uint16_t)(crc<<1);
+		}
+	}
+	return crc;
+}
+
+//slice_tables[k][b] is the CRC of byte b followed by k zero bytes
+static void slice_init(){
+	for(uint32_t b=0;b<256;b++){
+		slice_tables[0][b] = crc16_table[b];
+	}
+	for(uint32_t k=1;k<4;k++){
+		for(uint32_t b=0;b<256;b++){
+			uint16_t prev = slice_tables[k-1][b];
+			slice_tables[k][b] = (uint16_t)(prev<<8) ^ crc16_table[prev>>8];
+		}
+	}
+}
+
+static uint16_t crc16_slice4(const uint8_t* p, uint32_t length, uint16_t crc){
+	while(length >= 4){
+		crc = slice_tables[3][(crc>>8) ^ p[0]] ^ slice_tables[2][(crc & 0xFF) ^ p[1]]
+				^ slice_tables[1][p[2]] ^ slice_tables[0][p[3]];
+		p += 4;
+		length -= 4;
+	}
+	return crc16(p, length, crc);
+}
+
+typedef uint16_t (*crc_function)(const uint8_t*, uint32_t, uint16_t);
+
+static double ns_per_byte(crc_function f, uint32_t size){
+	uint32_t rounds = BYTES_PER_SIZE/size;
+	uint16_t crc = 0;
+	uint64_t start = bench_now_ns();
+	for(uint32_t r=0;r<rounds;r++){
+		data[0] = r;
+		crc ^= f(data, size, CRC16_INIT);
+	}
+	uint64_t elapsed = bench_now_ns() - start;
+	sink = crc;
+	return (double)elapsed/((uint64_t)rounds*size);
+}
+
+int main(){
+	static const uint32_t sizes[] = {FRAME_HEADER_SIZE+FRAME_CRC_SIZE+2, 64, FRAME_MAX_SIZE};
+	static const crc_function functions[] = {crc16_bitwise, crc16, crc16_slice4};
+	static const char* const names[] = {"bitwise", "table", "slice-by-4"};
+
+	slice_init();
+	uint32_t seed = 1;
+	for(uint32_t i=0;i<sizeof(data);i++){
+		seed = seed*1103515245 + 12345;
+		data[i] = seed>>16;
+	}
+
+	//all three agree before anything is timed
+	for(uint32_t f=0;f<3;f++){
+		if(functions[f]((const uint8_t*)"123456789", 9, CRC16_INIT) != CHECK_VALUE){
+			printf("bench_crc: %s misses the check value\n", names[f]);
+			return 1;
+		}
+		for(uint32_t n=0;n<=sizeof(data);n++){
+			if(functions[f](data, n, CRC16_INIT) != crc16_bitwise(data, n, CRC16_INIT)){
+				printf("bench_crc: %s differs at %u bytes\n", names[f], n);
+				return 1;
+			}
+		}
+	}
+
+	printf("bench_crc: ns per byte, table sizes 0, %u and %u bytes\n",
+			(uint32_t)sizeof(crc16_table), (uint32_t)sizeof(slice_tables));
+	printf("bytes ");
+	for(uint32_t f=0;f<3;f++){
+		printf(" %10s", names[f]);
+	}
+	printf("\n");
+	for(uint32_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++){
+		printf("%5u ", sizes[s]);
+		for(uint32_t f=0;f<3;f++){
+			printf(" %10.2f", ns_per_byte(functions[f], sizes[s]));
+		}
+		printf("\n");
+	}
+	return 0;
+}
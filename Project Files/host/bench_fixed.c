@@ -0,0 +1,119 @@
+/*
+ * bench_fixed.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Compares the float conversions of the baseline ADC.c with the integer
+ * ones in fixed.h over blocks of samples: counts to mV, a threshold test
+ * on every sample and counts to tenths of a degree F. The host has a
+ * double precision FPU, so the float kernels cost far less here than
+ * the soft float calls they need on the M4; a single precision version
+ * of the mV conversion shows the best the M4 FPU could do.
+ */
+
+#include "bench.h"
+#include "fixed.h"
+
+#define SAMPLES 4096
+#define ROUNDS 2000
+#define THRESHOLD_MV 250
+
+static uint16_t samples[SAMPLES];
+static volatile uint32_t sink;
+
+static uint32_t mv_double(const uint16_t* s, uint32_t n){
+	double sum = 0;
+	for(uint32_t i=0;i<n;i++){
+		sum += ((s[i]*3.3)/4095)*1000;
+	}
+	return (uint32_t)sum;
+}
+
+static uint32_t mv_single(const uint16_t* s, uint32_t n){
+	float sum = 0;
+	for(uint32_t i=0;i<n;i++){
+		sum += ((s[i]*3.3f)/4095)*1000;
+	}
+	return (uint32_t)sum;
+}
+
+static uint32_t mv_fixed(const uint16_t* s, uint32_t n){
+	uint32_t sum = 0;
+	for(uint32_t i=0;i<n;i++){
+		sum += counts_to_mv(s[i]);
+	}
+	return sum;
+}
+
+static uint32_t over_double(const uint16_t* s, uint32_t n){
+	uint32_t count = 0;
+	for(uint32_t i=0;i<n;i++){
+		count += ((s[i]*3.3)/4095)*1000 >= THRESHOLD_MV;
+	}
+	return count;
+}
+
+static uint32_t over_raw(const uint16_t* s, uint32_t n){
+	const uint32_t threshold = MV_TO_COUNTS(THRESHOLD_MV);
+	uint32_t count = 0;
+	for(uint32_t i=0;i<n;i++){
+		count += s[i] >= threshold;
+	}
+	return count;
+}
+
+static uint32_t deci_f_double(const uint16_t* s, uint32_t n){
+	double sum = 0;
+	for(uint32_t i=0;i<n;i++){
+		double mv = ((s[i]*3.3)/4095)*1000;
+		sum += ((25+((mv-750)/10))*1.8+32)*10;
+	}
+	return (uint32_t)sum;
+}
+
+static uint32_t deci_f_fixed(const uint16_t* s, uint32_t n){
+	int32_t sum = 0;
+	for(uint32_t i=0;i<n;i++){
+		sum += mv_to_deci_f(counts_to_mv(s[i]));
+	}
+	return (uint32_t)sum;
+}
+
+typedef uint32_t (*kernel)(const uint16_t*, uint32_t);
+
+static double ns_per_sample(kernel k){
+	uint32_t result = 0;
+	uint64_t start = bench_now_ns();
+	for(uint32_t r=0;r<ROUNDS;r++){
+		samples[r % SAMPLES] ^= 1;		//keeps the rounds from being folded together
+		result += k(samples, SAMPLES);
+	}
+	uint64_t elapsed = bench_now_ns() - start;
+	sink = result;
+	return (double)elapsed/((uint64_t)ROUNDS*SAMPLES);
+}
+
+int main(){
+	static const kernel kernels[] = {mv_double, mv_single, mv_fixed, over_double, over_raw, deci_f_double, deci_f_fixed};
+	static const char* const names[] = {"mV double", "mV single", "mV fixed", "threshold double", "threshold raw",
+			"deci F double", "deci F fixed"};
+
+	uint32_t seed = 1;
+	for(uint32_t i=0;i<SAMPLES;i++){
+		seed = seed*1103515245 + 12345;
+		samples[i] = (seed>>16) % (ADC_FULL_SCALE+1);
+	}
+
+	//the threshold kernels count the same samples before anything is timed
+	if(over_double(samples, SAMPLES) != over_raw(samples, SAMPLES)){
+		printf("bench_fixed: the threshold kernels disagree\n");
+		return 1;
+	}
+
+	printf("bench_fixed: ns per sample over %u random counts\n", SAMPLES);
+	for(uint32_t k=0;k<sizeof(kernels)/sizeof(kernels[0]);k++){
+		printf("%-17s %6.2f\n", names[k], ns_per_sample(kernels[k]));
+	}
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * bench_gpio.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Compares the per pin GPIO code the LCD and keypad drivers used with
+ * the PinGroup functions that replaced it, for the LCD and keypad pins:
+ *
+ * 		LCD modes - ports B 0-2 and C 8-11 to output, 7 set_pin_mode calls
+ * 		LCD byte - RS and RW, then each nibble and an E pulse, ODR updated
+ * 			by read-modify-write
+ * 		keypad modes - rows to output and columns to input, 8 calls
+ *
+ * The old set_pin_mode is copied here from the baseline gpio.c, port
+ * switch and two read-modify-writes of MODER per pin, and both versions
+ * run on ports in RAM. The register images must match before anything
+ * is timed. BSRR is plain memory here and keeps only the last write, so
+ * the LCD byte is checked by the data pins it leaves and its final E
+ * write.
+ */
+
+#include "bench.h"
+#include "gpio.h"
+#include "lcd.h"
+#include "keypad.h"
+
+#define ROUNDS 10000000u
+
+static volatile GPIOx port_b;
+static volatile GPIOx port_c;
+
+#define B(mask) PIN_GROUP(&port_b, (mask))
+#define C(mask) PIN_GROUP(&port_c, (mask))
+
+static volatile GPIOx* old_port(char port){
+	switch(port){
+		case 'B':
+		case 'b':
+			return &port_b;
+		case 'C':
+		case 'c':
+			return &port_c;
+	}
+	return NULL;
+}
+
+//the baseline set_pin_mode
+static void __attribute__((noinline)) old_set_pin_mode(char port, uint8_t pin, Mode mode){
+	if(pin <= 15){
+		volatile GPIOx* portX = old_port(port);
+		if(!portX) return;
+		portX->MODER &= ~(0b11<<(pin*2));
+		switch(mode){
+			case INPUT:
+				portX->MODER |= (0b00<<(pin*2));
+				break;
+			case OUTPUT:
+				portX->MODER |= (0b01<<(pin*2));
+				break;
+			case ALTFUNC:
+				portX->MODER |= (0b10<<(pin*2));
+				break;
+			case ANALOG:
+				portX->MODER |= (0b11<<(pin*2));
+				break;
+			default:
+				return;
+		}
+	}
+}
+
+static void old_lcd_modes(uint32_t r){
+	for(int i=0;i<=2;i++){
+		old_set_pin_mode('B',i,OUTPUT);
+	}
+	for(int i=8;i<=11;i++){
+		old_set_pin_mode('C',i,OUTPUT);
+	}
+}
+
+static void new_lcd_modes(uint32_t r){
+	gpio_group_mode(B(LCD_CTRL_PINS.mask), OUTPUT);
+	gpio_group_mode(C(LCD_DATA_PINS.mask), OUTPUT);
+}
+
+static void old_lcd_byte(uint32_t value){
+	port_b.ODR &= ~(0b11);
+	port_b.ODR |= (1<<LCD_RS_F);
+	port_c.ODR &= ~(0b1111 << LCD_DATA_OFFSET);
+	port_c.ODR |= ((value>>4 & 0xF) << LCD_DATA_OFFSET);
+	port_b.ODR |= (1<<LCD_E_F);
+	port_b.ODR &= ~(1<<LCD_E_F);
+	port_c.ODR &= ~(0b1111 << LCD_DATA_OFFSET);
+	port_c.ODR |= ((value & 0xF) << LCD_DATA_OFFSET);
+	port_b.ODR |= (1<<LCD_E_F);
+	port_b.ODR &= ~(1<<LCD_E_F);
+}
+
+static void new_lcd_byte(uint32_t value){
+	gpio_group_write(B(LCD_RS_RW_PINS.mask), 1<<LCD_RS_F);
+	gpio_group_write(C(LCD_DATA_PINS.mask), (value>>4 & 0xF)<<LCD_DATA_OFFSET);
+	gpio_group_set(B(LCD_E_PIN.mask));
+	gpio_group_clear(B(LCD_E_PIN.mask));
+	gpio_group_write(C(LCD_DATA_PINS.mask), (value & 0xF)<<LCD_DATA_OFFSET);
+	gpio_group_set(B(LCD_E_PIN.mask));
+	gpio_group_clear(B(LCD_E_PIN.mask));
+}
+
+static void old_key_modes(uint32_t r){
+	for(int i=4;i<=7;i++){
+		old_set_pin_mode('C',i,OUTPUT);
+	}
+	for(int i=0;i<=3;i++){
+		old_set_pin_mode('C',i,INPUT);
+	}
+}
+
+static void new_key_modes(uint32_t r){
+	gpio_group_modes(C(KEY_PINS.mask), gpio_mode_image(KEY_ROW_PINS.mask, OUTPUT));
+}
+
+typedef void (*operation)(uint32_t);
+
+static void reset_ports(){
+	port_b.MODER = port_c.MODER = 0xA5A5A5A5;
+	port_b.ODR = port_c.ODR = 0x5A5A;
+	port_b.BSSR = port_c.BSSR = 0;
+}
+
+//ODR after the last BSRR write, set wins over reset
+static uint32_t odr_after(volatile GPIOx* port){
+	uint32_t bsrr = port->BSSR;
+	return ((port->ODR & ~(bsrr>>16)) | bsrr) & 0xFFFF;
+}
+
+static double ns_per_call(operation op){
+	uint64_t start = bench_now_ns();
+	for(uint32_t r=0;r<ROUNDS;r++){
+		op(r);
+	}
+	return (double)(bench_now_ns() - start)/ROUNDS;
+}
+
+int main(){
+	static const operation old_ops[] = {old_lcd_modes, old_lcd_byte, old_key_modes};
+	static const operation new_ops[] = {new_lcd_modes, new_lcd_byte, new_key_modes};
+	static const char* const names[] = {"LCD modes", "LCD byte", "keypad modes"};
+
+	for(uint32_t o=0;o<3;o++){
+		reset_ports();
+		old_ops[o](0x6C);
+		uint32_t old_b = port_b.MODER, old_c = port_c.MODER;
+		reset_ports();
+		new_ops[o](0x6C);
+		if(port_b.MODER != old_b || port_c.MODER != old_c){
+			printf("bench_gpio: %s modes differ\n", names[o]);
+			return 1;
+		}
+	}
+
+	//the low nibble is left on the data pins and the last write drops E
+	reset_ports();
+	old_lcd_byte(0x6C);
+	uint32_t old_c = port_c.ODR;
+	reset_ports();
+	new_lcd_byte(0x6C);
+	if(odr_after(&port_c) != old_c || port_b.BSSR != (1u<<LCD_E_F)<<16){
+		printf("bench_gpio: LCD byte outputs differ\n");
+		return 1;
+	}
+
+	printf("bench_gpio: ns per call\n");
+	printf("operation       per pin  group\n");
+	for(uint32_t o=0;o<3;o++){
+		printf("%-13s %8.2f %6.2f\n", names[o], ns_per_call(old_ops[o]), ns_per_call(new_ops[o]));
+	}
+	return 0;
+}
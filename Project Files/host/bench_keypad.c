@@ -0,0 +1,185 @@
+/*
+ * bench_keypad.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Compares the timer wheel keypad scan with the EXTI handler it
+ * replaced. The old handler ran once per press and made 24 set_pin_mode
+ * calls, each a port switch and two read-modify-writes of MODER. The
+ * scan runs every tick, so it is timed both idle and over a whole
+ * press and release, which spans the debounce of both edges.
+ *
+ * keypad.c is built into this file and driven by SysTick_Handler. A
+ * model of the matrix sets the column inputs in IDR for the row the
+ * scan drives, and the press must come out as one down and one up
+ * event before anything is timed.
+ */
+
+#include "bench.h"
+#include "mmio.h"
+#include "ringbuffer.h"
+#include "../src/keypad.c"
+
+#define ROUNDS 200000
+#define PRESSES 2000
+#define PRESS_MS 60
+#define RELEASE_MS 60
+#define TEST_KEY 6				//'5', row 1 column 1
+
+#define EXTI_IMR (volatile uint32_t*) 0x40013C00
+#define EXTI_PR (volatile uint32_t*) 0x40013C14
+
+extern void SysTick_Handler(void);
+
+static volatile RingBuffer oldRows, oldCols;
+static uint16_t held;			//keys down in the model, bit n is key n+1
+
+//the old gpio.c set_pin_mode, a port switch and a switch on the mode
+static void old_set_pin_mode(char port, uint8_t pin, Mode mode){
+	volatile GPIOx* portX;
+	switch(port){
+		case 'A': case 'a': portX = GPIO_PORT_A; break;
+		case 'B': case 'b': portX = GPIO_PORT_B; break;
+		case 'C': case 'c': portX = GPIO_PORT_C; break;
+		default: return;
+	}
+	portX->MODER &= ~(0b11<<(pin*2));
+	switch(mode){
+		case INPUT: portX->MODER |= (0b00<<(pin*2)); break;
+		case OUTPUT: portX->MODER |= (0b01<<(pin*2)); break;
+		case ALTFUNC: portX->MODER |= (0b10<<(pin*2)); break;
+		case ANALOG: portX->MODER |= (0b11<<(pin*2)); break;
+	}
+}
+
+//the body of the old EXTI0-3 handlers
+static void old_exti_handler(){
+	*(EXTI_PR) |= 0b1;
+	if(hasSpace(&oldCols) && hasSpace(&oldRows)){
+		*(EXTI_IMR) &= ~(0x0F);
+		for(int i=0;i<=3;i++){
+			old_set_pin_mode('C',i,INPUT);
+		}
+		put(&oldCols,GPIO_PORT_C->IDR & 0x0F);
+		for(int i=4;i<=7;i++){
+			old_set_pin_mode('C',i,INPUT);
+		}
+		for(int i=0;i<=3;i++){
+			old_set_pin_mode('C',i,OUTPUT);
+		}
+		put(&oldRows,(GPIO_PORT_C->IDR & 0xF0)>>4);
+		for(int i=4;i<=7;i++){
+			old_set_pin_mode('C',i,OUTPUT);
+		}
+		for(int i=0;i<=3;i++){
+			old_set_pin_mode('C',i,INPUT);
+		}
+		*(EXTI_IMR) |= 0x0F;
+	}
+}
+
+//columns of the driven row read low where a held key joins them
+static void matrix(){
+	uint32_t cols = 0xF;
+	for(uint32_t r=0;r<KEY_ROWS;r++){
+		uint32_t mode = (GPIO_PORT_C->MODER >> ((KEY_ROW_PIN+r)*2)) & 3;
+		if(mode == OUTPUT){
+			cols &= ~((held >> (r*KEY_COLS)) & 0xF);
+		}
+	}
+	GPIO_PORT_C->IDR = (GPIO_PORT_C->IDR & ~(0xFu<<KEY_COL_PIN)) | (cols<<KEY_COL_PIN);
+}
+
+static void tick(uint32_t ms){
+	for(uint32_t i=0;i<ms;i++){
+		matrix();
+		SysTick_Handler();
+	}
+}
+
+static void press(uint16_t keys, uint32_t down_ms, uint32_t up_ms){
+	held = keys;
+	tick(down_ms);
+	held = 0;
+	tick(up_ms);
+}
+
+static int check_events(){
+	KeyEvent e;
+	while(key_next(&e)){}
+
+	press(1<<(TEST_KEY-1), PRESS_MS, RELEASE_MS);
+	int ok = key_next(&e) && e.key == TEST_KEY && e.action == KEY_DOWN
+			&& key_next(&e) && e.key == TEST_KEY && e.action == KEY_UP
+			&& !key_next(&e);
+	if(!ok){
+		printf("bench_keypad: the matrix model did not give one press of key %u\n", TEST_KEY);
+	}
+	return ok;
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("bench_keypad: cannot map the register file\n");
+		return 1;
+	}
+	timer_init();
+	key_init();
+	if(!check_events()){
+		return 1;
+	}
+
+	uint64_t start = bench_now_ns();
+	for(uint32_t i=0;i<ROUNDS;i++){
+		old_exti_handler();
+		oldRows.get = oldRows.put;
+		oldCols.get = oldCols.put;
+	}
+	double oldNs = (double)(bench_now_ns() - start)/ROUNDS;
+
+	start = bench_now_ns();
+	for(uint32_t i=0;i<ROUNDS;i++){
+		scan(0);
+	}
+	double idleNs = (double)(bench_now_ns() - start)/ROUNDS;
+
+	//presses and releases, the matrix model and the reader are timed separately
+	KeyEvent e;
+	uint32_t events = 0;
+	uint32_t ticks = (PRESS_MS + RELEASE_MS)*PRESSES;
+	start = bench_now_ns();
+	for(uint32_t i=0;i<ticks;i++){
+		uint32_t phase = i % (PRESS_MS+RELEASE_MS);
+		if(phase == 0){
+			held = 1<<(TEST_KEY-1);
+			while(key_next(&e)){
+				events++;
+			}
+		}else if(phase == PRESS_MS){
+			held = 0;
+		}
+		matrix();
+		scan(0);
+	}
+	uint64_t scanNs = bench_now_ns() - start;
+	while(key_next(&e)){
+		events++;
+	}
+	start = bench_now_ns();
+	for(uint32_t i=0;i<ticks;i++){
+		if(i % (PRESS_MS+RELEASE_MS) == 0){
+			key_next(&e);
+		}
+		matrix();
+	}
+	scanNs -= bench_now_ns() - start;
+
+	printf("bench_keypad: host ns\n");
+	printf("old EXTI handler        %7.1f ns per press, 48 MODER read-modify-writes\n", oldNs);
+	printf("scan, no key changing   %7.1f ns per tick, 1 MODER write\n", idleNs);
+	printf("scan, press and release %7.1f ns per tick, %.0f ns over the %u ms of a press\n",
+			(double)scanNs/ticks, (double)scanNs/PRESSES, PRESS_MS+RELEASE_MS);
+	printf("%u presses gave %u events, %u dropped\n", PRESSES, events, key_dropped());
+	return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * bench_lcd.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Compares the framebuffer LCD with the blocking driver it replaced on
+ * two redraws: the clock ticking over a second, and a whole new screen.
+ * The old driver sent every character at once, waited 85 us after each
+ * byte and moved the cursor with one shift command per column. The
+ * framebuffer only sends changed cells, one bus write per refresh tick.
+ *
+ * lcd.c is built into this file and lcd_pump is called directly in
+ * place of the refresh timer. A pump call made a bus write if it wrote
+ * BSRR. The bus delays are real delay_us calls on the host clock, so
+ * the microseconds below are close to the target's. The busy flag reads
+ * ready at once, which favours the old driver.
+ */
+
+#include "bench.h"
+#include "mmio.h"
+#include "../src/lcd.c"
+
+#define ROUNDS 20
+
+typedef struct{
+	uint32_t writes;
+	uint64_t ns;
+} Cost;
+
+static uint32_t old_writes;
+
+//the old driver, byte at a time with a fixed wait for the controller
+static void old_execute(uint8_t value, uint8_t rs){
+	gpio_group_write(LCD_RS_RW_PINS, rs ? (1<<LCD_RS_F) : 0);
+	data_pins_output();
+	set_upper_nibble(value);
+	latch();
+	set_lower_nibble(value);
+	latch();
+	gpio_group_write(LCD_RS_RW_PINS, 1<<LCD_RW_F);
+	gpio_group_mode(LCD_BUSY_PIN, INPUT);
+	delay_us(85);
+	gpio_group_set(LCD_E_PIN);
+	delay_us(1);
+	gpio_group_clear(LCD_E_PIN);
+	delay_us(1);
+	latch();
+	old_writes++;
+}
+
+static void old_set_position(uint8_t row, uint8_t col){
+	old_execute(0x02, 0);		//home
+	for(uint32_t i=0;i<(uint32_t)(row*40)+col;i++){
+		old_execute(0x14, 0);	//cursor right
+	}
+}
+
+static void old_print(uint8_t row, const char* text){
+	old_set_position(row, 0);
+	while(*text){
+		old_execute(*text++, 1);
+	}
+}
+
+//runs the refresh engine until the display matches the framebuffer
+static Cost drain(){
+	Cost cost = {0, 0};
+	for(;;){
+		GPIO_PORT_B->BSSR = 0;
+		uint64_t start = bench_now_ns();
+		lcd_pump();
+		uint64_t elapsed = bench_now_ns() - start;
+		if(GPIO_PORT_B->BSSR == 0){
+			return cost;
+		}
+		cost.writes++;
+		cost.ns += elapsed;
+	}
+}
+
+static void format_time(char* text, uint32_t second){
+	sprintf(text, "10:%02u:%02u AM", (second/60)%60, second%60);
+}
+
+static void report(const char* name, uint64_t oldNs, uint32_t oldWrites,
+		uint64_t callerNs, Cost pump){
+	printf("%-12s old: %7.1f us blocked, %5.1f writes\n", name,
+			oldNs/1000.0/ROUNDS, (double)oldWrites/ROUNDS);
+	printf("%-12s new: %7.3f us in caller, %5.1f writes, %5.1f us per pump write,"
+			" %4.1f ms to show\n", "",
+			callerNs/1000.0/ROUNDS, (double)pump.writes/ROUNDS,
+			pump.writes ? pump.ns/1000.0/pump.writes : 0.0,
+			(double)pump.writes/ROUNDS*LCD_REFRESH_MS);
+}
+
+static void bench_clock(){
+	char text[16];
+	uint64_t oldNs = 0, callerNs = 0;
+	Cost pump = {0, 0};
+
+	lcd_fb_print(0, 0, "10:00:00 AM");
+	drain();
+	old_writes = 0;
+	for(uint32_t s=1;s<=ROUNDS;s++){
+		format_time(text, s);
+
+		uint64_t start = bench_now_ns();
+		old_print(0, text);
+		oldNs += bench_now_ns() - start;
+
+		start = bench_now_ns();
+		lcd_fb_print(0, 0, text);
+		callerNs += bench_now_ns() - start;
+		Cost c = drain();
+		pump.writes += c.writes;
+		pump.ns += c.ns;
+	}
+	report("clock tick", oldNs, old_writes, callerNs, pump);
+}
+
+static void bench_screen(){
+	static const char* const screens[][2] = {
+		{"Tot Cust: 1234", "Busiest Hr: 3PM"},
+		{"What should I do", "1 - Scan"},
+	};
+	uint64_t oldNs = 0, callerNs = 0;
+	Cost pump = {0, 0};
+
+	old_writes = 0;
+	for(uint32_t r=0;r<ROUNDS;r++){
+		const char* const* screen = screens[r & 1];
+
+		uint64_t start = bench_now_ns();
+		old_execute(0x01, 0);		//clear
+		old_print(0, screen[0]);
+		old_print(1, screen[1]);
+		oldNs += bench_now_ns() - start;
+
+		start = bench_now_ns();
+		lcd_reset();
+		lcd_print_string(screen[0]);
+		lcd_row1();
+		lcd_print_string(screen[1]);
+		callerNs += bench_now_ns() - start;
+		Cost c = drain();
+		pump.writes += c.writes;
+		pump.ns += c.ns;
+	}
+	report("new screen", oldNs, old_writes, callerNs, pump);
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("bench_lcd: cannot map the register file\n");
+		return 1;
+	}
+	timer_init();
+	lcd_init(C_OFF);
+
+	printf("bench_lcd: %u redraws each, averages per redraw\n", ROUNDS);
+	bench_clock();
+	bench_screen();
+	return 0;
+}
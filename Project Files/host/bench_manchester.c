@@ -0,0 +1,114 @@
+/*
+ * bench_manchester.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Feeds the decoder frames with increasing edge jitter from senders
+ * whose clocks are up to 3% off, and reports the frame and bit error
+ * rates and how fast the decoder gets through the edges. A frame that
+ * is rejected or decodes to the wrong length counts all of its bits as
+ * errors. Only decoding is timed, the edges are made beforehand.
+ */
+
+#include "bench.h"
+#include "manchester.h"
+#include "nic.h"
+#include "timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAMES 2000
+#define MAX_INTERVALS (2*8*(NIC_MAX_FRAME+1) + 2)
+
+typedef struct{
+	uint8_t data[NIC_MAX_FRAME];
+	uint16_t length;
+	uint32_t first;			//index of the first interval
+	uint32_t count;
+} Sample;
+
+static Sample frames[FRAMES];
+static uint16_t* intervals;
+static uint8_t received[FRAMES][NIC_MAX_FRAME];
+static int results[FRAMES];
+
+static uint32_t popcount8(uint8_t x){
+	return __builtin_popcount(x);
+}
+
+static void run(double jitter_bits){
+	static const double drift[] = {0.97, 1.0, 1.03};
+	double half_bit = SYSCLK_HZ/(2*NIC_DEFAULT_BITRATE);
+	uint32_t seed = 99;
+	uint32_t total = 0;
+
+	manchester_host_seed(7);
+	for(uint32_t f=0;f<FRAMES;f++){
+		Sample* fr = &frames[f];
+		seed ^= seed<<13; seed ^= seed>>17; seed ^= seed<<5;
+		fr->length = 1 + seed % NIC_MAX_FRAME;
+		for(uint32_t i=0;i<fr->length;i++){
+			fr->data[i] = seed>>(8*(i&3)) ^ i;
+		}
+		double sender = half_bit*drift[f % 3];
+		fr->first = total;
+		fr->count = manchester_host_line(fr->data, fr->length, sender, 2*sender*jitter_bits,
+				intervals+total, MAX_INTERVALS);
+		total += fr->count;
+	}
+
+	ManchesterDecoder dec;
+	uint64_t start = bench_now_ns();
+	for(uint32_t f=0;f<FRAMES;f++){
+		const uint16_t* edge = intervals + frames[f].first;
+		manchester_decoder_start(&dec, received[f], NIC_MAX_FRAME);
+		int result = 0;
+		for(uint32_t i=0;i<frames[f].count;i++){
+			if(manchester_decoder_edge(&dec, edge[i]) < 0){
+				result = -1;
+			}
+		}
+		results[f] = result < 0 ? -1 : manchester_decoder_idle(&dec);
+	}
+	uint64_t elapsed = bench_now_ns() - start;
+
+	uint32_t bad_frames = 0;
+	uint64_t bits = 0, bad_bits = 0;
+	for(uint32_t f=0;f<FRAMES;f++){
+		Sample* fr = &frames[f];
+		bits += fr->length*8;
+		if(results[f] != fr->length){
+			bad_frames++;
+			bad_bits += fr->length*8;
+			continue;
+		}
+		uint32_t wrong = 0;
+		for(uint32_t i=0;i<fr->length;i++){
+			wrong += popcount8(fr->data[i] ^ received[f][i]);
+		}
+		bad_frames += wrong != 0;
+		bad_bits += wrong;
+	}
+
+	printf("%6.1f%% %8.4f %10.2e %8.1f %9.1f\n", jitter_bits*100,
+			(double)bad_frames/FRAMES, (double)bad_bits/bits,
+			(double)elapsed/total, bits*1000.0/elapsed);
+}
+
+int main(){
+	static const double jitter[] = {0, 0.025, 0.05, 0.075, 0.1, 0.125, 0.15, 0.2, 0.25};
+	intervals = malloc(sizeof(uint16_t)*FRAMES*MAX_INTERVALS);
+	if(intervals == NULL){
+		return 1;
+	}
+
+	printf("bench_manchester: %u frames at %u bps, sender clock -3%%..+3%%\n",
+			FRAMES, NIC_DEFAULT_BITRATE);
+	printf("jitter      FER        BER  ns/edge  Mbit/s\n");
+	for(uint32_t i=0;i<sizeof(jitter)/sizeof(jitter[0]);i++){
+		run(jitter[i]);
+	}
+	free(intervals);
+	return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * bench_piezo.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Compares working out a note's timer period the old way, pow() from
+ * C4 and a double divide, with the note_periods lookup and with
+ * tone_period's integer divide. On the target the old path is soft
+ * float double code, so the gap there is wider than on the host.
+ */
+
+#include "bench.h"
+#include <math.h>
+#include "../src/piezo.c"
+
+#define ROUNDS 20000
+#define NOTES (PIEZO_OCTAVES*7*3)
+
+static Note notes[NOTES];
+static uint32_t tones[NOTES];
+static volatile uint32_t sink;
+
+//convert_note and tone_on before the table
+static uint32_t old_period(const Note *note){
+	double freq;
+	if(note->letter!=REST){
+		int octaveOffset = ((note->octave)-4);
+		int letterOffset = ((note->letter) - C);
+		double steps;
+		if(letterOffset<=2){
+			steps = ((letterOffset*2)+(12*octaveOffset))+(note->accidental);
+		}else{
+			steps = (((letterOffset*2)-1)+(12*octaveOffset))+(note->accidental);
+		}
+		freq = 261.63*pow((double)2,(steps/12));
+	}else{
+		freq = 0;
+	}
+	if(freq <= 0){
+		return 0;
+	}
+	return ((1/(freq))*(1000000));
+}
+
+static void report(const char* name, uint64_t elapsed){
+	printf("%-28s %7.1f ns/note\n", name, (double)elapsed/((uint64_t)ROUNDS*NOTES));
+}
+
+int main(){
+	uint32_t n = 0;
+	for(uint8_t octave=0;octave<PIEZO_OCTAVES;octave++){
+		for(Letter letter=C;letter<REST;letter++){
+			for(int accidental=FLAT;accidental<=SHARP;accidental++){
+				notes[n] = (Note){letter, accidental, octave, 100};
+				tones[n] = PIEZO_HZ(261.63*pow(2, (letter_semitones[letter]+accidental+12*(octave-4))/12.0));
+				n++;
+			}
+		}
+	}
+
+	printf("bench_piezo: %u notes, %u rounds\n", NOTES, ROUNDS);
+	uint32_t sum = 0;
+	uint64_t start = bench_now_ns();
+	for(uint32_t r=0;r<ROUNDS;r++){
+		for(uint32_t i=0;i<NOTES;i++){
+			sum += old_period(&notes[i]);
+		}
+	}
+	report("pow() and double divide", bench_now_ns() - start);
+
+	start = bench_now_ns();
+	for(uint32_t r=0;r<ROUNDS;r++){
+		for(uint32_t i=0;i<NOTES;i++){
+			sum += note_period(&notes[i]);
+		}
+	}
+	report("note_periods lookup", bench_now_ns() - start);
+
+	start = bench_now_ns();
+	for(uint32_t r=0;r<ROUNDS;r++){
+		for(uint32_t i=0;i<NOTES;i++){
+			sum += tone_period(tones[i]);
+		}
+	}
+	report("tone_period Q8 divide", bench_now_ns() - start);
+
+	sink = sum;
+	return 0;
+}
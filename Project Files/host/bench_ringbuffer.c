@@ -0,0 +1,81 @@
+/*
+ * bench_ringbuffer.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Compares moving bytes through a ring buffer one at a time with put and
+ * get against rb_put_n and rb_get_n, for several burst sizes. Each burst
+ * is written and then read back on one thread, so the figures are the
+ * cost of the calls and the copies without any waiting. The bytes read
+ * back are checked against those written before anything is timed.
+ */
+
+#include "bench.h"
+#include "ringbuffer.h"
+#include <string.h>
+
+#define BYTES 16000000u
+
+static RingBuffer rb;
+static uint8_t source[BUF_SIZE];
+static uint8_t dest[BUF_SIZE];
+static volatile uint32_t sink;
+
+static void single(uint32_t burst){
+	for(uint32_t i=0;i<burst;i++){
+		put(&rb, source[i]);
+	}
+	for(uint32_t i=0;i<burst;i++){
+		dest[i] = get(&rb);
+	}
+}
+
+static void bulk(uint32_t burst){
+	rb_put_n(&rb, source, burst);
+	rb_get_n(&rb, dest, burst);
+}
+
+typedef void (*transfer)(uint32_t);
+
+static double bytes_per_ns(transfer t, uint32_t burst){
+	uint32_t rounds = BYTES/burst;
+	uint64_t start = bench_now_ns();
+	for(uint32_t r=0;r<rounds;r++){
+		t(burst);
+		source[r & RB_MASK]++;
+	}
+	uint64_t elapsed = bench_now_ns() - start;
+	sink = dest[0];
+	return (double)rounds*burst/elapsed;
+}
+
+int main(){
+	static const uint32_t bursts[] = {1, 4, 16, BUF_SIZE/2, BUF_SIZE};
+	static const transfer transfers[] = {single, bulk};
+
+	//every burst size at every start position comes back intact
+	for(uint32_t t=0;t<2;t++){
+		for(uint32_t burst=1;burst<=BUF_SIZE;burst++){
+			for(uint32_t i=0;i<BUF_SIZE;i++){
+				source[i] = i*burst + t;
+			}
+			for(uint32_t offset=0;offset<BUF_SIZE;offset++){
+				transfers[t](burst);
+				if(memcmp(source, dest, burst) != 0 || rb_count(&rb) != 0){
+					printf("bench_ringbuffer: %s burst of %u differs\n", t ? "bulk" : "single", burst);
+					return 1;
+				}
+				put(&rb, 0);
+				get(&rb);
+			}
+		}
+	}
+
+	printf("bench_ringbuffer: bytes per ns, %u byte buffer\n", BUF_SIZE);
+	printf("burst    put/get  put_n/get_n\n");
+	for(uint32_t b=0;b<sizeof(bursts)/sizeof(bursts[0]);b++){
+		printf("%5u %10.3f %12.3f\n", bursts[b], bytes_per_ns(single, bursts[b]), bytes_per_ns(bulk, bursts[b]));
+	}
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * bench_tripwire.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Runs blocks of generated beam waveforms through tripwire_process for
+ * 1 to 16 lanes, laid out as the ADC scan writes them. Each lane sits
+ * at its lit level with noise, is broken by a walker about once a
+ * second and sees short dips across the thresholds that are shorter
+ * than the dwell. The event log is emptied between passes, outside the
+ * timing, as the main loop does.
+ *
+ * Lanes per MHz is how many lanes one MHz of core clock keeps up with
+ * at ADC_SAMPLE_HZ, from the host cycles per lane sample. The M4 takes
+ * more cycles than the host for the same code, so the target figure is
+ * lower; the PROBE_ADC_ISR probe gives it. The ADC itself can only
+ * convert as many lanes as fit in a sample period.
+ */
+
+#include "bench.h"
+#include "tripwire.h"
+#include "ADC.h"
+#include "timer.h"
+
+#define MAX_LANES 16
+#define BLOCKS 256				//per pass, 1.6 s of samples
+#define PASSES 20
+#define LIT 3000
+#define DARK 150
+#define NOISE 60				//counts either way
+#define WALK_FRAMES 2500		//a walker breaks the beam for 250 ms
+#define DIP_FRAMES 1			//shorter than the dwell
+#define ADC_CONVERSION_NS 8500	//56 cycle sample time, see ADC.h
+
+static uint16_t samples[BLOCKS*ADC_BLOCK*MAX_LANES];
+static uint32_t seed = 2017;
+
+static uint32_t next_random(){
+	seed ^= seed<<13;
+	seed ^= seed>>17;
+	seed ^= seed<<5;
+	return seed;
+}
+
+//the level lane sees at frame i of a pass
+static uint16_t level(uint32_t lane, uint32_t i){
+	uint32_t frames = BLOCKS*ADC_BLOCK;
+	uint32_t walk_start = (lane*frames/MAX_LANES + frames/4) % frames;
+	int32_t base = LIT;
+	if(i - walk_start < WALK_FRAMES){
+		base = DARK;
+	}else if(i % 997 < DIP_FRAMES){
+		base = TRIP_DEFAULT_LOW - 20;
+	}
+	int32_t v = base + (int32_t)(next_random() % (2*NOISE+1)) - NOISE;
+	return v < 0 ? 0 : v > ADC_FULL_SCALE ? ADC_FULL_SCALE : v;
+}
+
+static void generate(uint32_t lanes){
+	uint16_t* s = samples;
+	for(uint32_t i=0;i<BLOCKS*ADC_BLOCK;i++){
+		for(uint32_t lane=0;lane<lanes;lane++){
+			*s++ = level(lane, i);
+		}
+	}
+}
+
+int main(){
+	TripConfig config = {TRIP_DEFAULT_LOW, TRIP_DEFAULT_HIGH, TRIP_DEFAULT_DWELL};
+	TripDetector dets[MAX_LANES];
+	double max_lanes_per_mhz = 0;
+
+	printf("bench_tripwire: %u passes of %u blocks of %u frames\n", PASSES, BLOCKS, ADC_BLOCK);
+	printf("lanes  ns/frame  ns/sample  cycles/sample  lanes/MHz  breaks\n");
+	for(uint32_t lanes=1;lanes<=MAX_LANES;lanes++){
+		generate(lanes);
+		for(uint32_t lane=0;lane<lanes;lane++){
+			tripwire_init(&dets[lane], lane, &config);
+		}
+
+		TripEvent e;
+		uint64_t ns = 0, cycles = 0;
+		uint32_t breaks = 0;
+		RTC_Stamp end = 0;
+		for(uint32_t p=0;p<PASSES;p++){
+			uint64_t start = bench_now_ns();
+			uint64_t start_cycles = bench_cycles();
+			for(uint32_t b=0;b<BLOCKS;b++){
+				end += ADC_BLOCK*TRIP_SAMPLE_STAMP;
+				breaks += tripwire_process(dets, lanes, &samples[b*ADC_BLOCK*lanes], ADC_BLOCK, end);
+			}
+			cycles += bench_cycles() - start_cycles;
+			ns += bench_now_ns() - start;
+			while(tripwire_next(&e)){}
+		}
+
+		double frames = (double)PASSES*BLOCKS*ADC_BLOCK;
+		double per_sample = cycles/(frames*lanes);
+		double lanes_per_mhz = per_sample ? 1e6/(ADC_SAMPLE_HZ*per_sample) : 0;
+		if(lanes == ADC_MAX_LANES){
+			max_lanes_per_mhz = lanes_per_mhz;
+		}
+		printf("%5u  %8.1f  %9.2f  %13.2f  %9.1f  %6u\n", lanes, ns/frames, ns/(frames*lanes),
+				per_sample, lanes_per_mhz, breaks);
+		if(breaks != PASSES*lanes || tripwire_dropped() != 0){
+			printf("bench_tripwire: expected %u breaks and none dropped\n", PASSES*lanes);
+			return 1;
+		}
+	}
+
+	if(max_lanes_per_mhz > 0){
+		printf("%u lanes need %.2f MHz of host cycles, %.1f%% of the %u MHz core\n",
+				ADC_MAX_LANES, ADC_MAX_LANES/max_lanes_per_mhz,
+				100.0*ADC_MAX_LANES/max_lanes_per_mhz/(SYSCLK_HZ/1000000), SYSCLK_HZ/1000000);
+	}
+	printf("the ADC converts %u lanes per %u us sample period, ADC_MAX_LANES is %u\n",
+			(1000000000/ADC_SAMPLE_HZ)/ADC_CONVERSION_NS, 1000000/ADC_SAMPLE_HZ, ADC_MAX_LANES);
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * bench_uart.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Times the USART2 transmit path: usart2_putch, usart2_write in chunks
+ * of several sizes and usart2_write_buf. The model of DMA1 stream 6
+ * sends a transfer at once whenever the ring fills or a buffer is
+ * queued, so the figures are the driver's own cost per byte, including
+ * its transfer interrupts, and not the line rate. uart_driver.c is
+ * built into this file so the model can reach the stream registers.
+ */
+
+#include "bench.h"
+#include "mmio.h"
+#include "timer.h"
+#include "../src/uart_driver.c"
+
+#define BYTES 4000000u
+#define LINE_BAUD 57600
+
+static uint8_t data[USART2_TX_SIZE];
+static volatile uint32_t sink;
+
+//sends the running transfer and any that follow it, as stream 6 would
+static void transmit_all(){
+	while(*(DMA1_S6CR) & (1<<DMA_EN)){
+		sink += *(DMA1_S6NDTR);
+		*(DMA1_S6CR) &= ~(1<<DMA_EN);
+		*(DMA1_HISR) = DMA_S6_TCIF;
+		DMA1_Stream6_IRQHandler();
+		*(DMA1_HISR) = 0;
+	}
+}
+
+static void report(const char* name, uint64_t ns, uint64_t cycles){
+	printf("%-16s %12.0f %10.2f\n", name, BYTES*1e9/ns, (double)cycles/BYTES);
+}
+
+static void bench_putch(){
+	uint64_t start = bench_now_ns();
+	uint64_t start_cycles = bench_cycles();
+	for(uint32_t i=0;i<BYTES;i++){
+		usart2_putch(data[i & (sizeof(data)-1)]);
+		if(usart2_tx_space() == 0){
+			transmit_all();
+		}
+	}
+	transmit_all();
+	uint64_t cycles = bench_cycles() - start_cycles;
+	report("putch", bench_now_ns() - start, cycles);
+}
+
+static void bench_write(uint32_t chunk){
+	uint64_t start = bench_now_ns();
+	uint64_t start_cycles = bench_cycles();
+	for(uint32_t i=0;i<BYTES;i+=chunk){
+		uint32_t queued = 0;
+		while(queued < chunk){
+			queued += usart2_write(&data[queued], chunk-queued);
+			if(queued < chunk){
+				transmit_all();
+			}
+		}
+	}
+	transmit_all();
+	uint64_t cycles = bench_cycles() - start_cycles;
+
+	char name[24];
+	snprintf(name, sizeof(name), "write %u", chunk);
+	report(name, bench_now_ns() - start, cycles);
+}
+
+static void bench_write_buf(uint32_t length){
+	uint64_t start = bench_now_ns();
+	uint64_t start_cycles = bench_cycles();
+	for(uint32_t i=0;i<BYTES;i+=length){
+		PacketBuf* p = pbuf_alloc();
+		memcpy(pbuf_append(p, length), data, length);
+		usart2_write_buf(p);
+		transmit_all();
+	}
+	uint64_t cycles = bench_cycles() - start_cycles;
+
+	char name[24];
+	snprintf(name, sizeof(name), "write_buf %u", length);
+	report(name, bench_now_ns() - start, cycles);
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("bench_uart: cannot map the register file\n");
+		return 1;
+	}
+	init_usart2(LINE_BAUD, SYSCLK_HZ);
+	for(uint32_t i=0;i<sizeof(data);i++){
+		data[i] = i;
+	}
+
+	printf("bench_uart: %u bytes each, the line carries %u bytes/s at %u baud\n",
+			BYTES, LINE_BAUD/10, LINE_BAUD);
+	printf("path                  bytes/s  cycles/B\n");
+	bench_putch();
+	static const uint32_t chunks[] = {1, 16, 64, USART2_TX_SIZE};
+	for(uint32_t c=0;c<sizeof(chunks)/sizeof(chunks[0]);c++){
+		bench_write(chunks[c]);
+	}
+	bench_write_buf(64);
+	bench_write_buf(PBUF_SIZE-PBUF_HEADROOM);
+	return 0;
+}
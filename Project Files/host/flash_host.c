@@ -0,0 +1,118 @@
+/*
+ * flash_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Flash emulator for the host build, in place of src/flash.c. The flash
+ * log sectors are an array that stands in for the .flashlog section.
+ * Like NOR flash, programming can only clear bits and an erase sets a
+ * whole sector back to 0xFF.
+ *
+ * Every word programmed and every sector erase is a numbered write
+ * point. flash_host_cut picks one: that operation is left half done,
+ * with a random part of its bits changed, and the handler is called.
+ * The handler must not return, a test longjmps back and "reboots".
+ */
+
+#include "flash.h"
+#include "flashlog.h"
+#include <stddef.h>
+
+#define SECTOR_WORDS (FLASHLOG_SECTOR_SIZE/4)
+#define ERASED 0xFFFFFFFF
+
+uint32_t _flashlog_start[FLASHLOG_SECTORS*SECTOR_WORDS] __attribute__((aligned(4)));
+
+static uint32_t points;
+static uint32_t cut_point;			//0 for no cut
+static flash_host_cut_handler cut_handler;
+static uint32_t noise;
+
+static int cut_now();
+static uint32_t random_bits();
+
+/**
+ * Erases every sector and clears the cut
+ */
+void flash_host_init(){
+	for(size_t i=0;i<sizeof(_flashlog_start)/4;i++){
+		_flashlog_start[i] = ERASED;
+	}
+	points = 0;
+	cut_point = 0;
+	cut_handler = NULL;
+}
+
+/**
+ * Cuts the power at a write point, counted from flash_host_init
+ * Inputs:
+ * 		point - 1 for the first write point, 0 to cancel
+ * 		handler - called after the half done operation, must not return
+ * Outputs:
+ * 		none
+ */
+void flash_host_cut(uint32_t point, flash_host_cut_handler handler){
+	cut_point = point;
+	cut_handler = handler;
+	noise = point*2654435761u | 1;
+}
+
+/**
+ * Returns the number of write points so far
+ */
+uint32_t flash_host_points(){
+	return points;
+}
+
+int flash_erase_sector(uint32_t sector){
+	if(sector < FLASHLOG_FIRST_SECTOR || sector >= FLASHLOG_FIRST_SECTOR+FLASHLOG_SECTORS){
+		return -1;
+	}
+	uint32_t* base = &_flashlog_start[(sector-FLASHLOG_FIRST_SECTOR)*SECTOR_WORDS];
+
+	if(cut_now()){
+		//some words made it, others only partly
+		for(uint32_t i=0;i<SECTOR_WORDS;i++){
+			base[i] |= (random_bits() & 1) ? ERASED : random_bits();
+		}
+		cut_handler();
+	}
+
+	for(uint32_t i=0;i<SECTOR_WORDS;i++){
+		base[i] = ERASED;
+	}
+	return 0;
+}
+
+int flash_program(volatile uint32_t* address, const uint32_t* words, uint32_t count){
+	uint32_t* start = _flashlog_start;
+	uint32_t* end = _flashlog_start + sizeof(_flashlog_start)/4;
+	if((uint32_t*)address < start || (uint32_t*)address + count > end){
+		return -1;
+	}
+
+	for(uint32_t i=0;i<count;i++){
+		if(cut_now()){
+			//only some of the bits going to 0 got there
+			address[i] &= words[i] | random_bits();
+			cut_handler();
+		}
+		address[i] &= words[i];
+		if(address[i] != words[i]){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int cut_now(){
+	return ++points == cut_point && cut_handler != NULL;
+}
+
+static uint32_t random_bits(){
+	noise ^= noise<<13;
+	noise ^= noise>>17;
+	noise ^= noise<<5;
+	return noise;
+}
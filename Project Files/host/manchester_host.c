@@ -0,0 +1,89 @@
+/*
+ * manchester_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Line simulator for the host build. A frame is run through the real
+ * encoder after a preamble byte, as nic_send_buf sends it, and every
+ * level change becomes an edge. Each edge is moved by up to the jitter
+ * either way and rounded to a timer tick, and the intervals are
+ * truncated to 16 bits like the TIM4 captures.
+ */
+
+#include "manchester.h"
+
+#define IDLE_INTERVAL 0xFFFF		//the line was quiet before the frame
+
+static uint32_t noise = 1;
+
+static double random_offset(double jitter);
+
+/**
+ * Restarts the jitter sequence so a run can be repeated
+ */
+void manchester_host_seed(uint32_t seed){
+	noise = seed ? seed : 1;
+}
+
+/**
+ * Produces the edge intervals for one frame, ending with the line back
+ * at its idle level.
+ * Inputs:
+ * 		*data - frame bytes, without the preamble
+ * 		length - number of bytes
+ * 		half_bit - sender's half bit in receiver timer ticks
+ * 		jitter - largest edge displacement in ticks
+ * 		*intervals - destination, the first one is the idle gap
+ * 		capacity - size of intervals
+ * Outputs:
+ * 		number of intervals written
+ */
+uint32_t manchester_host_line(const uint8_t* data, uint16_t length, double half_bit,
+		double jitter, uint16_t* intervals, uint32_t capacity){
+	static const uint8_t preamble = MANCHESTER_PREAMBLE;
+	ManchesterEncoder enc;
+	int level = MANCHESTER_IDLE_LEVEL;
+	uint32_t half = 0;
+	uint32_t count = 0;
+	uint32_t last = 0;
+
+	manchester_encoder_start(&enc, &preamble, 1);
+	for(;;){
+		int next = manchester_encoder_next(&enc);
+		if(next < 0){
+			if(enc.data == &preamble){
+				manchester_encoder_start(&enc, data, length);
+				continue;
+			}
+			next = MANCHESTER_IDLE_LEVEL;	//release the line after the last half bit
+		}
+
+		if(next != level && count < capacity){
+			double t = half*half_bit + random_offset(jitter);
+			uint32_t tick = t < 0 ? 0 : (uint32_t)(t + 0.5);
+			intervals[count] = count == 0 ? IDLE_INTERVAL : (uint16_t)(tick - last);
+			count++;
+			last = tick;
+		}
+		level = next;
+		half++;
+
+		if(enc.data != &preamble && enc.halves == 0 && enc.index >= enc.length
+				&& level == MANCHESTER_IDLE_LEVEL){
+			return count;
+		}
+	}
+}
+
+/*
+ * Uniform in [-jitter, jitter], xorshift32
+ */
+static double random_offset(double jitter){
+	uint32_t x = noise;
+	x ^= x<<13;
+	x ^= x>>17;
+	x ^= x<<5;
+	noise = x;
+	return jitter*((x/2147483647.5) - 1.0);
+}
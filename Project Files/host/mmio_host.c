@@ -0,0 +1,429 @@
+/*
+ * mmio_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Emulated register file for running the drivers on a Linux host. The
+ * peripheral, system and unique ID regions are mapped at their real
+ * addresses, so a driver built for the host touches ordinary memory.
+ * Accesses made through REG_READ/REG_WRITE also run a model of the
+ * register, which gives the side effects the drivers rely on:
+ *
+ * 		USART2 SR/DR - TXE and TC always set, RXNE while injected input
+ * 			is waiting, a DR read pops it, DR writes are captured
+ * 		ADC1 SR/CR2/DR - SWSTART completes at once with the injected
+ * 			sample and sets EOC, a DR read clears EOC
+ * 		RTC TR/DR/ISR - INITF follows INIT, RSF and WUTWF read set, the
+ * 			calendar set in init mode runs from the emulated clock once
+ * 			INIT is cleared, the event flags are cleared by writing 0
+ * 		SysTick CTRL/VAL - the counter runs from the emulated clock,
+ * 			reading CTRL returns and clears COUNTFLAG
+ * 		DWT CYCCNT - counts the emulated clock at SYSCLK_HZ
+ *
+ * The emulated clock is the host's monotonic clock plus any time added
+ * with mmio_advance_ns. Interrupts are not raised; a test calls the
+ * handler it wants to exercise.
+ *
+ * Not part of the target build. host/Makefile builds it with the
+ * drivers into the host tests, run them with "make -C host test".
+ */
+
+#define _GNU_SOURCE
+#include "mmio.h"
+#include "timer.h"
+#include "ADC.h"
+#include "RTC.h"
+#include "uart_driver.h"
+#include <sys/mman.h>
+#include <time.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+#define MAX_HOOKS 32
+#define USART_FIFO_SIZE 1024	//must be a power of two
+
+#define RTC_TR_ADDR (RTC_BASE+offsetof(RTC_Struct, TR))
+#define RTC_DR_ADDR (RTC_BASE+offsetof(RTC_Struct, DR))
+#define RTC_CR_ADDR (RTC_BASE+offsetof(RTC_Struct, CR))
+#define RTC_ISR_ADDR (RTC_BASE+offsetof(RTC_Struct, ISR))
+#define RTC_RSF 5
+#define RTC_ISR_FLAGS (0x7F<<8)
+
+#define REG(addr) (*(volatile uint32_t*)(uintptr_t)(addr))
+
+typedef struct{
+	uintptr_t addr;
+	mmio_read_hook read;
+	mmio_write_hook write;
+} Hook;
+
+typedef struct{
+	uint8_t data[USART_FIFO_SIZE];
+	uint32_t put;
+	uint32_t get;
+} Fifo;
+
+static const struct{
+	uintptr_t base;
+	size_t size;
+} regions[] = {
+	{0x1FFF0000, 0x10000},		//system memory, unique ID
+	{0x40000000, 0x80000},		//APB1, APB2, AHB1 peripherals
+	{0xE0000000, 0x100000},		//core peripherals, DWT, SysTick, NVIC, DBGMCU
+};
+
+static Hook hooks[MAX_HOOKS];
+static uint32_t hook_count;
+static uint64_t offset_ns;
+static int mapped;
+
+static Fifo usart_in;
+static Fifo usart_out;
+static uint8_t usart_sr_read;		//SR was read, a DR read now clears IDLE
+
+static uint16_t adc_sample;
+
+static uint64_t systick_start;
+static uint64_t systick_wraps;
+
+static uint64_t dwt_base;
+
+static uint8_t rtc_running;
+static time_t rtc_base;
+static uint64_t rtc_base_cycles;
+
+static void install_models();
+static Hook* find_hook(uintptr_t addr);
+
+/**
+ * Maps the register file, clears it and installs the peripheral models.
+ * Can be called again to reset the emulation between tests.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		0 - ready
+ * 		-1 - a region could not be mapped at its address
+ */
+int mmio_host_init(){
+	if(!mapped){
+		for(size_t i=0;i<sizeof(regions)/sizeof(regions[0]);i++){
+			void* p = mmap((void*)regions[i].base, regions[i].size, PROT_READ|PROT_WRITE,
+					MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED_NOREPLACE, -1, 0);
+			if(p != (void*)regions[i].base){
+				return -1;
+			}
+		}
+		mapped = 1;
+	}
+
+	for(size_t i=0;i<sizeof(regions)/sizeof(regions[0]);i++){
+		memset((void*)regions[i].base, 0, regions[i].size);
+	}
+	hook_count = 0;
+	offset_ns = 0;
+	memset(&usart_in, 0, sizeof(usart_in));
+	memset(&usart_out, 0, sizeof(usart_out));
+	usart_sr_read = 0;
+	adc_sample = 0;
+	systick_start = systick_wraps = 0;
+	dwt_base = 0;
+	rtc_running = 0;
+	install_models();
+	return 0;
+}
+
+/**
+ * Installs a model on a register, replacing any model already there.
+ * Either hook may be NULL for a plain access in that direction.
+ */
+void mmio_hook(uintptr_t addr, mmio_read_hook read, mmio_write_hook write){
+	Hook* h = find_hook(addr);
+	if(h == NULL){
+		if(hook_count == MAX_HOOKS){
+			return;
+		}
+		h = &hooks[hook_count++];
+		h->addr = addr;
+	}
+	h->read = read;
+	h->write = write;
+}
+
+uint32_t mmio_read(uintptr_t addr){
+	uint32_t stored = REG(addr);
+	Hook* h = find_hook(addr);
+	return (h && h->read) ? h->read(addr, stored) : stored;
+}
+
+void mmio_write(uintptr_t addr, uint32_t value){
+	Hook* h = find_hook(addr);
+	REG(addr) = (h && h->write) ? h->write(addr, REG(addr), value) : value;
+}
+
+/**
+ * Moves the emulated clock forward, for tests that wait on timeouts
+ */
+void mmio_advance_ns(uint64_t ns){
+	offset_ns += ns;
+}
+
+/**
+ * Returns the emulated clock in core cycles
+ */
+uint64_t mmio_cycles(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t ns = (uint64_t)ts.tv_sec*1000000000u + ts.tv_nsec + offset_ns;
+	return ns*CYCLES_PER_US/1000;
+}
+
+/**
+ * Queues bytes to be received on USART2
+ */
+void mmio_usart2_input(const void* data, uint32_t len){
+	const uint8_t* bytes = data;
+	for(uint32_t i=0;i<len && usart_in.put-usart_in.get < USART_FIFO_SIZE;i++){
+		usart_in.data[usart_in.put++ & (USART_FIFO_SIZE-1)] = bytes[i];
+	}
+}
+
+/**
+ * Takes up to capacity bytes written to the USART2 data register
+ */
+uint32_t mmio_usart2_output(void* data, uint32_t capacity){
+	uint8_t* bytes = data;
+	uint32_t n = 0;
+	while(n < capacity && usart_out.get != usart_out.put){
+		bytes[n++] = usart_out.data[usart_out.get++ & (USART_FIFO_SIZE-1)];
+	}
+	return n;
+}
+
+/**
+ * Sets the value the next ADC conversion returns
+ */
+void mmio_adc_input(uint16_t sample){
+	adc_sample = sample & 0xFFF;
+}
+
+static Hook* find_hook(uintptr_t addr){
+	for(uint32_t i=0;i<hook_count;i++){
+		if(hooks[i].addr == addr){
+			return &hooks[i];
+		}
+	}
+	return NULL;
+}
+
+//USART2
+
+static uint32_t usart_sr_rd(uintptr_t addr, uint32_t stored){
+	usart_sr_read = 1;
+	uint32_t sr = stored | (1<<TXE) | (1<<TC);
+	if(usart_in.put != usart_in.get){
+		sr |= 1<<RXNE;
+	}
+	return sr;
+}
+
+static uint32_t usart_dr_rd(uintptr_t addr, uint32_t stored){
+	if(usart_sr_read){
+		REG(USART_SR) &= ~(1<<IDLE);
+		usart_sr_read = 0;
+	}
+	if(usart_in.put == usart_in.get){
+		return stored;
+	}
+	return usart_in.data[usart_in.get++ & (USART_FIFO_SIZE-1)];
+}
+
+static uint32_t usart_dr_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	if(usart_out.put - usart_out.get < USART_FIFO_SIZE){
+		usart_out.data[usart_out.put++ & (USART_FIFO_SIZE-1)] = value;
+	}
+	return value & 0xFF;
+}
+
+//ADC1
+
+static uint32_t adc_sr_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	return stored & value;		//status bits are cleared by writing 0
+}
+
+static uint32_t adc_cr2_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	if((value & (1u<<ADC_SWSTART)) && (value & (1<<ADC_ADON))){
+		REG(ADC_DR) = adc_sample;
+		REG(ADC_SR) |= 1<<ADC_EOC;
+	}
+	return value & ~(1u<<ADC_SWSTART);
+}
+
+static uint32_t adc_dr_rd(uintptr_t addr, uint32_t stored){
+	REG(ADC_SR) &= ~(1<<ADC_EOC);
+	return stored;
+}
+
+//SysTick, counts down from LOAD to 0 at the core clock
+
+static uint32_t systick_ctrl_rd(uintptr_t addr, uint32_t stored){
+	if(!(stored & (1<<STK_ENABLE_F))){
+		return stored;
+	}
+	uint64_t wraps = (mmio_cycles() - systick_start)/((uint64_t)REG(STK_LOAD)+1);
+	uint32_t flag = wraps > systick_wraps;
+	systick_wraps = wraps;
+	return stored | (flag<<STK_CNTFLAG_F);
+}
+
+static uint32_t systick_ctrl_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	if((value & (1<<STK_ENABLE_F)) && !(stored & (1<<STK_ENABLE_F))){
+		systick_start = mmio_cycles();
+		systick_wraps = 0;
+	}
+	return value & ~(1u<<STK_CNTFLAG_F);
+}
+
+static uint32_t systick_val_rd(uintptr_t addr, uint32_t stored){
+	if(!(REG(STK_CTRL) & (1<<STK_ENABLE_F))){
+		return stored;
+	}
+	uint64_t reload = (uint64_t)REG(STK_LOAD)+1;
+	return REG(STK_LOAD) - (uint32_t)((mmio_cycles() - systick_start) % reload);
+}
+
+static uint32_t systick_val_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	systick_start = mmio_cycles();
+	systick_wraps = 0;
+	return 0;
+}
+
+//DWT cycle counter
+
+static uint32_t dwt_cyccnt_rd(uintptr_t addr, uint32_t stored){
+	if(!(REG(DWT_CTRL) & (1<<DWT_CYCCNTENA_F))){
+		return stored;
+	}
+	return (uint32_t)(mmio_cycles() - dwt_base);
+}
+
+static uint32_t dwt_cyccnt_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	dwt_base = mmio_cycles() - value;
+	return value;
+}
+
+static uint32_t dwt_ctrl_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	if((value & (1<<DWT_CYCCNTENA_F)) && !(stored & (1<<DWT_CYCCNTENA_F))){
+		dwt_base = mmio_cycles() - REG(DWT_CYCCNT);
+	}else if(!(value & (1<<DWT_CYCCNTENA_F)) && (stored & (1<<DWT_CYCCNTENA_F))){
+		REG(DWT_CYCCNT) = (uint32_t)(mmio_cycles() - dwt_base);
+	}
+	return value;
+}
+
+//RTC calendar, kept as a time_t while running
+
+static uint8_t bcd(uint32_t v){
+	return ((v/10)<<4) | (v%10);
+}
+
+static uint32_t unbcd(uint32_t v){
+	return (v>>4)*10 + (v & 0xF);
+}
+
+static time_t rtc_decode(uint32_t tr, uint32_t dr){
+	struct tm t = {0};
+	uint32_t hours = unbcd((tr>>16) & 0x3F);
+	if(REG(RTC_CR_ADDR) & (1<<FMT)){
+		hours %= 12;
+		if(tr & (1<<PM)){
+			hours += 12;
+		}
+	}
+	t.tm_hour = hours;
+	t.tm_min = unbcd((tr>>8) & 0x7F);
+	t.tm_sec = unbcd(tr & 0x7F);
+	t.tm_mday = unbcd(dr & 0x3F);
+	t.tm_mon = unbcd((dr>>8) & 0x1F) - 1;
+	t.tm_year = unbcd((dr>>16) & 0xFF) + 100;
+	return timegm(&t);
+}
+
+static uint32_t rtc_now(int want_date){
+	time_t now = rtc_base + (time_t)((mmio_cycles() - rtc_base_cycles)/SYSCLK_HZ);
+	struct tm t;
+	gmtime_r(&now, &t);
+
+	if(want_date){
+		uint32_t weekday = t.tm_wday ? t.tm_wday : 7;
+		return bcd(t.tm_mday) | (bcd(t.tm_mon+1)<<8) | (weekday<<13) | (bcd(t.tm_year-100)<<16);
+	}
+
+	uint32_t hours = t.tm_hour;
+	uint32_t pm = 0;
+	if(REG(RTC_CR_ADDR) & (1<<FMT)){
+		pm = hours >= 12;
+		hours %= 12;
+		if(hours == 0){
+			hours = 12;
+		}
+	}
+	return bcd(t.tm_sec) | (bcd(t.tm_min)<<8) | (bcd(hours)<<16) | (pm<<PM);
+}
+
+static uint32_t rtc_tr_rd(uintptr_t addr, uint32_t stored){
+	return rtc_running ? rtc_now(0) : stored;
+}
+
+static uint32_t rtc_dr_rd(uintptr_t addr, uint32_t stored){
+	return rtc_running ? rtc_now(1) : stored;
+}
+
+static uint32_t rtc_isr_rd(uintptr_t addr, uint32_t stored){
+	return stored | (1<<RTC_RSF) | (1<<WUTWF);
+}
+
+static uint32_t rtc_isr_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	//alarm, wakeup, time stamp and tamper flags, bits 8-14, are rc_w0
+	value = (value & ~RTC_ISR_FLAGS) | (stored & value & RTC_ISR_FLAGS);
+
+	if(value & (1<<INIT)){
+		if(rtc_running){
+			//freeze the calendar so init mode sees the current time
+			REG(RTC_TR_ADDR) = rtc_now(0);
+			REG(RTC_DR_ADDR) = rtc_now(1);
+			rtc_running = 0;
+		}
+		return value | (1<<INITF) | (1<<RTC_RSF);
+	}
+
+	if(stored & (1<<INIT)){
+		rtc_base = rtc_decode(REG(RTC_TR_ADDR), REG(RTC_DR_ADDR));
+		rtc_base_cycles = mmio_cycles();
+		rtc_running = 1;
+	}
+	return (value & ~(1<<INITF)) | (1<<RTC_RSF);
+}
+
+static void install_models(){
+	mmio_hook((uintptr_t)USART_SR, usart_sr_rd, NULL);
+	mmio_hook((uintptr_t)USART_DR, usart_dr_rd, usart_dr_wr);
+
+	mmio_hook((uintptr_t)ADC_SR, NULL, adc_sr_wr);
+	mmio_hook((uintptr_t)ADC_CR2, NULL, adc_cr2_wr);
+	mmio_hook((uintptr_t)ADC_DR, adc_dr_rd, NULL);
+
+	mmio_hook((uintptr_t)STK_CTRL, systick_ctrl_rd, systick_ctrl_wr);
+	mmio_hook((uintptr_t)STK_VAL, systick_val_rd, systick_val_wr);
+
+	mmio_hook((uintptr_t)DWT_CYCCNT, dwt_cyccnt_rd, dwt_cyccnt_wr);
+	mmio_hook((uintptr_t)DWT_CTRL, NULL, dwt_ctrl_wr);
+
+	mmio_hook(RTC_TR_ADDR, rtc_tr_rd, NULL);
+	mmio_hook(RTC_DR_ADDR, rtc_dr_rd, NULL);
+	mmio_hook(RTC_ISR_ADDR, rtc_isr_rd, rtc_isr_wr);
+}
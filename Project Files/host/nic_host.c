@@ -0,0 +1,193 @@
+/*
+ * nic_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Bus simulator for the host build. NIC_HOST_NODES copies of nic.c,
+ * built from nic_node_host.c, share one open drain wire with a pull-up:
+ * the line is low while any node drives it low. Time moves one core
+ * clock tick at a time. Every tick each node's timers are run:
+ *
+ * 		TIM5 counts the tick, a CCR1 match sets CC1IF and applies the
+ * 			output compare mode to the node's pin, a CCR2 match sets CC2IF
+ * 		TIM4 captures every change of the line into CCR1 and sets CC1IF,
+ * 			or CC1OF if CC1IF was still set, and a CCR2 match sets CC2IF
+ *
+ * and then the node's handlers are called while an enabled flag is set.
+ * Status flags are cleared by writing 0 and a TIM4 CCR1 read clears
+ * CC1IF, as on the STM32. PB6 of the shared register file follows the
+ * line. The input filter and the interrupt latency are not modelled.
+ */
+
+#include "nic.h"
+#include "mmio.h"
+#include <stddef.h>
+#include <string.h>
+
+extern const NicHostNode nic_host_node0, nic_host_node1, nic_host_node2;
+
+static const NicHostNode* const nodes[NIC_HOST_NODES] = {
+	&nic_host_node0, &nic_host_node1, &nic_host_node2,
+};
+
+static uint32_t now;
+static uint8_t line;
+static uint8_t driven[NIC_HOST_NODES];
+static uint32_t jam_period;
+static uint32_t jam_low;
+
+static void step();
+static uint32_t tim_sr_wr(uintptr_t addr, uint32_t stored, uint32_t value);
+static uint32_t tim_ccr1_rd(uintptr_t addr, uint32_t stored);
+
+/**
+ * Resets the register file and the wire, then starts the driver on
+ * every node. The pool is not reset, so a test reads every frame it
+ * causes before starting the next one.
+ * Inputs:
+ * 		bitrate - passed to nic_init on every node
+ * Outputs:
+ * 		0 - ready
+ * 		-1 - the register file could not be mapped
+ */
+int nic_host_init(uint32_t bitrate){
+	if(mmio_host_init() != 0){
+		return -1;
+	}
+	now = 0;
+	line = 1;
+	jam_period = jam_low = 0;
+	GPIO_PORT_B->IDR = 1<<NIC_RX_PIN;
+
+	for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+		const NicHostNode* node = nodes[n];
+		memset((void*)node->tim4, 0, sizeof(TIMx));
+		memset((void*)node->tim5, 0, sizeof(TIMx));
+		mmio_hook((uintptr_t)&node->tim4->SR, NULL, tim_sr_wr);
+		mmio_hook((uintptr_t)&node->tim5->SR, NULL, tim_sr_wr);
+		mmio_hook((uintptr_t)&node->tim4->CCR1, tim_ccr1_rd, NULL);
+		driven[n] = 1;
+		node->init(bitrate);
+	}
+	return 0;
+}
+
+/**
+ * Returns node n, 0 to NIC_HOST_NODES-1
+ */
+const NicHostNode* nic_host_node(uint32_t n){
+	return nodes[n];
+}
+
+/**
+ * Runs the bus for a number of core clock ticks
+ */
+void nic_host_run(uint32_t ticks){
+	for(uint32_t i=0;i<ticks;i++){
+		step();
+	}
+}
+
+/**
+ * Makes a jammer pull the line low for the first low ticks of every
+ * period ticks, as a node that ignores carrier sense would. A period of
+ * 0 stops it.
+ */
+void nic_host_jam(uint32_t period, uint32_t low){
+	jam_period = period;
+	jam_low = low;
+}
+
+/**
+ * Returns the ticks run since nic_host_init
+ */
+uint32_t nic_host_now(){
+	return now;
+}
+
+static void step(){
+	now++;
+
+	uint8_t level = 1;
+	for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+		volatile TIMx* tim5 = nodes[n]->tim5;
+		if(!(tim5->CR1 & (1<<TIM_CEN))){
+			continue;
+		}
+		tim5->CNT = now;
+
+		uint32_t mode = (tim5->CCMR1>>4) & 0b111;
+		if(tim5->CCR1 == now){
+			tim5->SR |= 1<<TIM_CC1IF;
+			if(mode == OCM_ACTIVE){
+				driven[n] = 1;
+			}else if(mode == OCM_INACTIVE){
+				driven[n] = 0;
+			}
+		}
+		if(tim5->CCR2 == now){
+			tim5->SR |= 1<<TIM_CC2IF;
+		}
+		if(mode == OCM_FORCE_ACTIVE){
+			driven[n] = 1;
+		}else if(mode == OCM_FORCE_INACTIVE){
+			driven[n] = 0;
+		}
+		if(!(tim5->CCER & 1)){
+			driven[n] = 1;
+		}
+		level &= driven[n];
+	}
+	if(jam_period && now % jam_period < jam_low){
+		level = 0;
+	}
+
+	uint32_t edge = level != line;
+	if(edge){
+		line = level;
+		GPIO_PORT_B->IDR = (GPIO_PORT_B->IDR & ~(1<<NIC_RX_PIN)) | (level<<NIC_RX_PIN);
+	}
+	for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+		volatile TIMx* tim4 = nodes[n]->tim4;
+		if(!(tim4->CR1 & (1<<TIM_CEN))){
+			continue;
+		}
+		tim4->CNT = now & 0xFFFF;
+		if(edge && (tim4->CCER & 1)){
+			if(tim4->SR & (1<<TIM_CC1IF)){
+				tim4->SR |= 1<<TIM_CC1OF;
+			}
+			tim4->CCR1 = tim4->CNT;
+			tim4->SR |= 1<<TIM_CC1IF;
+		}
+		if(tim4->CCR2 == tim4->CNT){
+			tim4->SR |= 1<<TIM_CC2IF;
+		}
+	}
+
+	//each handler runs until its enabled flags are clear
+	for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+		const NicHostNode* node = nodes[n];
+		for(uint32_t calls=0;calls<4;calls++){
+			const uint32_t flags = (1<<TIM_CC1IF)|(1<<TIM_CC2IF);
+			if(node->tim4->SR & node->tim4->DIER & flags){
+				node->tim4_irq();
+			}else if(node->tim5->SR & node->tim5->DIER & flags){
+				node->tim5_irq();
+			}else{
+				break;
+			}
+		}
+	}
+}
+
+static uint32_t tim_sr_wr(uintptr_t addr, uint32_t stored, uint32_t value){
+	return stored & value;		//status bits are cleared by writing 0
+}
+
+static uint32_t tim_ccr1_rd(uintptr_t addr, uint32_t stored){
+	volatile TIMx* tim = (volatile TIMx*)(addr - offsetof(TIMx, CCR1));
+	tim->SR &= ~(1<<TIM_CC1IF);
+	return stored;
+}
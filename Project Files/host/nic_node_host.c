@@ -0,0 +1,55 @@
+/*
+ * nic_node_host.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * One node of the host bus simulator. host/Makefile compiles this file
+ * once per node with NIC_NODE set to its number. Each copy builds its
+ * own nic.c with TIM4, TIM5 and the unique ID moved into the node, and
+ * with the driver's functions renamed so the copies link together. The
+ * wire and the receive pin are shared through the register file.
+ */
+
+#ifndef NIC_NODE
+#error "build with -DNIC_NODE=<node number>"
+#endif
+
+#define NODE_NAME(name) NODE_PASTE(name, NIC_NODE)
+#define NODE_PASTE(name, n) NODE_PASTE2(name, n)
+#define NODE_PASTE2(name, n) name##_node##n
+
+#define nic_init NODE_NAME(nic_init)
+#define nic_send NODE_NAME(nic_send)
+#define nic_send_buf NODE_NAME(nic_send_buf)
+#define nic_tx_pending NODE_NAME(nic_tx_pending)
+#define nic_receive NODE_NAME(nic_receive)
+#define nic_receive_buf NODE_NAME(nic_receive_buf)
+#define nic_rx_pending NODE_NAME(nic_rx_pending)
+#define nic_half_bit_cycles NODE_NAME(nic_half_bit_cycles)
+#define nic_channel_state NODE_NAME(nic_channel_state)
+#define nic_stats NODE_NAME(nic_stats)
+#define nic_set_rx_filter NODE_NAME(nic_set_rx_filter)
+#define nic_set_rx_callback NODE_NAME(nic_set_rx_callback)
+#define TIM4_IRQHandler NODE_NAME(TIM4_IRQHandler)
+#define TIM5_IRQHandler NODE_NAME(TIM5_IRQHandler)
+
+#include "nic.h"
+
+static TIMx node_tim4;
+static TIMx node_tim5;
+static volatile uint32_t node_uid[3] = {0x00350036 + NIC_NODE, 0x3436470D, 0x20323534*(NIC_NODE+1)};
+
+#undef TIM4_BASE
+#undef TIM5_BASE
+#undef NIC_UID
+#define TIM4_BASE (&node_tim4)
+#define TIM5_BASE (&node_tim5)
+#define NIC_UID node_uid
+
+#include "../src/nic.c"
+
+const NicHostNode NODE_NAME(nic_host) = {
+	nic_init, nic_send, nic_receive, nic_tx_pending, nic_channel_state, nic_stats,
+	TIM4_IRQHandler, TIM5_IRQHandler, &node_tim4, &node_tim5,
+};
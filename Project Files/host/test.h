@@ -0,0 +1,41 @@
+/*
+ * test.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks for the host tests. A failed check prints where it failed and
+ * the test carries on, test_result turns the count into the exit code.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(cond) do{ \
+	if(!(cond)){ \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		test_failures++; \
+	} \
+}while(0)
+
+#define CHECK_EQ(actual, expected) do{ \
+	long long a_ = (long long)(actual), e_ = (long long)(expected); \
+	if(a_ != e_){ \
+		printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+		test_failures++; \
+	} \
+}while(0)
+
+/*
+ * Prints the verdict and returns the exit code for main
+ */
+static inline int test_result(const char* name){
+	printf("%s: %s\n", name, test_failures ? "FAIL" : "ok");
+	return test_failures != 0;
+}
+
+#endif /* TEST_H */
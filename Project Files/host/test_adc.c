@@ -0,0 +1,76 @@
+/*
+ * test_adc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the recovery from an ADC overrun. The DMA2 stream 0 registers
+ * are plain memory on the host, so an overrun is set up by hand: the
+ * stream part way through a block, OVR raised and, in one case, the
+ * half transfer flag still pending. ADC.c is built into this file so
+ * the blocks handed over can be compared with its sample buffer.
+ */
+
+#include "test.h"
+#include "mmio.h"
+#include "../src/ADC.c"
+
+#define LANES 2
+#define BUFFER_SAMPLES (2*ADC_BLOCK*LANES)
+
+static const uint8_t channels[LANES] = {4, ADC_DEFAULT_CHANNEL};
+static uint32_t blocks;
+static const uint16_t* last_block;
+
+static void on_block(const uint16_t* block, uint32_t frames, uint32_t lanes){
+	blocks++;
+	last_block = block;
+}
+
+static void overrun(uint32_t ndtr, uint32_t lisr){
+	*(DMA2_S0NDTR) = ndtr;
+	*(DMA2_LISR) = lisr;
+	REG_WRITE(ADC_SR, 0);
+	*(volatile uint32_t*)ADC_SR |= 1<<ADC_OVR;
+	ADC_IRQHandler();
+}
+
+static void check_restarted(){
+	CHECK_EQ(*(DMA2_S0NDTR), BUFFER_SAMPLES);
+	CHECK(*(DMA2_S0CR) & (1<<DMA_EN));
+	CHECK(*(DMA2_S0CR) & (1<<DMA_CIRC));
+	CHECK_EQ(REG_READ(ADC_SR) & (1<<ADC_OVR), 0);
+	CHECK(REG_READ(ADC_CR2) & (1<<ADC_DMA));
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("test_adc: cannot map the register file\n");
+		return 1;
+	}
+	CHECK_EQ(ADC_set_lanes(channels, LANES), 0);
+	ADC_set_block_callback(on_block);
+	ADC_init();
+	CHECK(*(ADC_CR1) & (1<<ADC_OVRIE));
+	CHECK(*(NVIC_ISER0) & (1<<ADC_IRQ));
+
+	//part way through the second block, nothing finished is pending
+	overrun(BUFFER_SAMPLES/4, 0);
+	check_restarted();
+	CHECK_EQ(*(DMA2_S0M0AR), (uint32_t)(uintptr_t)samples);
+	CHECK_EQ(ADC_overruns(), 1);
+	CHECK_EQ(blocks, 0);
+
+	//the first block finished before the overrun and is still passed on
+	overrun(BUFFER_SAMPLES/2 - 3, DMA_S0_HTIF);
+	check_restarted();
+	CHECK_EQ(ADC_overruns(), 2);
+	CHECK_EQ(blocks, 1);
+	CHECK(last_block == samples);
+
+	//nothing happens without OVR
+	REG_WRITE(ADC_SR, 0);
+	ADC_IRQHandler();
+	CHECK_EQ(ADC_overruns(), 2);
+	return test_result("test_adc");
+}
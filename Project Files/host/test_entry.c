@@ -0,0 +1,248 @@
+/*
+ * test_entry.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Types keys into the login and clock entry of main.c and checks what
+ * the LCD shows and where the state machine goes. main.c is built into
+ * this file so its static functions can be called. The LCD is a model
+ * of the screen, the RTC and the flash log run on the host emulators,
+ * and the rest of the application is stubbed out because only the
+ * entry steps are driven.
+ */
+
+#include "test.h"
+#include "mmio.h"
+#include "flash.h"
+#include <stdint.h>
+#include <string.h>
+
+char* itoa(int value, char* str, int base);
+
+#define main app_main
+#include "../src/main.c"
+#undef main
+
+#define RTC_REG(field) ((volatile uint32_t*)(RTC_BASE+offsetof(RTC_Struct, field)))
+#define LCD_ROWS 2
+#define LCD_COLS 16
+
+static char screen[LCD_ROWS][LCD_COLS+1];
+static uint8_t cursorRow, cursorCol;
+
+void lcd_reset(){
+	for(uint32_t r=0;r<LCD_ROWS;r++){
+		memset(screen[r], ' ', LCD_COLS);
+		screen[r][LCD_COLS] = '\0';
+	}
+	cursorRow = cursorCol = 0;
+}
+
+void lcd_set_position(uint8_t row, uint8_t col){
+	cursorRow = row;
+	cursorCol = col;
+}
+
+void lcd_row0(){
+	lcd_set_position(0, 0);
+}
+
+void lcd_row1(){
+	lcd_set_position(1, 0);
+}
+
+void lcd_data(uint8_t data){
+	if(cursorRow < LCD_ROWS && cursorCol < LCD_COLS){
+		screen[cursorRow][cursorCol] = data;
+	}
+	cursorCol++;
+}
+
+int lcd_print_string(const char* pointer){
+	int count = 0;
+	while(*pointer){
+		lcd_data(*pointer++);
+		count++;
+	}
+	return count;
+}
+
+int lcd_fb_print(uint8_t row, uint8_t col, const char* pointer){
+	lcd_set_position(row, col);
+	return lcd_print_string(pointer);
+}
+
+void lcd_init(Cursor_Mode mode){}
+char* itoa(int value, char* str, int base){ sprintf(str, "%d", value); return str; }
+void event_init(){}
+void event_loop(){}
+int event_post(EventType type, uint32_t data){ return 0; }
+void event_subscribe(EventType type, event_handler handler){}
+void timer_init(){}
+void init_piezo(){}
+void piezo_stop(){}
+void play_note(const Note* note){}
+int play_notes(const Note* notes, uint32_t length, PiezoPriority priority, uint8_t loop){ return 0; }
+void key_init(){}
+void key_set_callback(key_callback cb){}
+char key_getchar_noblock(){ return 0; }
+void ADC_init(){}
+int ADC_set_lanes(const uint8_t* channels, uint32_t lanes){ return 0; }
+void ADC_set_block_callback(adc_block_callback callback){}
+void nic_init(uint32_t bitrate){}
+void nic_set_rx_callback(nic_rx_callback callback){}
+void frame_init(uint8_t address){}
+PacketBuf* frame_receive_buf(FrameHeader* header){ return NULL; }
+void pbuf_free(PacketBuf* p){}
+void init_usart2(uint32_t baud, uint32_t sysclk){}
+uint32_t usart2_read(void* data, uint32_t len){ return 0; }
+void usart2_set_rx_callback(usart2_rx_callback callback){}
+
+//starts from a powered up board whose RTC was never set
+static void power_up(){
+	mmio_host_init();
+	flash_host_init();
+	lcd_reset();
+	clockReady = false;
+	begin_login(false);
+}
+
+static void type(const char* keys){
+	while(*keys){
+		entry_key(*keys++);
+	}
+}
+
+static int row_is(uint32_t row, const char* text){
+	return strncmp(screen[row], text, strlen(text)) == 0;
+}
+
+static void test_good_login(){
+	power_up();
+	CHECK(row_is(0, "Username:"));
+
+	type("6265");
+	CHECK(row_is(1, "6265 "));
+	type("3");
+	CHECK_EQ(entryStep, ENTER_PASSWORD);
+	CHECK(row_is(0, "Password:"));
+
+	type("123AB");
+	CHECK(row_is(1, "***** "));
+	type("C");
+	CHECK_EQ(entryStep, ENTER_DATE);
+	CHECK(row_is(0, "Enter the date:"));
+	CHECK(row_is(1, "  /  /  "));
+	CHECK_EQ(mode, LOGIN);
+}
+
+static void test_bad_username(){
+	power_up();
+	type("62654");
+	CHECK_EQ(entryStep, ENTER_USERNAME);
+	CHECK_EQ(entryIndex, 0);
+	CHECK(row_is(0, "Username:"));
+	CHECK(row_is(1, "Incorrect."));
+
+	//the next key clears the message and starts the new username
+	type("6");
+	CHECK(row_is(1, "6         "));
+	type("2653");
+	CHECK_EQ(entryStep, ENTER_PASSWORD);
+}
+
+static void test_bad_password(){
+	power_up();
+	type("62653");
+	type("123ABD");
+	CHECK_EQ(entryStep, ENTER_USERNAME);
+	CHECK(row_is(0, "Username:"));
+	CHECK(row_is(1, "Incorrect."));
+
+	//a short password is not checked early
+	type("62653");
+	type("12");
+	CHECK_EQ(entryStep, ENTER_PASSWORD);
+	type("3ABC");
+	CHECK_EQ(entryStep, ENTER_DATE);
+}
+
+static void test_date_and_time_take_digits_only(){
+	power_up();
+	type("62653123ABC");
+
+	type("12A/3*1#26");
+	CHECK_EQ(entryStep, ENTER_TIME);
+	CHECK(memcmp(dateDigits, "123126", DIGITS_LENGTH) == 0);
+	CHECK(row_is(0, "Enter the time:"));
+
+	type("11:5D9B15");
+	CHECK_EQ(entryStep, ENTER_AM_PM);
+	CHECK(memcmp(timeDigits, "115915", DIGITS_LENGTH) == 0);
+	CHECK(row_is(0, "0 - AM"));
+	CHECK(row_is(1, "1 - PM"));
+}
+
+static void test_date_and_time_echo(){
+	power_up();
+	type("62653123ABC");
+	type("1231");
+	CHECK(row_is(1, "12/31/  "));
+	type("26");
+	type("0830");
+	CHECK(row_is(1, "08:30:  "));
+}
+
+static void test_pm(){
+	power_up();
+	type("62653123ABC" "123126" "115915");
+
+	//only 0 and 1 answer AM or PM
+	type("2*A#");
+	CHECK_EQ(entryStep, ENTER_AM_PM);
+	CHECK(!clockReady);
+
+	type("1");
+	CHECK(clockReady);
+	CHECK_EQ(mode, MENU);
+	CHECK(row_is(0, "What should I do"));		//the '?' is past the last column
+	CHECK_EQ(REG_READ(RTC_REG(TR)), 0x00115915 | (1<<PM));
+	CHECK_EQ(REG_READ(RTC_REG(DR)) & 0xFF1F3F, 0x261231);
+}
+
+static void test_am(){
+	power_up();
+	type("62653123ABC" "070426" "083000" "0");
+	CHECK(clockReady);
+	CHECK_EQ(mode, MENU);
+	CHECK_EQ(REG_READ(RTC_REG(TR)), 0x00083000);
+	CHECK_EQ(REG_READ(RTC_REG(DR)) & 0xFF1F3F, 0x260704);
+}
+
+static void test_login_with_clock_running(){
+	power_up();
+	type("62653123ABC" "070426" "083000" "0");
+
+	//the clock is only asked for once
+	begin_login(false);
+	type("62653123ABC");
+	CHECK_EQ(mode, MENU);
+	CHECK(row_is(0, "What should I do"));
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("test_entry: cannot map the register file\n");
+		return 1;
+	}
+	test_good_login();
+	test_bad_username();
+	test_bad_password();
+	test_date_and_time_take_digits_only();
+	test_date_and_time_echo();
+	test_pm();
+	test_am();
+	test_login_with_clock_running();
+	return test_result("test_entry");
+}
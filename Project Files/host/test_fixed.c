@@ -0,0 +1,103 @@
+/*
+ * test_fixed.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the integer conversions in fixed.h against the float code they
+ * replaced, for every ADC count and every millivolt in range. The old
+ * float results sit a rounding error either side of the exact value, so
+ * they are compared to within 1e-6 and the integer results must equal
+ * the exact value rounded down.
+ */
+
+#include "test.h"
+#include "fixed.h"
+#include "tripwire.h"
+#include <math.h>
+
+#define EPSILON 1e-6
+
+//the baseline ADC.c in double precision
+static double old_mv(uint32_t counts){
+	return ((counts*3.3)/4095)*1000;
+}
+
+static double old_deci_c(double mv){
+	return (25+((mv-750)/10))*10;
+}
+
+static double old_deci_f(double mv){
+	return ((old_deci_c(mv)/10)*1.8+32)*10;
+}
+
+static void test_counts_to_mv(){
+	for(uint32_t c=0;c<=ADC_FULL_SCALE;c++){
+		uint32_t mv = counts_to_mv(c);
+		CHECK_EQ(mv, (uint64_t)c*ADC_VREF_MV/ADC_FULL_SCALE);
+		CHECK_EQ(mv, (uint32_t)floor(old_mv(c) + EPSILON));
+		CHECK(old_mv(c) - mv > -EPSILON && old_mv(c) - mv < 1);
+	}
+	CHECK_EQ(counts_to_mv(0), 0);
+	CHECK_EQ(counts_to_mv(ADC_FULL_SCALE), ADC_VREF_MV);
+}
+
+static void test_temperature(){
+	for(uint32_t mv=0;mv<=ADC_VREF_MV;mv++){
+		CHECK_EQ(mv_to_deci_c(mv), (int32_t)floor(old_deci_c(mv) + EPSILON));
+		CHECK_EQ(mv_to_deci_f(mv), (int32_t)floor(old_deci_f(mv) + EPSILON));
+		CHECK_EQ(mv_to_deci_f(mv), (int32_t)(mv*9/5) - 580);
+	}
+	CHECK_EQ(mv_to_deci_c(750), 250);		//25.0 C
+	CHECK_EQ(mv_to_deci_f(750), 770);		//77.0 F
+	CHECK_EQ(mv_to_deci_c(0), -500);
+	CHECK_EQ(mv_to_deci_f(0), -580);
+
+	//from raw counts the old path carried the fraction of a mV along
+	for(uint32_t c=0;c<=ADC_FULL_SCALE;c++){
+		int32_t deci_c = mv_to_deci_c(counts_to_mv(c));
+		CHECK(old_deci_c(old_mv(c)) - deci_c > -EPSILON && old_deci_c(old_mv(c)) - deci_c < 1);
+	}
+}
+
+static void test_mv_to_counts(){
+	for(uint32_t mv=0;mv<=ADC_VREF_MV;mv++){
+		uint32_t c = MV_TO_COUNTS(mv);
+		CHECK(c <= ADC_FULL_SCALE);
+		CHECK(counts_to_mv(c) >= mv);
+		CHECK(c == 0 || counts_to_mv(c-1) < mv);
+	}
+}
+
+/*
+ * The tripwire compares raw counts with MV_TO_COUNTS thresholds where
+ * the old code converted every sample to mV and compared that
+ */
+static void test_threshold(){
+	uint32_t mismatches = 0, old_mismatches = 0;
+	for(uint32_t mv=0;mv<=ADC_VREF_MV;mv++){
+		uint32_t threshold = MV_TO_COUNTS(mv);
+		for(uint32_t c=0;c<=ADC_FULL_SCALE;c++){
+			uint32_t raw = c >= threshold;
+			mismatches += raw != (counts_to_mv(c) >= mv);
+			old_mismatches += raw != (old_mv(c) + EPSILON >= mv);
+		}
+	}
+	CHECK_EQ(mismatches, 0);
+	CHECK_EQ(old_mismatches, 0);
+
+	static const uint32_t defaults[] = {250, 400};
+	static const uint32_t counts[] = {TRIP_DEFAULT_LOW, TRIP_DEFAULT_HIGH};
+	for(uint32_t i=0;i<2;i++){
+		CHECK(old_mv(counts[i]) + EPSILON >= defaults[i]);
+		CHECK(old_mv(counts[i]-1) < defaults[i]);
+	}
+}
+
+int main(){
+	test_counts_to_mv();
+	test_temperature();
+	test_mv_to_counts();
+	test_threshold();
+	return test_result("test_fixed");
+}
@@ -0,0 +1,199 @@
+/*
+ * test_flashlog.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Runs the flash log on the flash emulator and cuts the power at every
+ * write point of a workload long enough to fill the checkpoint index
+ * of both sectors, so the sweep covers records, checkpoints, index
+ * entries, headers and the erase of a sector being moved to. After
+ * each cut the log is reopened and must hold every record that was
+ * acknowledged, plus at most the one being written, and must keep
+ * working afterwards.
+ */
+
+#include "test.h"
+#include "flash.h"
+#include "flashlog.h"
+#include <setjmp.h>
+#include <string.h>
+
+#define TAGS 4
+#define CHECKPOINT_WORDS 11			//4 parts, so a checkpoint spans several write points
+#define RECORDS_PER_CHECKPOINT 3	//fills the index well before the sector
+#define CYCLES (2*FLASHLOG_INDEX_ENTRIES + 8)		//two moves, the second one erases
+#define LOG_COUNT 1
+
+typedef struct{
+	uint32_t totals[TAGS];
+	uint32_t seq;					//last record sequence number
+} Model;
+
+static Model acked;					//state the log has acknowledged
+static volatile int inflightTag;	//record being appended, -1 for none
+static volatile uint32_t inflightValue;
+
+static Model replayed;
+static int replayError;
+
+static jmp_buf reboot;
+
+static void power_lost(){
+	longjmp(reboot, 1);
+}
+
+static void save(const Model* m, uint32_t* words){
+	memset(words, 0, CHECKPOINT_WORDS*4);
+	for(uint32_t i=0;i<TAGS;i++){
+		words[i] = m->totals[i];
+	}
+	words[TAGS] = m->seq;
+	for(uint32_t i=TAGS+1;i<CHECKPOINT_WORDS;i++){
+		words[i] = m->totals[i%TAGS]*31 + i;		//checked on load
+	}
+}
+
+static void replay(uint8_t type, uint8_t tag, const uint32_t* data){
+	if(type != LOG_COUNT || tag >= TAGS || data[0] <= replayed.seq){
+		replayError = 1;
+		return;
+	}
+	replayed.seq = data[0];
+	replayed.totals[tag] += data[1];
+}
+
+//reopens the log as after a reset and rebuilds the state from it
+static int recover(Model* m){
+	uint32_t words[CHECKPOINT_WORDS];
+	memset(&replayed, 0, sizeof(replayed));
+	replayError = 0;
+
+	int loaded = flashlog_init(words, CHECKPOINT_WORDS);
+	if(loaded == CHECKPOINT_WORDS){
+		for(uint32_t i=0;i<TAGS;i++){
+			replayed.totals[i] = words[i];
+		}
+		replayed.seq = words[TAGS];
+		for(uint32_t i=TAGS+1;i<CHECKPOINT_WORDS;i++){
+			if(words[i] != replayed.totals[i%TAGS]*31 + i){
+				return -1;
+			}
+		}
+	}else if(loaded != 0){
+		return -1;
+	}
+	flashlog_replay(replay);
+	*m = replayed;
+	return replayError ? -1 : 0;
+}
+
+static int checkpoint(){
+	uint32_t words[CHECKPOINT_WORDS];
+	save(&acked, words);
+	return flashlog_checkpoint(words, CHECKPOINT_WORDS);
+}
+
+static int append(uint32_t tag, uint32_t value){
+	uint32_t data[FLASHLOG_DATA_WORDS] = {acked.seq+1, value, 0};
+	inflightTag = tag;
+	inflightValue = value;
+	int result = flashlog_append(LOG_COUNT, tag, data);
+	if(result == 0){
+		acked.seq++;
+		acked.totals[tag] += value;
+	}
+	inflightTag = -1;
+	return result;
+}
+
+//the boot sequence of main: reopen, then a checkpoint if the log asks
+static int boot(Model* m){
+	if(recover(m) < 0){
+		return -1;
+	}
+	acked = *m;
+	if(flashlog_checkpoint_due()){
+		return checkpoint();
+	}
+	return 0;
+}
+
+static void workload(uint32_t cycles){
+	Model start;
+	boot(&start);
+	for(uint32_t c=0;c<cycles;c++){
+		for(uint32_t r=0;r<RECORDS_PER_CHECKPOINT;r++){
+			uint32_t n = c*RECORDS_PER_CHECKPOINT + r;
+			append(n % TAGS, (n % 7) + 1);
+		}
+		checkpoint();
+	}
+}
+
+static int same(const Model* a, const Model* b){
+	return memcmp(a->totals, b->totals, sizeof(a->totals)) == 0;
+}
+
+static void test_no_cut(){
+	flash_host_init();
+	memset(&acked, 0, sizeof(acked));
+	inflightTag = -1;
+	workload(CYCLES);
+	CHECK(flashlog_stats()->generation >= 2);
+	CHECK(flashlog_stats()->erases >= 1);
+
+	Model m;
+	CHECK_EQ(recover(&m), 0);
+	CHECK(same(&m, &acked));
+	CHECK_EQ(m.seq, acked.seq);
+}
+
+static void test_cut_everywhere(){
+	//count the write points of the whole workload
+	flash_host_init();
+	memset(&acked, 0, sizeof(acked));
+	inflightTag = -1;
+	workload(CYCLES);
+	uint32_t total = flash_host_points();
+
+	uint32_t failures = 0;
+	for(uint32_t point=1;point<=total;point++){
+		flash_host_init();
+		memset(&acked, 0, sizeof(acked));
+		inflightTag = -1;
+		flash_host_cut(point, power_lost);
+		if(setjmp(reboot) == 0){
+			workload(CYCLES);
+		}
+		flash_host_cut(0, NULL);
+
+		//everything acknowledged, and the cut record at most once
+		Model m;
+		Model before = acked;
+		Model with = acked;
+		if(inflightTag >= 0){
+			with.totals[inflightTag] += inflightValue;
+		}
+		int ok = boot(&m) == 0 && (same(&m, &before) || same(&m, &with));
+
+		//the log keeps working from what was recovered
+		if(ok){
+			ok = append(0, 100) == 0 && checkpoint() == 0 && append(1, 200) == 0;
+			Model again;
+			ok = ok && recover(&again) == 0 && same(&again, &acked);
+		}
+
+		if(!ok && failures++ < 10){
+			printf("power cut at write point %u of %u not recovered\n", point, total);
+		}
+	}
+	CHECK_EQ(failures, 0);
+	printf("test_flashlog: %u write points cut\n", total);
+}
+
+int main(){
+	test_no_cut();
+	test_cut_everywhere();
+	return test_result("test_flashlog");
+}
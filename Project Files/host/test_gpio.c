@@ -0,0 +1,206 @@
+/*
+ * test_gpio.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the PinGroup functions in gpio.h against the per pin register
+ * updates they replaced, for every pin mask. The group functions take
+ * a port pointer, so they run on a GPIOx in RAM filled with random
+ * bits. BSRR is write only: what is written to it is applied to a
+ * copy of ODR with set winning over reset, as the hardware does.
+ */
+
+#include "test.h"
+#include "gpio.h"
+#include <string.h>
+
+#define MASKS 0x10000
+
+static uint32_t seed = 2016;
+
+static uint32_t next_random(){
+	seed ^= seed<<13;
+	seed ^= seed>>17;
+	seed ^= seed<<5;
+	return seed;
+}
+
+static void randomize(GPIOx* port){
+	uint32_t* words = (uint32_t*)port;
+	for(uint32_t i=0;i<sizeof(GPIOx)/4;i++){
+		words[i] = next_random();
+	}
+}
+
+//the old set_pin_* update of one 2 bit field
+static uint32_t field2(uint32_t reg, uint32_t pin, uint32_t value){
+	reg &= ~(0b11<<(pin*2));
+	return reg | (value<<(pin*2));
+}
+
+static uint32_t ref_field2(uint32_t reg, uint32_t mask, uint32_t value){
+	for(uint32_t pin=0;pin<16;pin++){
+		if(mask & (1<<pin)){
+			reg = field2(reg, pin, value);
+		}
+	}
+	return reg;
+}
+
+//each pin takes its field from image
+static uint32_t ref_modes(uint32_t reg, uint32_t mask, uint32_t image){
+	for(uint32_t pin=0;pin<16;pin++){
+		if(mask & (1<<pin)){
+			reg = field2(reg, pin, (image>>(pin*2)) & 3);
+		}
+	}
+	return reg;
+}
+
+static void ref_alt_func(GPIOx* port, uint32_t mask, uint32_t af){
+	for(uint32_t pin=0;pin<16;pin++){
+		if(!(mask & (1<<pin))){
+			continue;
+		}
+		if(pin < 8){
+			port->AFRL &= ~(0b1111<<(pin*4));
+			port->AFRL |= af<<(pin*4);
+		}else{
+			port->AFRH &= ~(0b1111<<((pin-8)*4));
+			port->AFRH |= af<<((pin-8)*4);
+		}
+	}
+}
+
+//the old output drive, one ODR read-modify-write per pin
+static uint32_t ref_write(uint32_t odr, uint32_t mask, uint32_t value){
+	for(uint32_t pin=0;pin<16;pin++){
+		if(mask & (1<<pin)){
+			if(value & (1<<pin)){
+				odr |= 1<<pin;
+			}else{
+				odr &= ~(1<<pin);
+			}
+		}
+	}
+	return odr;
+}
+
+static uint32_t apply_bsrr(uint32_t odr, uint32_t bsrr){
+	odr &= ~(bsrr>>16);
+	return (odr | bsrr) & 0xFFFF;
+}
+
+static void test_spread(){
+	uint32_t bad2 = 0, bad4 = 0;
+	for(uint32_t mask=0;mask<MASKS;mask++){
+		uint32_t expect2 = 0, expect4 = 0;
+		for(uint32_t pin=0;pin<16;pin++){
+			if(mask & (1<<pin)){
+				expect2 |= 1<<(pin*2);
+				if(pin < 8){
+					expect4 |= 1<<(pin*4);
+				}
+			}
+		}
+		bad2 += gpio_spread2(mask) != expect2;
+		bad4 += gpio_spread4(mask) != expect4;
+	}
+	CHECK_EQ(bad2, 0);
+	CHECK_EQ(bad4, 0);
+}
+
+static void test_two_bit_fields(){
+	uint32_t bad = 0;
+	GPIOx port, before;
+	for(uint32_t mask=0;mask<MASKS;mask++){
+		for(uint32_t value=0;value<4;value++){
+			randomize(&port);
+			before = port;
+			PinGroup g = PIN_GROUP(&port, mask);
+
+			gpio_group_mode(g, value);
+			gpio_group_pull(g, value);
+			gpio_group_speed(g, value);
+			bad += port.MODER != ref_field2(before.MODER, mask, value);
+			bad += port.PUPDR != ref_field2(before.PUPDR, mask, value);
+			bad += port.OSPEEDR != ref_field2(before.OSPEEDR, mask, value);
+			bad += gpio_mode_image(mask, value) != ref_field2(0, mask, value);
+
+			//only the registers written may change
+			before.MODER = port.MODER;
+			before.PUPDR = port.PUPDR;
+			before.OSPEEDR = port.OSPEEDR;
+			bad += memcmp(&port, &before, sizeof(port)) != 0;
+		}
+	}
+	CHECK_EQ(bad, 0);
+}
+
+static void test_modes(){
+	uint32_t bad = 0;
+	GPIOx port;
+	for(uint32_t mask=0;mask<MASKS;mask++){
+		randomize(&port);
+		uint32_t before = port.MODER;
+		uint32_t image = next_random();
+		gpio_group_modes(PIN_GROUP(&port, mask), image);
+		bad += port.MODER != ref_modes(before, mask, image);
+	}
+	CHECK_EQ(bad, 0);
+}
+
+static void test_output_type_and_alt_func(){
+	uint32_t bad = 0;
+	GPIOx port, expect;
+	for(uint32_t mask=0;mask<MASKS;mask++){
+		randomize(&port);
+		expect = port;
+		PinGroup g = PIN_GROUP(&port, mask);
+
+		OutputType type = next_random() & 1;
+		gpio_group_output_type(g, type);
+		expect.OTYPER = type == OPEN_DRAIN ? expect.OTYPER | mask : expect.OTYPER & ~mask;
+
+		uint32_t af = next_random() & 0xF;
+		gpio_group_alt_func(g, af);
+		ref_alt_func(&expect, mask, af);
+
+		bad += memcmp(&port, &expect, sizeof(port)) != 0;
+	}
+	CHECK_EQ(bad, 0);
+}
+
+static void test_outputs(){
+	uint32_t bad = 0;
+	GPIOx port;
+	for(uint32_t mask=0;mask<MASKS;mask++){
+		randomize(&port);
+		uint32_t odr = port.ODR & 0xFFFF;
+		PinGroup g = PIN_GROUP(&port, mask);
+
+		uint32_t value = next_random();
+		gpio_group_write(g, value);
+		bad += apply_bsrr(odr, port.BSSR) != ref_write(odr, mask, value);
+
+		gpio_group_set(g);
+		bad += apply_bsrr(odr, port.BSSR) != ref_write(odr, mask, 0xFFFF);
+
+		gpio_group_clear(g);
+		bad += apply_bsrr(odr, port.BSSR) != ref_write(odr, mask, 0);
+
+		port.IDR = next_random();
+		bad += gpio_group_read(g) != (port.IDR & mask);
+	}
+	CHECK_EQ(bad, 0);
+}
+
+int main(){
+	test_spread();
+	test_two_bit_fields();
+	test_modes();
+	test_output_type_and_alt_func();
+	test_outputs();
+	return test_result("test_gpio");
+}
@@ -0,0 +1,62 @@
+/*
+ * test_keypad.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks which queued key events each getter hands out. keypad.c is
+ * built into this file so a test can queue the events a held key makes
+ * without running the scan: a press, repeats while it is held and a
+ * release.
+ */
+
+#include "test.h"
+#include "../src/keypad.c"
+
+#define KEY_5 6					//'5', row 1 column 1
+#define KEY_HASH 15				//'#'
+
+//a press of key held for repeats repeats, then released
+static void hold(uint8_t key, uint32_t repeats){
+	queue_event(key, KEY_DOWN, 0);
+	for(uint32_t i=0;i<repeats;i++){
+		queue_event(key, KEY_REPEAT, KEY_REPEAT_DELAY_MS + i*KEY_REPEAT_MS);
+	}
+	queue_event(key, KEY_UP, KEY_REPEAT_DELAY_MS + repeats*KEY_REPEAT_MS);
+}
+
+static void test_presses_only(){
+	hold(KEY_5, 3);
+	hold(KEY_HASH, 2);
+	CHECK_EQ(key_getkey_noblock(), KEY_5);
+	CHECK_EQ(key_getkey_noblock(), KEY_HASH);
+	CHECK_EQ(key_getkey_noblock(), 0);
+
+	hold(KEY_5, 4);
+	hold(KEY_HASH, 0);
+	CHECK_EQ(key_getchar_noblock(), '5');
+	CHECK_EQ(key_getchar_noblock(), '#');
+	CHECK_EQ(key_getchar_noblock(), 0);
+}
+
+static void test_repeats(){
+	hold(KEY_5, 2);
+	hold(KEY_HASH, 0);
+	CHECK_EQ(key_getkey_repeat_noblock(), KEY_5);
+	CHECK_EQ(key_getkey_repeat_noblock(), KEY_5);
+	CHECK_EQ(key_getkey_repeat_noblock(), KEY_5);
+	CHECK_EQ(key_getkey_repeat_noblock(), KEY_HASH);
+	CHECK_EQ(key_getkey_repeat_noblock(), 0);
+
+	hold(KEY_HASH, 1);
+	CHECK_EQ(key_getchar_repeat_noblock(), '#');
+	CHECK_EQ(key_getchar_repeat_noblock(), '#');
+	CHECK_EQ(key_getchar_repeat_noblock(), 0);
+	CHECK_EQ(key_dropped(), 0);
+}
+
+int main(){
+	test_presses_only();
+	test_repeats();
+	return test_result("test_keypad");
+}
@@ -0,0 +1,148 @@
+/*
+ * test_manchester.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Runs frames through the encoder, the line simulator and the decoder.
+ * With every edge moved by up to a twentieth of a bit either way and
+ * the sender's clock 5% off, every frame must come back unchanged. The
+ * preamble allows 25% between one interval and the average so far,
+ * which sets that limit; bench_manchester shows where errors start.
+ * At NIC_MAX_BITRATE the tick an edge is captured on is the only error.
+ * Skipping a frame, for the header filter or a lost edge, must leave
+ * the decoder ready for the next one.
+ */
+
+#include "test.h"
+#include "manchester.h"
+#include "nic.h"
+#include "timer.h"
+#include <string.h>
+
+#define MAX_INTERVALS (2*8*(NIC_MAX_FRAME+1) + 2)
+#define FRAMES 2000
+
+static uint16_t intervals[MAX_INTERVALS];
+static uint8_t received[NIC_MAX_FRAME];
+static uint32_t seed = 12345;
+
+static uint32_t next_random(){
+	seed ^= seed<<13;
+	seed ^= seed>>17;
+	seed ^= seed<<5;
+	return seed;
+}
+
+static double half_bit_ticks(uint32_t bitrate){
+	return (double)(SYSCLK_HZ/(2*bitrate));
+}
+
+//sends one frame and returns the decoder's verdict at the idle timeout
+static int round_trip(ManchesterDecoder* dec, const uint8_t* data, uint16_t length,
+		double half_bit, double jitter){
+	uint32_t n = manchester_host_line(data, length, half_bit, jitter, intervals, MAX_INTERVALS);
+	for(uint32_t i=0;i<n;i++){
+		if(manchester_decoder_edge(dec, intervals[i]) < 0){
+			return -1;
+		}
+	}
+	return manchester_decoder_idle(dec);
+}
+
+static void test_patterns(){
+	static const uint8_t patterns[][4] = {
+		{0x00, 0x00, 0x00, 0x00},
+		{0xFF, 0xFF, 0xFF, 0xFF},
+		{0x55, 0x55, 0xAA, 0xAA},
+		{0x01, 0x80, 0x7F, 0xFE},
+	};
+	static const uint32_t rates[] = {NIC_MIN_BITRATE, NIC_DEFAULT_BITRATE, 100000, NIC_MAX_BITRATE};
+	ManchesterDecoder dec;
+
+	for(uint32_t r=0;r<sizeof(rates)/sizeof(rates[0]);r++){
+		for(uint32_t p=0;p<sizeof(patterns)/sizeof(patterns[0]);p++){
+			memset(received, 0, sizeof(received));
+			manchester_decoder_start(&dec, received, sizeof(received));
+			CHECK_EQ(round_trip(&dec, patterns[p], 4, half_bit_ticks(rates[r]), 0), 4);
+			CHECK(memcmp(received, patterns[p], 4) == 0);
+		}
+	}
+}
+
+//random frames from a sender whose clock is off by drift, returns how many failed
+static uint32_t random_frames(double half_bit, double jitter){
+	static const double drift[] = {0.95, 1.0, 1.05};
+	uint8_t frame[NIC_MAX_FRAME];
+	ManchesterDecoder dec;
+	uint32_t bad = 0;
+
+	manchester_host_seed(1);
+	for(uint32_t i=0;i<FRAMES;i++){
+		uint16_t length = 1 + next_random() % NIC_MAX_FRAME;
+		for(uint32_t j=0;j<length;j++){
+			frame[j] = next_random();
+		}
+		double sender = half_bit*drift[i % 3];
+		manchester_decoder_start(&dec, received, sizeof(received));
+		int result = round_trip(&dec, frame, length, sender, jitter >= 0 ? jitter : sender/10);
+		if(result != length || memcmp(received, frame, length) != 0){
+			bad++;
+		}
+	}
+	return bad;
+}
+
+static void test_jitter_and_drift(){
+	CHECK_EQ(random_frames(half_bit_ticks(NIC_DEFAULT_BITRATE), -1), 0);
+}
+
+//at NIC_MAX_BITRATE an edge is only moved by its capture to a tick
+static void test_max_bitrate(){
+	CHECK_EQ(half_bit_ticks(NIC_MAX_BITRATE), NIC_MIN_HALF_BIT);
+	CHECK_EQ(random_frames(NIC_MIN_HALF_BIT, 0.5), 0);
+}
+
+static void test_skip(){
+	static const uint8_t frame[] = {0x12, 0x34, 0x56, 0x78};
+	double half_bit = half_bit_ticks(NIC_DEFAULT_BITRATE);
+	ManchesterDecoder dec;
+	manchester_decoder_start(&dec, received, sizeof(received));
+
+	//filtered after the first byte, the rest of the frame is ignored
+	uint32_t n = manchester_host_line(frame, sizeof(frame), half_bit, 0, intervals, MAX_INTERVALS);
+	uint32_t i = 0;
+	while(dec.length < 1){
+		CHECK_EQ(manchester_decoder_edge(&dec, intervals[i++]), 0);
+	}
+	manchester_decoder_skip(&dec);
+	while(i < n){
+		CHECK_EQ(manchester_decoder_edge(&dec, intervals[i++]), 0);
+	}
+	CHECK_EQ(manchester_decoder_idle(&dec), 0);
+	CHECK_EQ(round_trip(&dec, frame, sizeof(frame), half_bit, 0), sizeof(frame));
+
+	//an edge lost in the preamble or the data, as the NIC handles an overcapture
+	for(uint32_t lost=1;lost<n;lost+=5){
+		manchester_decoder_start(&dec, received, sizeof(received));
+		for(i=0;i<n;i++){
+			if(i == lost){
+				manchester_decoder_skip(&dec);
+				intervals[i+1] += intervals[i];
+			}else{
+				manchester_decoder_edge(&dec, intervals[i]);
+			}
+		}
+		CHECK_EQ(manchester_decoder_idle(&dec), 0);
+		CHECK_EQ(round_trip(&dec, frame, sizeof(frame), half_bit, 0), sizeof(frame));
+		CHECK(memcmp(received, frame, sizeof(frame)) == 0);
+	}
+}
+
+int main(){
+	test_patterns();
+	test_jitter_and_drift();
+	test_max_bitrate();
+	test_skip();
+	return test_result("test_manchester");
+}
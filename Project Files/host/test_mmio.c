@@ -0,0 +1,165 @@
+/*
+ * test_mmio.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the register models in mmio_host.c against the behaviour the
+ * reference manual gives for the flags the drivers wait on.
+ */
+
+#include "test.h"
+#include "mmio.h"
+#include "timer.h"
+#include "ADC.h"
+#include "RTC.h"
+#include "uart_driver.h"
+
+#define RTC_REG(field) ((volatile uint32_t*)(RTC_BASE+offsetof(RTC_Struct, field)))
+#define NS_PER_MS 1000000ull
+#define NS_PER_S 1000000000ull
+
+static void test_usart(){
+	mmio_host_init();
+
+	uint32_t sr = REG_READ(USART_SR);
+	CHECK(sr & (1<<TXE));
+	CHECK(sr & (1<<TC));
+	CHECK((sr & (1<<RXNE)) == 0);
+
+	//received bytes come out of DR in order, RXNE follows the input
+	mmio_usart2_input("ab", 2);
+	CHECK(REG_READ(USART_SR) & (1<<RXNE));
+	CHECK_EQ(REG_READ(USART_DR), 'a');
+	CHECK(REG_READ(USART_SR) & (1<<RXNE));
+	CHECK_EQ(REG_READ(USART_DR), 'b');
+	CHECK((REG_READ(USART_SR) & (1<<RXNE)) == 0);
+
+	//IDLE is cleared by an SR read followed by a DR read
+	*(USART_SR) |= 1<<IDLE;
+	CHECK(REG_READ(USART_SR) & (1<<IDLE));
+	REG_READ(USART_DR);
+	CHECK((REG_READ(USART_SR) & (1<<IDLE)) == 0);
+
+	//transmitted bytes are captured
+	REG_WRITE(USART_DR, 'x');
+	REG_WRITE(USART_DR, 'y');
+	char out[4];
+	CHECK_EQ(mmio_usart2_output(out, sizeof(out)), 2);
+	CHECK_EQ(out[0], 'x');
+	CHECK_EQ(out[1], 'y');
+	CHECK_EQ(mmio_usart2_output(out, sizeof(out)), 0);
+}
+
+static void test_adc(){
+	mmio_host_init();
+	mmio_adc_input(1234);
+
+	//no conversion while the ADC is off
+	REG_WRITE(ADC_CR2, 1u<<ADC_SWSTART);
+	CHECK((REG_READ(ADC_SR) & (1<<ADC_EOC)) == 0);
+
+	REG_WRITE(ADC_CR2, 1<<ADC_ADON);
+	REG_WRITE(ADC_CR2, (1<<ADC_ADON) | (1u<<ADC_SWSTART));
+	CHECK(REG_READ(ADC_SR) & (1<<ADC_EOC));
+	CHECK((REG_READ(ADC_CR2) & (1u<<ADC_SWSTART)) == 0);		//cleared by hardware
+
+	//reading DR clears EOC
+	CHECK_EQ(REG_READ(ADC_DR), 1234);
+	CHECK((REG_READ(ADC_SR) & (1<<ADC_EOC)) == 0);
+
+	//status bits are cleared by writing 0
+	mmio_adc_input(0xFFFF);
+	REG_WRITE(ADC_CR2, (1<<ADC_ADON) | (1u<<ADC_SWSTART));
+	REG_WRITE(ADC_SR, ~(1u<<ADC_EOC));
+	CHECK((REG_READ(ADC_SR) & (1<<ADC_EOC)) == 0);
+	CHECK_EQ(REG_READ(ADC_DR), 0xFFF);		//12 bit
+}
+
+static void test_rtc(){
+	mmio_host_init();
+
+	RTC_Date date = {2, 0x12, 0x31, 0x26};
+	RTC_Time time = {0x11, 0x59, 0x15, 1};		//11:59:15 PM
+	init_rtc(&date, &time);
+	CHECK((REG_READ(RTC_REG(ISR)) & (1<<INIT)) == 0);
+	CHECK_EQ(REG_READ(RTC_REG(TR)), 0x00115915 | (1<<PM));
+	CHECK_EQ(REG_READ(RTC_REG(DR)) & 0xFF1F3F, 0x261231);
+
+	//the calendar runs from the emulated clock once INIT is cleared
+	mmio_advance_ns(30*NS_PER_S);
+	CHECK_EQ(REG_READ(RTC_REG(TR)), 0x00115945 | (1<<PM));
+	mmio_advance_ns(15*NS_PER_S);
+	CHECK_EQ(REG_READ(RTC_REG(TR)), 0x00120000);		//12:00:00 AM
+	CHECK_EQ(REG_READ(RTC_REG(DR)) & 0xFF1F3F, 0x270101);
+
+	//the driver decodes the same time
+	rtc_clock_init();
+	RTC_Clock clock;
+	rtc_get_clock(&clock);
+	CHECK_EQ(clock.hours, 0);
+	CHECK_EQ(clock.minutes, 0);
+	CHECK_EQ(clock.day, 1);
+	CHECK_EQ(clock.month, 1);
+	CHECK_EQ(clock.year, 27);
+
+	//init mode freezes the calendar
+	REG_SET(RTC_REG(ISR), 1<<INIT);
+	CHECK(REG_READ(RTC_REG(ISR)) & (1<<INITF));
+	mmio_advance_ns(10*NS_PER_S);
+	CHECK_EQ(REG_READ(RTC_REG(TR)), 0x00120000);
+	REG_CLEAR(RTC_REG(ISR), 1<<INIT);
+	mmio_advance_ns(NS_PER_S);
+	CHECK_EQ(REG_READ(RTC_REG(TR)), 0x00120001);
+}
+
+static void test_systick(){
+	mmio_host_init();
+
+	*(STK_LOAD) = (SYSCLK_HZ/1000)-1;
+	REG_WRITE(STK_VAL, 0);
+	CHECK((REG_READ(STK_CTRL) & (1<<STK_CNTFLAG_F)) == 0);	//not running
+
+	REG_WRITE(STK_CTRL, (1<<STK_ENABLE_F) | (1<<STK_CLKSOURCE_F));
+	CHECK(REG_READ(STK_VAL) <= *(STK_LOAD));
+
+	//COUNTFLAG is set by a wrap and cleared by the read that returns it
+	mmio_advance_ns(NS_PER_MS);
+	CHECK(REG_READ(STK_CTRL) & (1<<STK_CNTFLAG_F));
+	CHECK((REG_READ(STK_CTRL) & (1<<STK_CNTFLAG_F)) == 0);
+
+	//several wraps between reads still set it once
+	mmio_advance_ns(5*NS_PER_MS);
+	CHECK(REG_READ(STK_CTRL) & (1<<STK_CNTFLAG_F));
+	CHECK((REG_READ(STK_CTRL) & (1<<STK_CNTFLAG_F)) == 0);
+
+	//writing VAL restarts the count
+	mmio_advance_ns(NS_PER_MS/2);
+	REG_WRITE(STK_VAL, 0);
+	mmio_advance_ns(NS_PER_MS/2);
+	CHECK((REG_READ(STK_CTRL) & (1<<STK_CNTFLAG_F)) == 0);
+}
+
+static void test_cycle_counter(){
+	mmio_host_init();
+
+	timer_init();
+	uint64_t start = now_us();
+	mmio_advance_ns(5*NS_PER_MS);
+	uint64_t elapsed = now_us() - start;
+	CHECK(elapsed >= 5000);
+	CHECK(elapsed < 5000 + 100000);		//the host clock also runs
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("test_mmio: cannot map the register file\n");
+		return 1;
+	}
+	test_usart();
+	test_adc();
+	test_rtc();
+	test_systick();
+	test_cycle_counter();
+	return test_result("test_mmio");
+}
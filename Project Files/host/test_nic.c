@@ -0,0 +1,203 @@
+/*
+ * test_nic.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Runs the NIC on several nodes of the host bus simulator. Nodes 0 and
+ * 1 send and node 2 only listens; every node also hears itself. A frame
+ * sent alone arrives everywhere, a send onto a busy line waits for it
+ * to go idle, two sends started together collide, back off and both
+ * arrive, and a frame that collides on every attempt is dropped after
+ * NIC_MAX_ATTEMPTS. Every frame a node receives is read before the
+ * next case so the shared pool does not run dry.
+ */
+
+#include "test.h"
+#include "nic.h"
+#include <string.h>
+
+#define BITRATE 100000
+#define BIT_TICKS (SYSCLK_HZ/BITRATE)
+#define FRAME_LENGTH 16
+#define RUN_STEP 100
+#define RUN_LIMIT 4000000		//ticks, longer than the worst backoff sequence
+#define LISTENER 2
+
+static const uint8_t frames[2][FRAME_LENGTH] = {
+	"node 0 is here!",
+	"and node 1 too",
+};
+
+static NIC_Stats before[NIC_HOST_NODES];	//counters when the case started
+static uint32_t received;			//bit n set if frame n arrived
+static uint32_t order[4];			//frames in the order they arrived
+static uint32_t unexpected;
+
+//runs until nothing is queued and every node sees an idle line
+static int settle(){
+	for(uint32_t t=0;t<RUN_LIMIT;t+=RUN_STEP){
+		nic_host_run(RUN_STEP);
+		uint32_t busy = 0;
+		for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+			const NicHostNode* node = nic_host_node(n);
+			busy += node->tx_pending() != 0 || node->channel_state() != CH_IDLE;
+		}
+		if(!busy){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//reads every frame waiting at node n, returns how many there were
+static uint32_t collect(uint32_t n){
+	uint8_t data[NIC_MAX_FRAME];
+	uint32_t count = 0;
+	received = 0;
+	uint32_t length;
+	while((length = nic_host_node(n)->receive(data, sizeof(data))) != 0){
+		uint32_t match = 0;
+		for(uint32_t f=0;f<2;f++){
+			if(length == FRAME_LENGTH && memcmp(data, frames[f], FRAME_LENGTH) == 0){
+				received |= 1<<f;
+				match = 1;
+				if(count < 4){
+					order[count] = f;
+				}
+			}
+		}
+		unexpected += !match;
+		count++;
+	}
+	return count;
+}
+
+static void drain(){
+	for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+		collect(n);
+	}
+}
+
+static void start(){
+	CHECK_EQ(nic_host_init(BITRATE), 0);
+	for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+		before[n] = *nic_host_node(n)->stats();
+	}
+	unexpected = 0;
+}
+
+//node n's counters since the case started, nic_init does not clear them
+static NIC_Stats since(uint32_t n){
+	NIC_Stats s = *nic_host_node(n)->stats();
+	uint32_t* now = (uint32_t*)&s;
+	const uint32_t* then = (const uint32_t*)&before[n];
+	for(uint32_t i=0;i<sizeof(NIC_Stats)/sizeof(uint32_t);i++){
+		now[i] -= then[i];
+	}
+	return s;
+}
+
+static void test_single_frame(){
+	start();
+	CHECK_EQ(nic_host_node(0)->send(frames[0], FRAME_LENGTH), 1);
+	nic_host_run(4*BIT_TICKS);
+	CHECK_EQ(nic_host_node(LISTENER)->channel_state(), CH_BUSY);
+	CHECK(settle());
+
+	for(uint32_t n=0;n<NIC_HOST_NODES;n++){
+		CHECK_EQ(collect(n), 1);
+		CHECK_EQ(received, 1);
+		CHECK_EQ(since(n).rx_errors, 0);
+	}
+	CHECK_EQ(since(0).frames_sent, 1);
+	CHECK_EQ(since(0).collisions, 0);
+	CHECK_EQ(unexpected, 0);
+}
+
+static void test_carrier_sense(){
+	start();
+	CHECK_EQ(nic_host_node(0)->send(frames[0], FRAME_LENGTH), 1);
+	nic_host_run(20*BIT_TICKS);
+	CHECK_EQ(nic_host_node(1)->channel_state(), CH_BUSY);
+	CHECK_EQ(nic_host_node(1)->send(frames[1], FRAME_LENGTH), 1);
+	CHECK(settle());
+
+	NIC_Stats s0 = since(0);
+	NIC_Stats s1 = since(1);
+	CHECK_EQ(s1.deferrals, 1);
+	CHECK_EQ(s0.collisions + s1.collisions, 0);
+	CHECK_EQ(s0.frames_sent, 1);
+	CHECK_EQ(s1.frames_sent, 1);
+
+	//the waiting frame went second
+	CHECK_EQ(collect(LISTENER), 2);
+	CHECK_EQ(received, 3);
+	CHECK_EQ(order[0], 0);
+	CHECK_EQ(order[1], 1);
+	drain();
+	CHECK_EQ(unexpected, 0);
+}
+
+static void test_collision_and_backoff(){
+	//started on the same tick, and a quarter bit apart before either is heard
+	static const uint32_t offsets[] = {0, BIT_TICKS/4};
+	for(uint32_t i=0;i<sizeof(offsets)/sizeof(offsets[0]);i++){
+		start();
+		CHECK_EQ(nic_host_node(0)->send(frames[0], FRAME_LENGTH), 1);
+		nic_host_run(offsets[i]);
+		CHECK_EQ(nic_host_node(1)->send(frames[1], FRAME_LENGTH), 1);
+		CHECK(settle());
+
+		NIC_Stats s0 = since(0);
+		NIC_Stats s1 = since(1);
+		CHECK(s0.collisions + s1.collisions > 0);
+		CHECK_EQ(s0.frames_sent, 1);
+		CHECK_EQ(s1.frames_sent, 1);
+		CHECK_EQ(s0.tx_aborted + s1.tx_aborted, 0);
+
+		CHECK_EQ(collect(LISTENER), 2);
+		CHECK_EQ(received, 3);
+		drain();
+	}
+	CHECK_EQ(unexpected, 0);
+}
+
+static void test_retry_limit(){
+	start();
+
+	//a node that ignores carrier sense pulls the line low for a bit
+	//after every 2.5 bits of quiet, just past the idle timeout
+	nic_host_jam(7*BIT_TICKS/2, BIT_TICKS);
+	CHECK_EQ(nic_host_node(0)->send(frames[0], FRAME_LENGTH), 1);
+	for(uint32_t t=0;t<RUN_LIMIT && nic_host_node(0)->tx_pending();t+=RUN_STEP){
+		nic_host_run(RUN_STEP);
+	}
+
+	NIC_Stats s0 = since(0);
+	CHECK_EQ(nic_host_node(0)->tx_pending(), 0);
+	CHECK_EQ(s0.collisions, NIC_MAX_ATTEMPTS);
+	CHECK_EQ(s0.tx_aborted, 1);
+	CHECK_EQ(s0.frames_sent, 0);
+
+	//the node carries on once the line is quiet
+	nic_host_jam(0, 0);
+	CHECK(settle());
+	drain();
+	CHECK_EQ(nic_host_node(0)->send(frames[0], FRAME_LENGTH), 1);
+	CHECK(settle());
+	s0 = since(0);
+	CHECK_EQ(s0.frames_sent, 1);
+	CHECK_EQ(s0.collisions, NIC_MAX_ATTEMPTS);
+	CHECK_EQ(collect(LISTENER), 1);
+	CHECK_EQ(received, 1);
+	drain();
+}
+
+int main(){
+	test_single_frame();
+	test_carrier_sense();
+	test_collision_and_backoff();
+	test_retry_limit();
+	return test_result("test_nic");
+}
@@ -0,0 +1,126 @@
+/*
+ * test_pbuf.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the packet buffer pool: running it dry and refilling it, the
+ * reference count and the headroom and tailroom edits. The pool has no
+ * reset, so every case gives back what it takes and the counters are
+ * compared with their values when the case started.
+ */
+
+#include "test.h"
+#include "pbuf.h"
+#include <string.h>
+
+static void test_exhaustion(){
+	PacketBuf* held[PBUF_COUNT];
+	uint32_t failures = pbuf_stats()->alloc_failures;
+
+	for(uint32_t i=0;i<PBUF_COUNT;i++){
+		held[i] = pbuf_alloc();
+		CHECK(held[i] != NULL);
+		for(uint32_t j=0;j<i;j++){
+			CHECK(held[i] != held[j]);
+		}
+	}
+	CHECK_EQ(pbuf_stats()->in_use, PBUF_COUNT);
+	CHECK_EQ(pbuf_stats()->high_water, PBUF_COUNT);
+
+	//an empty pool fails and counts it
+	CHECK(pbuf_alloc() == NULL);
+	CHECK(pbuf_alloc() == NULL);
+	CHECK_EQ(pbuf_stats()->alloc_failures, failures+2);
+
+	//a freed buffer is the next one handed out, reset
+	PacketBuf* p = held[5];
+	pbuf_append(p, 10);
+	pbuf_free(p);
+	CHECK_EQ(pbuf_stats()->in_use, PBUF_COUNT-1);
+	held[5] = pbuf_alloc();
+	CHECK(held[5] == p);
+	CHECK_EQ(p->length, 0);
+	CHECK_EQ(p->offset, PBUF_HEADROOM);
+	CHECK_EQ(p->refs, 1);
+
+	for(uint32_t i=0;i<PBUF_COUNT;i++){
+		pbuf_free(held[i]);
+	}
+	CHECK_EQ(pbuf_stats()->in_use, 0);
+	CHECK_EQ(pbuf_stats()->high_water, PBUF_COUNT);
+	CHECK_EQ(pbuf_stats()->alloc_failures, failures+2);
+	pbuf_free(NULL);
+	CHECK_EQ(pbuf_stats()->in_use, 0);
+}
+
+static void test_refcount(){
+	PacketBuf* p = pbuf_alloc();
+	CHECK(p != NULL);
+	pbuf_ref(p);
+	CHECK_EQ(p->refs, 2);
+
+	//the first owner lets go, the buffer stays out of the pool
+	pbuf_free(p);
+	CHECK_EQ(p->refs, 1);
+	CHECK_EQ(pbuf_stats()->in_use, 1);
+	PacketBuf* rest[PBUF_COUNT];
+	uint32_t n = 0;
+	while(n < PBUF_COUNT && (rest[n] = pbuf_alloc()) != NULL){
+		CHECK(rest[n] != p);
+		n++;
+	}
+	CHECK_EQ(n, PBUF_COUNT-1);
+	for(uint32_t i=0;i<n;i++){
+		pbuf_free(rest[i]);
+	}
+
+	//the second returns it
+	pbuf_free(p);
+	CHECK_EQ(pbuf_stats()->in_use, 0);
+}
+
+static void test_headroom(){
+	PacketBuf* p = pbuf_alloc();
+	CHECK(p != NULL);
+	CHECK(pbuf_data(p) == &p->data[PBUF_HEADROOM]);
+
+	uint8_t* payload = pbuf_append(p, 4);
+	CHECK(payload == &p->data[PBUF_HEADROOM]);
+	memcpy(payload, "data", 4);
+
+	//a header goes in front without moving the payload
+	uint8_t* header = pbuf_push(p, 3);
+	CHECK(header == payload-3);
+	memcpy(header, "hdr", 3);
+	CHECK_EQ(p->length, 7);
+	CHECK(memcmp(pbuf_data(p), "hdrdata", 7) == 0);
+	CHECK(pbuf_push(p, PBUF_HEADROOM-3+1) == NULL);
+	CHECK(pbuf_push(p, PBUF_HEADROOM-3) == p->data);
+	CHECK(pbuf_push(p, 1) == NULL);
+
+	//and comes off again
+	CHECK(pbuf_pull(p, PBUF_HEADROOM-3) == header);
+	CHECK(pbuf_pull(p, 3) == payload);
+	CHECK(pbuf_pull(p, 5) == NULL);
+	CHECK_EQ(p->length, 4);
+
+	//the tail stops at the end of the buffer
+	CHECK(pbuf_append(p, PBUF_SIZE-PBUF_HEADROOM-4+1) == NULL);
+	CHECK(pbuf_append(p, PBUF_SIZE-PBUF_HEADROOM-4) == payload+4);
+	CHECK(pbuf_append(p, 1) == NULL);
+	pbuf_trim(p, PBUF_SIZE-PBUF_HEADROOM-4);
+	CHECK_EQ(p->length, 4);
+	pbuf_trim(p, 10);
+	CHECK_EQ(p->length, 0);
+
+	pbuf_free(p);
+	CHECK_EQ(pbuf_stats()->in_use, 0);
+}
+
+int main(){
+	test_exhaustion();
+	test_refcount();
+	test_headroom();
+	return test_result("test_pbuf");
+}
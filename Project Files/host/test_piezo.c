@@ -0,0 +1,117 @@
+/*
+ * test_piezo.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the note period table and the tone period against the equal
+ * tempered scale, 261.63*2^(steps/12) from C4. piezo.c is built into
+ * this file so its static helpers can be called. Every period must be
+ * the nearest whole number of timer ticks, so the only error left is
+ * the tick size, which is largest for the highest notes.
+ */
+
+#include "test.h"
+#include <math.h>
+#include "../src/piezo.c"
+
+#define C4_HZ 261.63
+#define MAX_NOTE_CENTS 13.5		//half a tick of B8's 60 tick period
+#define MAX_TONE_CENTS 9.5		//half a tick at 5 kHz, 94 ticks
+
+//semitones from C4
+static int steps_from_c4(Letter letter, Accidental accidental, int octave){
+	return letter_semitones[letter] + accidental + 12*(octave-4);
+}
+
+//half cycle in timer ticks for a frequency, not rounded
+static double exact_period(double hz){
+	return PIEZO_TICK_HZ/(2*hz);
+}
+
+static double cents(double hz, double reference){
+	return fabs(1200*log2(hz/reference));
+}
+
+static void test_note_table(){
+	double worst = 0;
+	uint32_t notRounded = 0;
+	for(int octave=0;octave<PIEZO_OCTAVES;octave++){
+		for(Letter letter=C;letter<REST;letter++){
+			for(int accidental=FLAT;accidental<=SHARP;accidental++){
+				int steps = steps_from_c4(letter, accidental, octave);
+				if(steps < -4*12 || steps >= 5*12){
+					continue;		//Cb0 and B#8, checked below
+				}
+				Note note = {letter, accidental, octave, 100};
+				uint32_t period = note_period(&note);
+				double hz = C4_HZ*pow(2, steps/12.0);
+				double exact = exact_period(hz);
+
+				notRounded += fabs(period - exact) > 0.5 + 1e-3;
+				double error = cents(PIEZO_TICK_HZ/(2.0*period), hz);
+				if(error > worst){
+					worst = error;
+				}
+			}
+		}
+	}
+	CHECK_EQ(notRounded, 0);
+	CHECK(worst <= MAX_NOTE_CENTS);
+	printf("test_piezo: notes within %.2f cents\n", worst);
+}
+
+static void test_accidentals_cross_octaves(){
+	Note bSharp3 = {B, SHARP, 3, 100};
+	Note c4 = {C, NATURAL, 4, 100};
+	Note cFlat4 = {C, FLAT, 4, 100};
+	Note b3 = {B, NATURAL, 3, 100};
+	CHECK_EQ(note_period(&bSharp3), note_period(&c4));
+	CHECK_EQ(note_period(&cFlat4), note_period(&b3));
+
+	Note eSharp4 = {E, SHARP, 4, 100};
+	Note f4 = {F, NATURAL, 4, 100};
+	CHECK_EQ(note_period(&eSharp4), note_period(&f4));
+
+	//off the ends of the table, and rests, are silent
+	Note cFlat0 = {C, FLAT, 0, 100};
+	Note bSharp8 = {B, SHARP, 8, 100};
+	Note c9 = {C, NATURAL, 9, 100};
+	Note rest = {REST, NATURAL, 4, 100};
+	CHECK_EQ(note_period(&cFlat0), 0);
+	CHECK_EQ(note_period(&bSharp8), 0);
+	CHECK_EQ(note_period(&c9), 0);
+	CHECK_EQ(note_period(&rest), 0);
+}
+
+static void test_tone_period(){
+	double worst = 0;
+	uint32_t notRounded = 0;
+	for(uint32_t hz=20;hz<=5000;hz++){
+		uint32_t period = tone_period(PIEZO_HZ(hz));
+		notRounded += fabs(period - exact_period(hz)) > 0.5 + 1e-3;
+		double error = cents(PIEZO_TICK_HZ/(2.0*period), hz);
+		if(error > worst){
+			worst = error;
+		}
+	}
+	CHECK_EQ(notRounded, 0);
+	CHECK(worst <= MAX_TONE_CENTS);
+	printf("test_piezo: tones from 20 Hz to 5 kHz within %.2f cents\n", worst);
+
+	//fractions of a hertz are kept
+	CHECK_EQ(tone_period(PIEZO_HZ(C4_HZ)), note_period(&(Note){C, NATURAL, 4, 100}));
+
+	//silence, and frequencies whose period does not fit the 16 bit ARR
+	CHECK_EQ(tone_period(0), 0);
+	CHECK_EQ(tone_period(PIEZO_HZ(6)), 0);
+	CHECK(tone_period(PIEZO_HZ(8)) > 0);
+	CHECK_EQ(tone_period(0xFFFFFFFF), 0);
+}
+
+int main(){
+	test_note_table();
+	test_accidentals_cross_octaves();
+	test_tone_period();
+	return test_result("test_piezo");
+}
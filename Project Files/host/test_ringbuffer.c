@@ -0,0 +1,125 @@
+/*
+ * test_ringbuffer.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Runs the producer and the consumer of one ring buffer on two threads,
+ * as the ISR and the main loop share it on the target, and checks that
+ * every byte comes out once and in order. Both sides mix single and
+ * bulk calls of changing sizes so the wrap point lands everywhere, and
+ * the counters start just below their own wrap. A side that makes no
+ * progress yields, so the test also runs on a single core.
+ */
+
+#include "test.h"
+#include "ringbuffer.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define BYTES 16000000u
+#define COUNTER_START (0u - 1000u)
+
+static volatile RingBuffer rb;
+static volatile uint32_t overfull;		//rb_count seen above BUF_SIZE
+
+//not periodic in 256, so a lost or repeated lap of the buffer shows
+static uint8_t pattern(uint32_t i){
+	return i ^ (i>>8) ^ (i>>16);
+}
+
+static void* producer(void* arg){
+	uint8_t block[BUF_SIZE+7];
+	uint32_t sent = 0;
+	uint32_t step = 0;
+	while(sent < BYTES){
+		if(rb_count(&rb) > BUF_SIZE){
+			overfull++;
+		}
+		step++;
+		uint32_t n;
+		if(step % 3 == 0){
+			n = rb_try_put(&rb, pattern(sent));
+		}else{
+			n = 1 + (step*7919) % sizeof(block);
+			if(n > BYTES - sent){
+				n = BYTES - sent;
+			}
+			for(uint32_t i=0;i<n;i++){
+				block[i] = pattern(sent+i);
+			}
+			n = rb_put_n(&rb, block, n);
+		}
+		if(n == 0){
+			sched_yield();
+		}
+		sent += n;
+	}
+	return NULL;
+}
+
+static void test_two_threads(){
+	rb.put = rb.get = COUNTER_START;
+	pthread_t thread;
+	pthread_create(&thread, NULL, producer, NULL);
+
+	uint8_t block[BUF_SIZE+13];
+	uint32_t received = 0;
+	uint32_t wrong = 0;
+	uint32_t step = 0;
+	while(received < BYTES){
+		step++;
+		uint32_t n;
+		if(step % 4 == 0){
+			n = rb_try_get(&rb, block);
+		}else{
+			n = rb_get_n(&rb, block, 1 + (step*104729) % sizeof(block));
+		}
+		if(n == 0){
+			sched_yield();
+		}
+		for(uint32_t i=0;i<n;i++){
+			wrong += block[i] != pattern(received+i);
+		}
+		received += n;
+	}
+	pthread_join(thread, NULL);
+
+	CHECK_EQ(wrong, 0);
+	CHECK_EQ(received, BYTES);
+	CHECK_EQ(rb_count(&rb), 0);
+	CHECK_EQ(rb.put, COUNTER_START + BYTES);
+	CHECK_EQ(overfull, 0);
+}
+
+static void test_full_and_empty(){
+	rb.put = rb.get = COUNTER_START;
+	uint8_t b;
+	CHECK_EQ(rb_try_get(&rb, &b), 0);
+	CHECK_EQ(rb_space(&rb), BUF_SIZE);
+
+	uint8_t block[BUF_SIZE+1];
+	for(uint32_t i=0;i<sizeof(block);i++){
+		block[i] = i;
+	}
+	CHECK_EQ(rb_put_n(&rb, block, sizeof(block)), BUF_SIZE);
+	CHECK_EQ(rb_try_put(&rb, 0), 0);
+	CHECK_EQ(rb_space(&rb), 0);
+	CHECK(hasElement(&rb));
+	CHECK(!hasSpace(&rb));
+
+	CHECK_EQ(get(&rb), 0);
+	CHECK_EQ(rb_try_put(&rb, 0xAB), 1);
+	uint8_t out[BUF_SIZE+1];
+	CHECK_EQ(rb_get_n(&rb, out, sizeof(out)), BUF_SIZE);
+	CHECK_EQ(out[0], 1);
+	CHECK_EQ(out[BUF_SIZE-2], BUF_SIZE-1);
+	CHECK_EQ(out[BUF_SIZE-1], 0xAB);
+	CHECK(!hasElement(&rb));
+}
+
+int main(){
+	test_full_and_empty();
+	test_two_threads();
+	return test_result("test_ringbuffer");
+}
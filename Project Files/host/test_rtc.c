@@ -0,0 +1,162 @@
+/*
+ * test_rtc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the RTC time stamps against the emulated calendar, and the
+ * time stamp capture. The capture registers are plain memory on the
+ * host, so an edge is made by writing TSTR, TSDR and TSSSR and setting
+ * TSF before calling the interrupt handler.
+ */
+
+#include "test.h"
+#include "mmio.h"
+#include "RTC.h"
+#include "irq.h"
+
+#define NS_PER_S 1000000000ull
+#define RTC_REGS ((volatile RTC_Struct*)RTC_BASE)
+#define MAX_CAPTURES 4
+
+extern void TAMP_STAMP_IRQHandler(void);
+
+static RTC_Stamp captured[MAX_CAPTURES];
+static uint32_t captures;
+
+//BCD values and a 12 hour clock, as init_rtc takes them
+static void set_calendar(uint8_t year, uint8_t month, uint8_t day, uint8_t hours, uint8_t minutes, uint8_t seconds, uint8_t pm){
+	RTC_Date date = {1, month, day, year};
+	RTC_Time time = {hours, minutes, seconds, pm};
+	init_rtc(&date, &time);
+	rtc_clock_init();
+}
+
+static void set_clock(uint8_t hours){
+	set_calendar(0x26, 0x10, 0x17, hours, 0x00, 0x00, 0);
+}
+
+static void on_stamp(RTC_Stamp stamp){
+	if(captures < MAX_CAPTURES){
+		captured[captures] = stamp;
+	}
+	captures++;
+}
+
+//latches an edge as the RTC does, TR and DR layout without the year.
+//The calendar runs in AM/PM mode, so midnight is 12 AM.
+static void edge(uint32_t tr, uint32_t month_day, uint32_t ssr, int overrun){
+	RTC_REGS->TSTR = tr;
+	RTC_REGS->TSDR = month_day;
+	RTC_REGS->TSSSR = ssr;
+	RTC_REGS->ISR |= (1<<TSF) | (overrun ? 1<<TSOVF : 0);
+	TAMP_STAMP_IRQHandler();
+}
+
+static void test_stamps_follow_a_new_setting(){
+	mmio_host_init();
+	set_clock(0x11);
+	RTC_Stamp first = rtc_stamp_now();
+	RTC_Clock clock;
+	rtc_stamp_to_clock(first, &clock);
+	CHECK_EQ(clock.hours, 11);
+	CHECK_EQ(clock.day, 17);
+
+	mmio_advance_ns(2*NS_PER_S);
+	RTC_Stamp later = rtc_stamp_now();
+	CHECK(later > first);
+	CHECK_EQ(rtc_stamp_diff_us(later, first), 2000000);
+
+	//set back an hour, stamps must not stay clamped to the old setting
+	set_clock(0x10);
+	RTC_Stamp after = rtc_stamp_now();
+	rtc_stamp_to_clock(after, &clock);
+	CHECK_EQ(clock.hours, 10);
+	CHECK_EQ(rtc_stamp_seconds(later) - rtc_stamp_seconds(after), 3600+2);
+
+	mmio_advance_ns(NS_PER_S);
+	CHECK(rtc_stamp_now() > after);
+}
+
+static void test_conversions(){
+	uint64_t us = 814000123456ull;
+	CHECK_EQ(rtc_stamp_to_us(rtc_stamp_from_us(us)), us);
+	CHECK_EQ(rtc_stamp_diff_us(rtc_stamp_from_us(5), rtc_stamp_from_us(1000005)), -1000000);
+}
+
+static void test_capture(){
+	mmio_host_init();
+	set_clock(0x11);
+	captures = 0;
+	uint32_t overruns = rtc_stamp_overruns();
+	rtc_stamp_capture_enable(on_stamp);
+	CHECK_EQ(RTC_REGS->CR & ((1<<TSE)|(1<<TSIE)|(1<<TSEDGE)), (1<<TSE)|(1<<TSIE));
+	CHECK(*(EXTI_IMR) & (1<<RTC_STAMP_EXTI));
+	CHECK(*(EXTI_RTSR) & (1<<RTC_STAMP_EXTI));
+	CHECK(*(NVIC_ISER0) & (1<<RTC_STAMP_IRQ));
+
+	//11:00:05 and half a second, SSR counts down from SYNCHPREDIV
+	edge(0x110005, 0x1017, (SYNCHPREDIV+1)/2 - 1, 0);
+	CHECK_EQ(captures, 1);
+	RTC_Clock clock;
+	rtc_stamp_to_clock(captured[0], &clock);
+	CHECK_EQ(clock.year, 26);
+	CHECK_EQ(clock.month, 10);
+	CHECK_EQ(clock.day, 17);
+	CHECK_EQ(clock.hours, 11);
+	CHECK_EQ(clock.minutes, 0);
+	CHECK_EQ(clock.seconds, 5);
+	CHECK_EQ((uint32_t)captured[0], 0x80000000u);
+	CHECK_EQ(RTC_REGS->ISR & (1<<TSF), 0);
+	CHECK_EQ(rtc_stamp_overruns(), overruns);
+
+	//a second edge before the first was read is counted, TSOVF cleared
+	edge(0x110006, 0x1017, SYNCHPREDIV, 1);
+	CHECK_EQ(captures, 2);
+	CHECK_EQ(rtc_stamp_diff_us(captured[1], captured[0]), 500000);
+	CHECK_EQ(rtc_stamp_overruns(), overruns+1);
+	CHECK_EQ(RTC_REGS->ISR & ((1<<TSF)|(1<<TSOVF)), 0);
+
+	//nothing without TSF
+	TAMP_STAMP_IRQHandler();
+	CHECK_EQ(captures, 2);
+}
+
+static void test_capture_across_new_year(){
+	mmio_host_init();
+
+	//an edge just before midnight read in the new year
+	set_calendar(0x27, 0x01, 0x01, 0x12, 0x00, 0x10, 0);
+	captures = 0;
+	rtc_stamp_capture_enable(on_stamp);
+	edge(0x115959 | (1<<PM), 0x1231, SYNCHPREDIV, 0);
+	RTC_Clock clock;
+	rtc_stamp_to_clock(captured[0], &clock);
+	CHECK_EQ(clock.year, 26);
+	CHECK_EQ(clock.month, 12);
+	CHECK_EQ(clock.day, 31);
+	CHECK_EQ(rtc_stamp_seconds(rtc_stamp_now()) - rtc_stamp_seconds(captured[0]), 11);
+
+	//an edge just after midnight read before the cache turns the year
+	set_calendar(0x26, 0x12, 0x31, 0x11, 0x59, 0x59, 1);
+	rtc_stamp_capture_enable(on_stamp);
+	edge(0x120000, 0x0101, SYNCHPREDIV, 0);
+	CHECK_EQ(captures, 2);
+	rtc_stamp_to_clock(captured[1], &clock);
+	CHECK_EQ(clock.year, 27);
+	CHECK_EQ(clock.month, 1);
+	CHECK_EQ(clock.day, 1);
+	CHECK_EQ(rtc_stamp_seconds(captured[1]) - rtc_stamp_seconds(captured[0]), 1);
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("test_rtc: cannot map the register file\n");
+		return 1;
+	}
+	test_stamps_follow_a_new_setting();
+	test_conversions();
+	test_capture();
+	test_capture_across_new_year();
+	return test_result("test_rtc");
+}
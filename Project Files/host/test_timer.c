@@ -0,0 +1,117 @@
+/*
+ * test_timer.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Drives the timer wheel by calling SysTick_Handler and checks that
+ * callbacks may start and stop other timers due on the same tick.
+ */
+
+#include "test.h"
+#include "mmio.h"
+#include "timer.h"
+
+extern void SysTick_Handler(void);
+
+static SoftTimer a, b, c, d;
+static uint32_t fired[4];
+static uint32_t firedAt[4];
+static void (*onA)(void);
+
+static void count(void* arg){
+	uint32_t i = (uint32_t)(uintptr_t)arg;
+	fired[i]++;
+	firedAt[i] = now_ms();
+	if(i == 0 && onA){
+		onA();
+	}
+}
+
+static void reset(){
+	for(uint32_t i=0;i<4;i++){
+		fired[i] = 0;
+		firedAt[i] = 0;
+	}
+	onA = 0;
+	timer_stop(&a);
+	timer_stop(&b);
+	timer_stop(&c);
+	timer_stop(&d);
+}
+
+static void run(uint32_t ms){
+	for(uint32_t i=0;i<ms;i++){
+		SysTick_Handler();
+	}
+}
+
+//starts c, b, a in that order so a is at the head of the slot
+static void start_three(uint32_t delay){
+	timer_start(&c, delay, 0, count, (void*)2);
+	timer_start(&b, delay, 0, count, (void*)1);
+	timer_start(&a, delay, 0, count, (void*)0);
+}
+
+static void restart_b(){
+	timer_start(&b, 3, 0, count, (void*)1);
+}
+
+static void stop_b(){
+	timer_stop(&b);
+}
+
+static void test_restart_due_timer(){
+	reset();
+	onA = restart_b;
+	uint32_t start = now_ms();
+	start_three(5);
+	run(10);
+	CHECK_EQ(fired[0], 1);
+	CHECK_EQ(fired[1], 1);
+	CHECK_EQ(fired[2], 1);		//was lost when b's link was overwritten
+	CHECK_EQ(firedAt[1] - start, 8);
+}
+
+static void test_stop_due_timer(){
+	reset();
+	onA = stop_b;
+	start_three(5);
+	run(10);
+	CHECK_EQ(fired[0], 1);
+	CHECK_EQ(fired[1], 0);
+	CHECK_EQ(fired[2], 1);
+}
+
+static void test_periodic(){
+	reset();
+	timer_start(&a, 1, 1, count, (void*)0);
+	timer_start(&b, TIMER_WHEEL_SLOTS, TIMER_WHEEL_SLOTS, count, (void*)1);	//same slot every time
+	timer_start(&d, 7, 7, count, (void*)3);
+	run(TIMER_WHEEL_SLOTS*4);
+	CHECK_EQ(fired[0], TIMER_WHEEL_SLOTS*4);
+	CHECK_EQ(fired[1], 4);
+	CHECK_EQ(fired[3], TIMER_WHEEL_SLOTS*4/7);
+}
+
+static void test_one_shot(){
+	reset();
+	timer_start(&a, 2, 0, count, (void*)0);
+	run(2);
+	CHECK_EQ(fired[0], 1);
+	CHECK(!a.active);
+	run(5);
+	CHECK_EQ(fired[0], 1);
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("test_timer: cannot map the register file\n");
+		return 1;
+	}
+	test_restart_due_timer();
+	test_stop_due_timer();
+	test_periodic();
+	test_one_shot();
+	return test_result("test_timer");
+}
@@ -0,0 +1,84 @@
+/*
+ * test_tripwire.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Feeds synthetic beam levels to the tripwire detectors and checks the
+ * event log against the break counts, including when the log fills.
+ */
+
+#include "test.h"
+#include "tripwire.h"
+
+#define DARK 0
+#define LIT ADC_FULL_SCALE
+#define DWELL 4
+#define PULSE 10			//samples per level, longer than the dwell
+
+static uint16_t block[4096];
+
+//alternating dark and lit pulses for two lanes, lane 1 at half the rate
+static uint32_t make_block(uint32_t frames){
+	for(uint32_t i=0;i<frames;i++){
+		block[2*i] = (i/PULSE) & 1 ? DARK : LIT;
+		block[2*i+1] = (i/(2*PULSE)) & 1 ? DARK : LIT;
+	}
+	return frames;
+}
+
+static uint32_t drain(uint32_t* lanes){
+	TripEvent e;
+	uint32_t events = 0;
+	while(tripwire_next(&e)){
+		events++;
+		if(e.state == TRIP_BROKEN){
+			lanes[e.lane]++;
+		}
+	}
+	return events;
+}
+
+static void test_counts(){
+	TripConfig config = {TRIP_DEFAULT_LOW, TRIP_DEFAULT_HIGH, DWELL};
+	TripDetector dets[2];
+	tripwire_init(&dets[0], 0, &config);
+	tripwire_init(&dets[1], 1, &config);
+
+	//short enough for the log: 5 breaks on lane 0, 2 on lane 1
+	uint32_t frames = make_block(10*PULSE);
+	uint32_t logged[2] = {0, 0};
+	CHECK_EQ(tripwire_process(dets, 2, block, frames, 1000000), 7);
+	drain(logged);
+	CHECK_EQ(dets[0].breaks, 5);
+	CHECK_EQ(dets[1].breaks, 2);
+	CHECK_EQ(logged[0], 5);
+	CHECK_EQ(logged[1], 2);
+	CHECK_EQ(dets[0].unlogged + dets[1].unlogged, 0);
+	CHECK_EQ(tripwire_dropped(), 0);
+}
+
+static void test_full_log(){
+	TripConfig config = {TRIP_DEFAULT_LOW, TRIP_DEFAULT_HIGH, DWELL};
+	TripDetector dets[2];
+	tripwire_init(&dets[0], 0, &config);
+	tripwire_init(&dets[1], 1, &config);
+
+	//far more changes than the log holds, not drained in between
+	uint32_t frames = make_block(sizeof(block)/sizeof(block[0])/2);
+	uint32_t breaks = tripwire_process(dets, 2, block, frames, 1000000);
+	uint32_t logged[2] = {0, 0};
+	CHECK_EQ(drain(logged), TRIP_LOG_SIZE);
+	CHECK(tripwire_dropped() > 0);
+
+	//every break is either in the log or counted as unlogged
+	CHECK_EQ(breaks, dets[0].breaks + dets[1].breaks);
+	CHECK_EQ(logged[0] + dets[0].unlogged, dets[0].breaks);
+	CHECK_EQ(logged[1] + dets[1].unlogged, dets[1].breaks);
+}
+
+int main(){
+	test_counts();
+	test_full_log();
+	return test_result("test_tripwire");
+}
@@ -0,0 +1,303 @@
+/*
+ * test_uart.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Checks the USART2 driver against models of its two DMA streams. The
+ * stream 5 model writes each received byte at the NDTR position, counts
+ * NDTR down and reloads it, and calls the stream ISR at the half and
+ * full marks as the hardware does. The stream 6 model sends a whole
+ * transfer at once when asked: it copies the bytes onto a wire, clears
+ * EN and calls the stream ISR with the transfer complete flag set.
+ * uart_driver.c is built into this file so the models can reach its
+ * buffers.
+ */
+
+#include "test.h"
+#include "mmio.h"
+#include "../src/uart_driver.c"
+
+#define WIRE_SIZE 1024
+#define MAX_TRANSFERS 16
+
+static uint32_t sent;				//bytes the model has received
+static uint8_t wire[WIRE_SIZE];		//bytes the model has transmitted
+static uint32_t wire_length;
+static uint32_t transfers[MAX_TRANSFERS];	//length of each transfer
+static uint32_t transfer_count;
+
+//not periodic in the buffer size, so a lost lap shows
+static uint8_t pattern(uint32_t i){
+	return i ^ (i>>7) ^ (i>>14);
+}
+
+static void receive_byte(uint8_t b){
+	uint32_t ndtr = *(DMA1_S5NDTR);
+	rx_buf[USART2_RX_SIZE - ndtr] = b;
+	*(DMA1_S5NDTR) = ndtr == 1 ? USART2_RX_SIZE : ndtr-1;
+	if(ndtr == USART2_RX_SIZE/2+1 || ndtr == 1){
+		DMA1_Stream5_IRQHandler();
+	}
+}
+
+static void receive(uint32_t count){
+	for(uint32_t i=0;i<count;i++){
+		receive_byte(pattern(sent++));
+	}
+}
+
+/*
+ * Finishes the transfer stream 6 is running, if any. M0AR only holds
+ * the low half of a host address, so the source is found from the
+ * driver's state and checked against it.
+ * Outputs:
+ * 		1 - a transfer was sent
+ * 		0 - the stream was idle
+ */
+static int transmit(){
+	if(!(*(DMA1_S6CR) & (1<<DMA_EN))){
+		return 0;
+	}
+	const uint8_t* source = buf_inflight ? pbuf_data(buf_inflight) : &tx_buf[tx_get & TX_MASK];
+	uint32_t count = *(DMA1_S6NDTR);
+	CHECK_EQ(*(DMA1_S6M0AR), (uint32_t)(uintptr_t)source);
+	CHECK(wire_length + count <= WIRE_SIZE);
+	if(wire_length + count <= WIRE_SIZE){
+		memcpy(&wire[wire_length], source, count);
+		wire_length += count;
+	}
+	if(transfer_count < MAX_TRANSFERS){
+		transfers[transfer_count] = count;
+	}
+	transfer_count++;
+
+	*(DMA1_S6NDTR) = 0;
+	*(DMA1_S6CR) &= ~(1<<DMA_EN);
+	*(DMA1_HISR) = DMA_S6_TCIF;
+	DMA1_Stream6_IRQHandler();
+	*(DMA1_HISR) = 0;
+	return 1;
+}
+
+static void transmit_all(){
+	while(transmit()){}
+}
+
+//reads everything waiting and checks it continues from the byte first
+static uint32_t read_all(uint32_t first){
+	uint8_t data[USART2_RX_SIZE+1];
+	uint32_t bad = 0;
+	uint32_t n = usart2_read(data, sizeof(data));
+	for(uint32_t i=0;i<n;i++){
+		bad += data[i] != pattern(first+i);
+	}
+	CHECK_EQ(bad, 0);
+	return n;
+}
+
+static void start(){
+	init_usart2(57600, 16000000);
+	usart2_set_echo(0);
+	sent = 0;
+	wire_length = 0;
+	transfer_count = 0;
+}
+
+static void test_in_step(){
+	start();
+	uint32_t got = 0;
+	for(uint32_t i=0;i<200;i++){
+		uint32_t step = 1 + i*7 % USART2_RX_SIZE;
+		receive(step);
+		CHECK_EQ(usart2_rx_available(), step);
+		got += read_all(got);
+	}
+	CHECK_EQ(got, sent);
+	CHECK_EQ(usart2_rx_dropped(), 0);
+}
+
+static void test_full_buffer(){
+	start();
+	receive(10);
+	read_all(0);
+	receive(USART2_RX_SIZE);
+	CHECK_EQ(usart2_rx_available(), USART2_RX_SIZE);
+	CHECK_EQ(read_all(10), USART2_RX_SIZE);
+	CHECK_EQ(usart2_rx_dropped(), 0);
+}
+
+static void test_overrun(){
+	uint32_t counts[] = {USART2_RX_SIZE+1, USART2_RX_SIZE+USART2_RX_SIZE/2, 5*USART2_RX_SIZE+3};
+	for(uint32_t c=0;c<sizeof(counts)/sizeof(counts[0]);c++){
+		start();
+		receive(counts[c]);
+
+		//only the last buffer of bytes is left, the rest are counted
+		CHECK_EQ(usart2_rx_available(), USART2_RX_SIZE);
+		CHECK_EQ(usart2_rx_dropped(), counts[c] - USART2_RX_SIZE);
+		CHECK_EQ(read_all(counts[c] - USART2_RX_SIZE), USART2_RX_SIZE);
+
+		//and the reader carries on from there
+		receive(3);
+		CHECK_EQ(read_all(counts[c]), 3);
+		CHECK_EQ(usart2_rx_dropped(), counts[c] - USART2_RX_SIZE);
+	}
+}
+
+static void test_write_full(){
+	start();
+	uint8_t data[USART2_TX_SIZE];
+	for(uint32_t i=0;i<sizeof(data);i++){
+		data[i] = pattern(i);
+	}
+
+	//the stream holds the first write while the rest queue behind it
+	CHECK_EQ(usart2_write(data, 200), 200);
+	CHECK_EQ(usart2_tx_space(), USART2_TX_SIZE-200);
+	CHECK_EQ(usart2_write(&data[200], 100), USART2_TX_SIZE-200);
+	CHECK_EQ(usart2_tx_space(), 0);
+	CHECK_EQ(usart2_write(data, 1), 0);
+
+	transmit_all();
+	CHECK_EQ(wire_length, USART2_TX_SIZE);
+	CHECK(memcmp(wire, data, USART2_TX_SIZE) == 0);
+	CHECK_EQ(usart2_tx_space(), USART2_TX_SIZE);
+	CHECK_EQ(transfer_count, 2);
+}
+
+static void test_write_wrap(){
+	start();
+	uint8_t data[300];
+	for(uint32_t i=0;i<sizeof(data);i++){
+		data[i] = pattern(i);
+	}
+	CHECK_EQ(usart2_write(data, 200), 200);
+	transmit_all();
+
+	//the ring wraps after 56 bytes, the DMA sends those and then the rest
+	transfer_count = 0;
+	CHECK_EQ(usart2_write(&data[200], 100), 100);
+	CHECK_EQ(*(DMA1_S6NDTR), USART2_TX_SIZE-200);
+	transmit_all();
+	CHECK_EQ(transfer_count, 2);
+	CHECK_EQ(transfers[0], USART2_TX_SIZE-200);
+	CHECK_EQ(transfers[1], 300-USART2_TX_SIZE);
+	CHECK_EQ(wire_length, 300);
+	CHECK(memcmp(wire, data, 300) == 0);
+}
+
+static void test_write_buf_order(){
+	start();
+	uint32_t in_use = pbuf_stats()->in_use;
+	PacketBuf* p = pbuf_alloc();
+	CHECK(p != NULL);
+	memcpy(pbuf_append(p, 3), "CDE", 3);
+	PacketBuf* empty = pbuf_alloc();
+	CHECK(empty != NULL);
+
+	//bytes written before a buffer go out before it, and after it after
+	CHECK_EQ(usart2_write("ab", 2), 2);
+	CHECK_EQ(usart2_write_buf(p), 1);
+	CHECK_EQ(usart2_write_buf(empty), 1);
+	CHECK_EQ(usart2_write("fg", 2), 2);
+	transmit_all();
+	CHECK_EQ(wire_length, 7);
+	CHECK(memcmp(wire, "abCDEfg", 7) == 0);
+	CHECK_EQ(transfer_count, 3);
+	CHECK_EQ(pbuf_stats()->in_use, in_use);
+
+	//one more buffer than the queue holds is freed and refused
+	PacketBuf* queued[USART2_TX_BUFS+1];
+	CHECK_EQ(usart2_write("x", 1), 1);
+	for(uint32_t i=0;i<=USART2_TX_BUFS;i++){
+		queued[i] = pbuf_alloc();
+		CHECK(queued[i] != NULL);
+		*pbuf_append(queued[i], 1) = '0'+i;
+	}
+	for(uint32_t i=0;i<USART2_TX_BUFS;i++){
+		CHECK_EQ(usart2_write_buf(queued[i]), 1);
+	}
+	CHECK_EQ(usart2_write_buf(queued[USART2_TX_BUFS]), 0);
+	transmit_all();
+	CHECK_EQ(wire_length, 7+1+USART2_TX_BUFS);
+	CHECK(memcmp(&wire[7], "x0123", 1+USART2_TX_BUFS) == 0);
+	CHECK_EQ(pbuf_stats()->in_use, in_use);
+}
+
+static void test_echo(){
+	start();
+	usart2_set_echo(1);
+	const char* typed = "a\rb";
+	for(uint32_t i=0;i<3;i++){
+		receive_byte(typed[i]);
+	}
+	char data[4];
+	CHECK_EQ(usart2_read(data, sizeof(data)), 3);
+	CHECK(memcmp(data, typed, 3) == 0);
+	transmit_all();
+	CHECK_EQ(wire_length, 4);
+	CHECK(memcmp(wire, "a\r\nb", 4) == 0);
+}
+
+static void test_echo_dropped(){
+	start();
+	usart2_set_echo(1);
+	uint8_t fill[USART2_TX_SIZE] = {0};
+
+	//one byte of room: the CR of a CR LF fits and the LF is dropped
+	CHECK_EQ(usart2_write(fill, USART2_TX_SIZE-1), USART2_TX_SIZE-1);
+	receive_byte('\r');
+	char c;
+	CHECK_EQ(usart2_read(&c, 1), 1);
+	CHECK_EQ(usart2_echo_dropped(), 1);
+
+	//a full queue drops every echoed byte
+	receive_byte('x');
+	receive_byte('\r');
+	char data[2];
+	CHECK_EQ(usart2_read(data, 2), 2);
+	CHECK_EQ(usart2_echo_dropped(), 4);
+
+	transmit_all();
+	CHECK_EQ(wire_length, USART2_TX_SIZE);
+	CHECK_EQ(wire[USART2_TX_SIZE-1], '\r');
+}
+
+static void test_transfer_error(){
+	start();
+	CHECK_EQ(usart2_write("abc", 3), 3);
+	CHECK(*(DMA1_S6CR) & (1<<DMA_EN));
+
+	//the stream stops on the error, the transfer is counted and dropped
+	*(DMA1_S6CR) &= ~(1<<DMA_EN);
+	*(DMA1_HISR) = DMA_S6_TEIF;
+	DMA1_Stream6_IRQHandler();
+	*(DMA1_HISR) = 0;
+	CHECK_EQ(usart2_tx_errors(), 1);
+	CHECK_EQ(usart2_tx_space(), USART2_TX_SIZE);
+
+	//and the next write goes out
+	CHECK_EQ(usart2_write("de", 2), 2);
+	transmit_all();
+	CHECK_EQ(wire_length, 2);
+	CHECK(memcmp(wire, "de", 2) == 0);
+	CHECK_EQ(usart2_tx_errors(), 1);
+}
+
+int main(){
+	if(mmio_host_init() != 0){
+		printf("test_uart: cannot map the register file\n");
+		return 1;
+	}
+	test_in_step();
+	test_full_buffer();
+	test_overrun();
+	test_write_full();
+	test_write_wrap();
+	test_write_buf_order();
+	test_echo();
+	test_echo_dropped();
+	test_transfer_error();
+	return test_result("test_uart");
+}
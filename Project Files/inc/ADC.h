@@ -22,13 +22,61 @@
 #define ADC_SQR3	(volatile uint32_t*)	0x40012034
 #define ADC_DR		(volatile uint32_t*)	0x4001204C
 
+//ADC SR bits
+#define ADC_EOC		1
+#define ADC_OVR		5
+
+//ADC CR1 bits
+#define ADC_SCAN	8
+#define ADC_OVRIE	26
+
+//ADC SQR1 bits
+#define ADC_L		20		//4 bits, sequence length minus one
+
+//ADC CR2 bits
+#define ADC_ADON	0
+#define ADC_DMA		8
+#define ADC_DDS		9
+#define ADC_EXTSEL	24		//4 bits, 0b0110 is TIM2_TRGO
+#define ADC_EXTEN	28		//2 bits, 0b01 is rising edge
+#define ADC_SWSTART	30
+
+//DMA2 stream 0 channel 0 is ADC1
+#define DMA2_LISR	(volatile uint32_t*)	0x40026400
+#define DMA2_LIFCR	(volatile uint32_t*)	0x40026408
+#define DMA2_S0CR	(volatile uint32_t*)	0x40026410
+#define DMA2_S0NDTR	(volatile uint32_t*)	0x40026414
+#define DMA2_S0PAR	(volatile uint32_t*)	0x40026418
+#define DMA2_S0M0AR	(volatile uint32_t*)	0x4002641C
+
+//DMA stream CR bits
+#define DMA_EN		0
+#define DMA_TEIE	2
+#define DMA_HTIE	3
+#define DMA_TCIE	4
+#define DMA_CIRC	8
+#define DMA_MINC	10
+#define DMA_PSIZE	11
+#define DMA_MSIZE	13
+
+//DMA2 LISR/LIFCR flags for stream 0
+#define DMA_S0_TEIF	(1<<3)
+#define DMA_S0_HTIF	(1<<4)
+#define DMA_S0_TCIF	(1<<5)
+#define DMA_S0_FLAGS (0x3D)
+
 //RCC constants
 #define RCC_BASE	(volatile uint32_t*)	0x40023800
 #define APB2ENR		(volatile uint32_t*)	0x40023844
 #define APB1ENR		(volatile uint32_t*)	0x40023840
+#define AHB1ENR		(volatile uint32_t*)	0x40023830
+#define AHB1ENR_DMA2EN 22
 
 //NVIC constants
 #define NVIC_ISER0 (volatile uint32_t*)		0xE000E100
+#define NVIC_ISER1 (volatile uint32_t*)		0xE000E104
+#define DMA2_STREAM0_IRQ 56
+#define ADC_IRQ 18
 
 //TIM2 constants
 #define TIM2_PSC 	(volatile uint32_t*)	0x40000028
@@ -38,6 +86,7 @@
 #define TIM2_CCMR1	(volatile uint32_t*)	0x40000018
 #define TIM2_CCER	(volatile uint32_t*)	0x40000020
 #define TIM2_CR1	(volatile uint32_t*)	0x40000000
+#define TIM2_CR2	(volatile uint32_t*)	0x40000004
 #define TIM2_EGR	(volatile uint32_t*)	0x40000014
 #define TIM2_DIER	(volatile uint32_t*)	0x4000000C
 #define TIM2_SR		(volatile uint32_t*)	0x40000010
@@ -47,10 +96,33 @@
 #include <inttypes.h>
 #include "gpio.h"
 
+/*
+ * Samples are taken continuously at ADC_SAMPLE_HZ and written by DMA
+ * into a buffer of two blocks. While one block is being filled the
+ * other is handed to the block callback.
+ *
+ * Every trigger scans all lanes, so a block holds ADC_BLOCK frames of
+ * one sample per lane, interleaved in lane order. With the 56 cycle
+ * sample time a conversion takes 8.5 us, so ADC_MAX_LANES fit in one
+ * sample period. Channels 1, 4, 5, 6 and 7 (PA1, PA4-PA7) are free on
+ * this board, the rest are shared with the NIC, USART2, LCD or keypad.
+ */
+#define ADC_SAMPLE_HZ 10000
+#define ADC_BLOCK 64			//frames per block
+#define ADC_MAX_LANES 8
+#define ADC_FULL_SCALE 4095
+#define ADC_VREF_MV 3300
+#define ADC_DEFAULT_CHANNEL 5	//PA5
+
+typedef void (*adc_block_callback)(const uint16_t* block, uint32_t frames, uint32_t lanes);
+
 extern void ADC_init();
+extern int ADC_set_lanes(const uint8_t* channels, uint32_t lanes);
+extern void ADC_set_block_callback(adc_block_callback callback);
+extern uint32_t ADC_overruns();
 extern uint32_t take_sample();
-extern float get_tempC();
-extern float get_tempF();
-extern float get_mili_volts();
+extern int32_t get_tempC();
+extern int32_t get_tempF();
+extern uint32_t get_mili_volts();
 
 #endif /* ADC_H */
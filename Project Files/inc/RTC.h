@@ -13,14 +13,49 @@
 #include <string.h>
 #include <stdio.h>
 
+#define RTC_BASE 0x40002800
+
 #define INIT 7
 #define INITF 6
+#define RSF 5
+#define INITS 4
+#define WUTWF 2
+#define WUTF 10
+#define WUCKSEL 0		//3 bits in CR, 0b100 is the 1 Hz ck_spre
+#define WUTE 10
+#define WUTIE 14
+#define TSEDGE 3
+#define TSE 11
+#define TSIE 15
+#define TSF 11
+#define TSOVF 12
+#define RECALPF 16
+#define CALP 15
+#define CALM 0			//9 bits in CALR
 #define SYNCHPREDIV 255
 #define ASYNCHPREDIV 127
 #define PM 22
 #define FMT 6
 #define TIME_LENGTH 11
 
+//wakeup timer interrupt is EXTI line 22, IRQ 3
+#define EXTI_IMR (volatile uint32_t*) 0x40013C00
+#define EXTI_RTSR (volatile uint32_t*) 0x40013C08
+#define EXTI_PR (volatile uint32_t*) 0x40013C14
+#define RTC_WKUP_EXTI 22
+#define RTC_WKUP_IRQ 3
+
+//time stamp interrupt is EXTI line 21, IRQ 2. The input is RTC_AF1, PC13
+#define RTC_STAMP_EXTI 21
+#define RTC_STAMP_IRQ 2
+
+//smooth calibration adds or masks up to this many of every 2^20 RTCCLK pulses
+#define RTC_CAL_MIN -511
+#define RTC_CAL_MAX 512
+
+//stale shadow reads allowed after a wakeup, the shadows resync within 2 RTCCLK cycles
+#define RTC_SYNC_TRIES 64
+
 typedef struct{
 	uint32_t TR;
 	uint32_t DR;
@@ -60,10 +95,62 @@ typedef struct{
 	uint8_t RTC_Year;		//0-99
 } RTC_Date;
 
+/*
+ * Calendar time cached by the 1 Hz wakeup interrupt
+ */
+typedef struct{
+	uint8_t hours;			//0-23
+	uint8_t minutes;
+	uint8_t seconds;
+	uint8_t day;			//1-31
+	Month month;
+	WeekDay weekday;
+	uint8_t year;			//0-99, from 2000
+	uint32_t epoch;			//seconds since midnight Jan 1 2000
+} RTC_Clock;
+
+typedef void (*rtc_second_callback)(void);
+
+/*
+ * Fixed point time, seconds since midnight Jan 1 2000 in the upper 32
+ * bits and the fraction of a second in the lower 32. Stamps compare and
+ * subtract as plain integers.
+ */
+typedef uint64_t RTC_Stamp;
+
+#define RTC_STAMP_ONE_SECOND ((RTC_Stamp)1<<32)
+
+/*
+ * Called from the time stamp interrupt with the captured edge
+ */
+typedef void (*rtc_stamp_callback)(RTC_Stamp stamp);
+
+/*
+ * Returns the whole seconds of a stamp
+ */
+static inline uint32_t rtc_stamp_seconds(RTC_Stamp stamp){
+	return (uint32_t)(stamp>>32);
+}
+
 extern void init_rtc(RTC_Date*,RTC_Time*);
 extern void setDate(RTC_Date*);
 extern void setTime(RTC_Time*);
 extern char* time_to_string(char* time);
 extern uint8_t get_Hour();
+extern uint8_t get_Minute();
+extern uint32_t get_rtc_minutes();
+extern int rtc_is_set();
+extern void rtc_clock_init();
+extern void rtc_get_clock(RTC_Clock* clock);
+extern uint32_t rtc_seconds();
+extern void rtc_set_second_callback(rtc_second_callback callback);
+extern RTC_Stamp rtc_stamp_now();
+extern void rtc_stamp_capture_enable(rtc_stamp_callback callback);
+extern uint32_t rtc_stamp_overruns();
+extern int rtc_calibrate(int32_t ppb);
+extern uint64_t rtc_stamp_to_us(RTC_Stamp stamp);
+extern RTC_Stamp rtc_stamp_from_us(uint64_t us);
+extern int64_t rtc_stamp_diff_us(RTC_Stamp later, RTC_Stamp earlier);
+extern void rtc_stamp_to_clock(RTC_Stamp stamp, RTC_Clock* clock);
 
 #endif
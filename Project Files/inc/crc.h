@@ -0,0 +1,31 @@
+/*
+ * crc.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, no
+ * reflection, no final xor). Running the CRC over a block followed by
+ * its CRC sent high byte first gives 0.
+ */
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <inttypes.h>
+
+#define CRC16_INIT 0xFFFF
+#define CRC16_POLY 0x1021
+
+extern const uint16_t crc16_table[256];
+
+/*
+ * Adds one byte to a running CRC
+ */
+static inline uint16_t crc16_update(uint16_t crc, uint8_t byte){
+	return (uint16_t)((crc<<8) ^ crc16_table[(uint8_t)((crc>>8) ^ byte)]);
+}
+
+extern uint16_t crc16(const uint8_t* data, uint32_t length, uint16_t crc);
+
+#endif /* CRC_H */
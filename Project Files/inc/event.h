@@ -0,0 +1,57 @@
+/*
+ * event.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Run to completion event loop. Interrupt handlers post small events
+ * to a lock free queue and the main loop dispatches them one at a time
+ * to the handler registered for their type. The core sleeps in WFI
+ * whenever the queue is empty.
+ */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <inttypes.h>
+
+//debug MCU configuration
+#define DBGMCU_CR (volatile uint32_t*) 0xE0042004
+#define DBGMCU_DBG_SLEEP_F 0
+
+#define EVENT_QUEUE_SIZE 32		//must be a power of two
+
+typedef enum {EV_KEY, EV_TRIPWIRE, EV_SECOND, EV_FRAME, EV_SERIAL, EV_TYPES} EventType;
+
+typedef struct{
+	EventType type;
+	uint32_t data;			//meaning depends on the type
+	uint32_t posted;		//cycle count when it was posted
+} Event;
+
+typedef void (*event_handler)(const Event* event);
+
+typedef struct{
+	uint32_t count;
+	uint32_t max_latency;	//most cycles from post to dispatch
+	uint32_t max_run;		//most cycles spent in the handler
+	uint64_t total_run;
+} HandlerStats;
+
+typedef struct{
+	uint64_t started;		//cycle count when the loop started
+	uint64_t idle;			//cycles spent asleep
+	uint32_t overflows;		//events lost because the queue was full
+	uint32_t unhandled;		//events with no handler
+	HandlerStats handlers[EV_TYPES];
+} EventStats;
+
+extern void event_init();
+extern void event_subscribe(EventType type, event_handler handler);
+extern int event_post(EventType type, uint32_t data);
+extern int event_dispatch();
+extern void event_loop();
+extern const EventStats* event_stats();
+extern uint32_t event_idle_percent();
+
+#endif /* EVENT_H */
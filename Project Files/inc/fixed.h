@@ -0,0 +1,76 @@
+/*
+ * fixed.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Integer and fixed point arithmetic for the sample paths. The FPU on
+ * the M4 is single precision only, so double constants such as 3.3
+ * pull in the soft float library. Everything here is integer.
+ *
+ * A Qn value is an int32_t holding x*2^n. Conversions from ADC counts
+ * use a multiply by a constant and a shift. The constants were checked
+ * against the exact rational result for every input in range, so they
+ * give the same answer as the divide they replace.
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <inttypes.h>
+#include "ADC.h"
+
+//Qn helpers
+#define Q_CONST(x, n) ((int32_t)((x)*(1<<(n)) + ((x) >= 0 ? 0.5 : -0.5)))	//constant expressions only
+
+static inline int32_t q_from_int(int32_t v, uint32_t n){
+	return v*(1<<n);
+}
+
+static inline int32_t q_to_int(int32_t q, uint32_t n){
+	return q>>n;			//rounds toward minus infinity
+}
+
+static inline int32_t q_mul(int32_t a, int32_t b, uint32_t n){
+	return (int32_t)(((int64_t)a*b)>>n);
+}
+
+/*
+ * counts*ADC_VREF_MV/ADC_FULL_SCALE rounded down, exact for 0..4095.
+ * The multiplier is the quotient rounded up at 20 fractional bits.
+ */
+#define MV_SHIFT 20
+#define MV_MULT ((uint32_t)((((uint64_t)ADC_VREF_MV<<MV_SHIFT) + ADC_FULL_SCALE-1)/ADC_FULL_SCALE))
+
+_Static_assert((uint64_t)ADC_FULL_SCALE*MV_MULT <= UINT32_MAX, "counts*MV_MULT must fit in 32 bits");
+
+static inline uint32_t counts_to_mv(uint32_t counts){
+	return (counts*MV_MULT)>>MV_SHIFT;
+}
+
+/*
+ * Lowest raw count that converts to at least mv. Compare raw samples
+ * against this instead of converting every sample.
+ */
+#define MV_TO_COUNTS(mv) (((mv)*ADC_FULL_SCALE + ADC_VREF_MV-1)/ADC_VREF_MV)
+
+/*
+ * Temperature sensor: 10 mV per degree C with 750 mV at 25 C. In tenths
+ * of a degree that is simply mV-500.
+ */
+static inline int32_t mv_to_deci_c(uint32_t mv){
+	return (int32_t)mv - 500;
+}
+
+/*
+ * Tenths of a degree F. F*10 = C*10*9/5 + 320 = mv*9/5 - 580, where the
+ * multiply by 9/5 is rounded down and exact for mv up to 3300.
+ */
+#define F_SHIFT 12
+#define F_MULT 7373			//9/5 at 12 fractional bits, rounded up
+
+static inline int32_t mv_to_deci_f(uint32_t mv){
+	return (int32_t)((mv*F_MULT)>>F_SHIFT) - 580;
+}
+
+#endif /* FIXED_H */
@@ -0,0 +1,66 @@
+/*
+ * flash.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Internal flash erase and program. The F446 has a single bank, so
+ * the core stalls on any flash fetch while an operation runs. A word
+ * takes about 16 us to program. A 128K sector takes one to two seconds
+ * to erase, and interrupts are held off for that long.
+ */
+
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <inttypes.h>
+
+//flash interface registers
+#define FLASH_ACR	(volatile uint32_t*)	0x40023C00
+#define FLASH_KEYR	(volatile uint32_t*)	0x40023C04
+#define FLASH_SR	(volatile uint32_t*)	0x40023C0C
+#define FLASH_CR	(volatile uint32_t*)	0x40023C10
+
+#define FLASH_KEY1 0x45670123
+#define FLASH_KEY2 0xCDEF89AB
+
+//ACR bits
+#define FLASH_DCEN	10
+#define FLASH_DCRST	12
+
+//SR bits
+#define FLASH_OPERR		1
+#define FLASH_WRPERR	4
+#define FLASH_PGAERR	5
+#define FLASH_PGPERR	6
+#define FLASH_PGSERR	7
+#define FLASH_BSY		16
+#define FLASH_ERRORS ((1<<FLASH_OPERR)|(1<<FLASH_WRPERR)|(1<<FLASH_PGAERR)|(1<<FLASH_PGPERR)|(1<<FLASH_PGSERR))
+
+//CR bits
+#define FLASH_PG	0
+#define FLASH_SER	1
+#define FLASH_SNB	3		//4 bits, sector number
+#define FLASH_PSIZE	8		//2 bits, 0b10 is 32 bit parallelism for 2.7-3.6 V
+#define FLASH_STRT	16
+#define FLASH_LOCK	31
+
+extern int flash_erase_sector(uint32_t sector);
+extern int flash_program(volatile uint32_t* address, const uint32_t* words, uint32_t count);
+
+#ifdef HOST_EMULATION
+
+/*
+ * Host flash emulator, host/flash_host.c. Covers the flash log sectors.
+ * Each programmed word and each sector erase is a write point; power
+ * can be cut at any of them, leaving that operation half done.
+ */
+typedef void (*flash_host_cut_handler)(void);
+
+extern void flash_host_init();
+extern void flash_host_cut(uint32_t point, flash_host_cut_handler handler);
+extern uint32_t flash_host_points();
+
+#endif /* HOST_EMULATION */
+
+#endif /* FLASH_H */
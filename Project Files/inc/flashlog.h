@@ -0,0 +1,61 @@
+/*
+ * flashlog.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Append only record log in the two flash sectors reserved by the
+ * .flashlog section of LinkerScript.ld. Records are 16 byte slots with
+ * a CRC and are never rewritten. A sector is only erased when the log
+ * moves to it, so the sectors wear evenly.
+ *
+ * Sector layout, in words:
+ * 		0-3 	header: magic, generation, ~generation, written last
+ * 		4-131	checkpoint index, one slot offset per checkpoint
+ * 		132-	records
+ *
+ * A checkpoint is the caller's whole state, written as a run of
+ * records. Its offset goes into the index after the last part is
+ * written. At startup the newest checkpoint is read from the index and
+ * only the records after it are replayed, so boot time does not grow
+ * with the log. A slot torn by a reset fails its CRC and is skipped.
+ *
+ * When a sector fills, the next checkpoint goes into the other sector
+ * and that sector's header is written after it. A reset during the
+ * move leaves the old sector as the newest valid one.
+ */
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include <inttypes.h>
+
+#define FLASHLOG_FIRST_SECTOR 6		//sectors 6 and 7, 0x08040000
+#define FLASHLOG_SECTORS 2
+#define FLASHLOG_SECTOR_SIZE 0x20000
+#define FLASHLOG_MAGIC 0x474F4C54	//"TLOG"
+#define FLASHLOG_INDEX_ENTRIES 128
+#define FLASHLOG_DATA_WORDS 3			//caller data per record
+#define FLASHLOG_CHECKPOINT_INTERVAL 64	//records between checkpoints
+#define FLASHLOG_MAX_CHECKPOINT 96		//words
+#define FLASHLOG_CHECKPOINT_TYPE 0x7F	//record types 1 to 0x7E are the caller's
+
+typedef void (*flashlog_replay_handler)(uint8_t type, uint8_t tag, const uint32_t* data);
+
+typedef struct{
+	uint32_t generation;	//sector moves since the log was created
+	uint32_t used;			//bytes used in the active sector
+	uint32_t records;		//records since the last checkpoint
+	uint32_t torn;			//slots skipped at startup
+	uint32_t errors;		//failed erases and writes
+	uint32_t erases;
+} FlashLogStats;
+
+extern int flashlog_init(uint32_t* checkpoint, uint32_t capacity);
+extern void flashlog_replay(flashlog_replay_handler replay);
+extern int flashlog_append(uint8_t type, uint8_t tag, const uint32_t* data);
+extern int flashlog_checkpoint(const uint32_t* words, uint32_t count);
+extern int flashlog_checkpoint_due();
+extern const FlashLogStats* flashlog_stats();
+
+#endif /* FLASHLOG_H */
@@ -0,0 +1,59 @@
+/*
+ * frame.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Link layer frame carried by the NIC. The NIC sends the preamble, then
+ *
+ * 		| dst | src | version | length | payload | CRC high | CRC low |
+ *
+ * where length is the number of payload bytes and the CRC-16 covers
+ * everything from dst to the end of the payload. The receiver looks at
+ * the header as soon as its last byte is decoded and stops decoding
+ * frames addressed to another node, and frames it sent itself.
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <inttypes.h>
+#include "pbuf.h"
+
+#define FRAME_VERSION 1
+#define FRAME_BROADCAST 0xFF
+#define FRAME_ADDRESS_FROM_UID 0x00		//pass to frame_init to derive the address
+
+#define FRAME_HEADER_SIZE 4
+#define FRAME_CRC_SIZE 2
+#define FRAME_MAX_PAYLOAD 255
+#define FRAME_MAX_SIZE (FRAME_HEADER_SIZE+FRAME_MAX_PAYLOAD+FRAME_CRC_SIZE)
+
+typedef struct{
+	uint8_t dst;
+	uint8_t src;
+	uint8_t version;
+	uint8_t length;
+} FrameHeader;
+
+_Static_assert(sizeof(FrameHeader) == FRAME_HEADER_SIZE, "FrameHeader must match the wire layout");
+
+typedef struct{
+	FrameHeader header;
+	uint8_t payload[FRAME_MAX_PAYLOAD];
+} Frame;
+
+typedef struct{
+	uint32_t crc_errors;
+	uint32_t length_errors;		//length field does not match the bytes received
+} FrameStats;
+
+extern void frame_init(uint8_t address);
+extern uint8_t frame_address();
+extern int frame_send(uint8_t dst, const uint8_t* payload, uint32_t length);
+extern int frame_send_buf(uint8_t dst, PacketBuf* p);
+extern int frame_receive(Frame* frame);
+extern PacketBuf* frame_receive_buf(FrameHeader* header);
+extern const FrameStats* frame_stats();
+
+#endif /* FRAME_H */
@@ -36,6 +36,123 @@ typedef enum {PUSH_PULL, OPEN_DRAIN} OutputType;
 typedef enum {LOW, MED, FAST, HIGH} Speed;
 typedef enum {NONE, PULLUP, PULLDOWN} PullType;
 
+//port register blocks for pin groups
+#define GPIO_PORT_A ((volatile GPIOx*) 0x40020000)
+#define GPIO_PORT_B ((volatile GPIOx*) 0x40020400)
+#define GPIO_PORT_C ((volatile GPIOx*) 0x40020800)
+
+/*
+ * A set of pins on one port. Declared with constant port and mask the
+ * functions below fold to a fixed register update: every pin in the
+ * group is changed by one write to each register, and outputs are
+ * driven through BSRR so no read-modify-write of ODR can race an ISR.
+ */
+typedef struct{
+	volatile GPIOx* port;
+	uint16_t mask;
+} PinGroup;
+
+#define PIN_GROUP(port, mask) ((PinGroup){(port), (uint16_t)(mask)})
+#define PIN(port, pin) PIN_GROUP((port), 1u<<(pin))
+
+/*
+ * Spreads bit i of a pin mask to the low bit of 2 bit field i, for
+ * MODER, OSPEEDR and PUPDR
+ */
+static inline uint32_t gpio_spread2(uint32_t mask){
+	mask = (mask | (mask<<8)) & 0x00FF00FF;
+	mask = (mask | (mask<<4)) & 0x0F0F0F0F;
+	mask = (mask | (mask<<2)) & 0x33333333;
+	mask = (mask | (mask<<1)) & 0x55555555;
+	return mask;
+}
+
+/*
+ * Spreads bits 0-7 of a pin mask to the low bit of 4 bit field i, for AFRL and AFRH
+ */
+static inline uint32_t gpio_spread4(uint32_t mask){
+	mask &= 0xFF;
+	mask = (mask | (mask<<12)) & 0x000F000F;
+	mask = (mask | (mask<<6)) & 0x03030303;
+	mask = (mask | (mask<<3)) & 0x11111111;
+	return mask;
+}
+
+/*
+ * Returns a MODER image with every pin in mask set to mode
+ */
+static inline uint32_t gpio_mode_image(uint32_t mask, Mode mode){
+	return gpio_spread2(mask)*mode;
+}
+
+static inline void gpio_group_mode(PinGroup g, Mode mode){
+	uint32_t field = gpio_spread2(g.mask);
+	g.port->MODER = (g.port->MODER & ~(field*3)) | (field*mode);
+}
+
+/*
+ * Gives each pin of the group its own mode from a MODER image, in one
+ * write. Fields outside the group are kept.
+ */
+static inline void gpio_group_modes(PinGroup g, uint32_t image){
+	uint32_t fields = gpio_spread2(g.mask)*3;
+	g.port->MODER = (g.port->MODER & ~fields) | (image & fields);
+}
+
+static inline void gpio_group_pull(PinGroup g, PullType pull){
+	uint32_t field = gpio_spread2(g.mask);
+	g.port->PUPDR = (g.port->PUPDR & ~(field*3)) | (field*pull);
+}
+
+static inline void gpio_group_speed(PinGroup g, Speed speed){
+	uint32_t field = gpio_spread2(g.mask);
+	g.port->OSPEEDR = (g.port->OSPEEDR & ~(field*3)) | (field*speed);
+}
+
+static inline void gpio_group_output_type(PinGroup g, OutputType type){
+	g.port->OTYPER = (g.port->OTYPER & ~(uint32_t)g.mask) | (type == OPEN_DRAIN ? g.mask : 0);
+}
+
+static inline void gpio_group_alt_func(PinGroup g, uint8_t af){
+	uint32_t low = gpio_spread4(g.mask);
+	uint32_t high = gpio_spread4(g.mask>>8);
+	if(low){
+		g.port->AFRL = (g.port->AFRL & ~(low*0xF)) | (low*(af&0xF));
+	}
+	if(high){
+		g.port->AFRH = (g.port->AFRH & ~(high*0xF)) | (high*(af&0xF));
+	}
+}
+
+/*
+ * Drives every pin of the group high
+ */
+static inline void gpio_group_set(PinGroup g){
+	g.port->BSSR = g.mask;
+}
+
+/*
+ * Drives every pin of the group low
+ */
+static inline void gpio_group_clear(PinGroup g){
+	g.port->BSSR = (uint32_t)g.mask<<16;
+}
+
+/*
+ * Drives the group to value, given at the pins' own bit positions. Set
+ * wins over reset in BSRR, so this is a single write.
+ */
+static inline void gpio_group_write(PinGroup g, uint32_t value){
+	g.port->BSSR = ((uint32_t)g.mask<<16) | (value & g.mask);
+}
+
+/*
+ * Returns the input levels of the group at the pins' own bit positions
+ */
+static inline uint32_t gpio_group_read(PinGroup g){
+	return g.port->IDR & g.mask;
+}
+
 //global functions
 extern void enable_clock(char port);
 extern void set_pin_mode(char port, uint8_t pin, Mode mode);
@@ -0,0 +1,45 @@
+/*
+ * irq.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Helpers for short critical sections shared between thread and ISR
+ * context. The previous PRIMASK is saved so sections can nest.
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <inttypes.h>
+
+//NVIC constants
+#define NVIC_ISER0 (volatile uint32_t*) 0xE000E100
+#define NVIC_ISER1 (volatile uint32_t*) 0xE000E104
+
+#ifdef HOST_EMULATION
+
+//interrupts are not raised on the host, handlers are called directly
+static inline uint32_t irq_save(){
+	return 0;
+}
+
+static inline void irq_restore(uint32_t primask){
+	(void)primask;
+}
+
+#else
+
+static inline uint32_t irq_save(){
+	uint32_t primask;
+	__asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+	return primask;
+}
+
+static inline void irq_restore(uint32_t primask){
+	__asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+#endif /* HOST_EMULATION */
+
+#endif /* IRQ_H */
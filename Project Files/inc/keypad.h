@@ -3,6 +3,13 @@
  *
  *  Created on: Jan. 6 2017
  *      Author: Mitchell Larson
+ *
+ * 4x4 matrix keypad on PC0-PC7, columns on PC0-3 and rows on PC4-7.
+ * The matrix is scanned from the SysTick timer wheel. Each tick reads
+ * the columns for the row driven on the previous tick, so the lines
+ * have a whole tick to settle, then drives the next row low with a
+ * single MODER write. Every key is debounced on its own, a held key
+ * repeats, and each change is queued as a timestamped event.
  */
 
 #ifndef KEYPAD_H
@@ -10,25 +17,44 @@
 
 #include <inttypes.h>
 #include "gpio.h"
-#include "ringbuffer.h"
 
-#define RCC_APB2ENR (volatile uint32_t*) 0x40023844
-#define SYSCFG_EXTICR1 (volatile uint32_t*) 0x40013808
-#define SYSCFG_EXTICR2 (volatile uint32_t*) 0x4001380C
-#define SYSCFG_EXTICR3 (volatile uint32_t*) 0x40013810
+#define KEY_PORT 'C'
+#define KEY_COL_PIN 0			//first of 4 column pins
+#define KEY_ROW_PIN 4			//first of 4 row pins
+#define KEY_ROWS 4
+#define KEY_COLS 4
+#define KEY_COUNT (KEY_ROWS*KEY_COLS)
+#define KEY_PINS PIN_GROUP(GPIO_PORT_C, 0xFF<<KEY_COL_PIN)
+#define KEY_COL_PINS PIN_GROUP(GPIO_PORT_C, 0xF<<KEY_COL_PIN)
+#define KEY_ROW_PINS PIN_GROUP(GPIO_PORT_C, 0xF<<KEY_ROW_PIN)
+
+#define KEY_SCAN_MS 1			//one row per scan, every key is sampled each 4 ms
+#define KEY_DEBOUNCE_SAMPLES 4	//samples in a row a change must hold, 16 ms
+#define KEY_REPEAT_DELAY_MS 500	//hold time before a key starts repeating
+#define KEY_REPEAT_MS 100		//time between repeats
+#define KEY_QUEUE_SIZE 16		//must be a power of two
+
+typedef enum {KEY_DOWN, KEY_UP, KEY_REPEAT} KeyAction;
+
+typedef struct{
+	uint32_t time_ms;		//now_ms when the change was first seen, or the repeat time
+	uint8_t key;			//1-16, left to right, top to bottom
+	KeyAction action;
+} KeyEvent;
 
-#define EXTI_FTSR (volatile uint32_t*) 0x40013C0C
-#define NVIC_ISER0 (volatile uint32_t*) 0xE000E100
-#define NVIC_ICER0 (volatile uint32_t*) 0xE000E180
-#define EXTI_PR (volatile uint32_t*) 0x40013C14
-#define EXTI_IMR (volatile uint32_t*) 0x40013C00
+typedef void (*key_callback)(void);
 
 //global functions
 extern void key_init();
+extern int key_next(KeyEvent* event);
+extern uint32_t key_dropped();
 extern uint8_t key_getkey_noblock();
 extern uint8_t key_getkey();
 extern char key_getchar();
 extern uint8_t key_getint();
 extern char key_getchar_noblock();
+extern uint8_t key_getkey_repeat_noblock();
+extern char key_getchar_repeat_noblock();
+extern void key_set_callback(key_callback cb);
 
 #endif /* KEYPAD_H */
@@ -14,9 +14,6 @@
 #include <stdio.h>
 #include "timer.h"
 
-static volatile GPIOx *GPIOB = (GPIOx *) 0x40020400;
-static volatile GPIOx *GPIOC = (GPIOx *) 0x40020800;
-
  
 //RCC constants
 #define RCC_AHB1ENR (volatile uint32_t*) 0x40023830
@@ -31,8 +28,22 @@ static volatile GPIOx *GPIOC = (GPIOx *) 0x40020800;
 #define LCD_RW_F 1
 #define LCD_RS_F 0
 
+//bus pins: RS, RW and E on PB0-2, D4-D7 on PC8-11, busy flag on D7
+#define LCD_CTRL_PINS PIN_GROUP(GPIO_PORT_B, (1<<LCD_RS_F)|(1<<LCD_RW_F)|(1<<LCD_E_F))
+#define LCD_RS_RW_PINS PIN_GROUP(GPIO_PORT_B, (1<<LCD_RS_F)|(1<<LCD_RW_F))
+#define LCD_RW_PIN PIN(GPIO_PORT_B, LCD_RW_F)
+#define LCD_E_PIN PIN(GPIO_PORT_B, LCD_E_F)
+#define LCD_DATA_PINS PIN_GROUP(GPIO_PORT_C, 0xF<<LCD_DATA_OFFSET)
+#define LCD_BUSY_PIN PIN(GPIO_PORT_C, LCD_DATA_OFFSET+3)
+
 #define MAX_INT 9
 
+//framebuffer geometry and DDRAM layout
+#define LCD_ROWS 2
+#define LCD_COLS 16
+#define LCD_ROW1_ADDR 0x40
+#define LCD_REFRESH_MS 1
+
 typedef enum {C_OFF, C_ON} Cursor_Mode;
 
 extern void lcd_init(Cursor_Mode mode);
@@ -46,5 +57,8 @@ extern void lcd_data(uint8_t data);
 extern void lcd_set_position(uint8_t row,uint8_t col);
 extern int lcd_print_string(const char *pointer);
 extern int lcd_print_num(int num);
+extern void lcd_fb_put(uint8_t row, uint8_t col, char c);
+extern int lcd_fb_print(uint8_t row, uint8_t col, const char *pointer);
+extern void lcd_pump();
 
 #endif /* LCD_H */
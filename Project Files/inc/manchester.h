@@ -0,0 +1,96 @@
+/*
+ * manchester.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Manchester line coding, IEEE 802.3 convention: a 1 is sent as a low
+ * half bit followed by a high half bit, a 0 as high then low. Bytes go
+ * out most significant bit first. The line idles high.
+ *
+ * Nothing here touches hardware, so the coder can be run against a
+ * simulated pin on the host.
+ */
+
+#ifndef MANCHESTER_H
+#define MANCHESTER_H
+
+#include <inttypes.h>
+
+#define MANCHESTER_PREAMBLE 0x55
+#define MANCHESTER_IDLE_LEVEL 1
+
+typedef struct{
+	const uint8_t* data;
+	uint16_t length;
+	uint16_t index;		//next byte to load
+	uint16_t shift;		//half bit levels of the current byte, first in bit 15
+	uint8_t halves;		//half bits left in shift
+} ManchesterEncoder;
+
+/*
+ * Returns the 16 half bit levels for a byte, first half bit in bit 15.
+ */
+static inline uint16_t manchester_expand(uint8_t byte){
+	uint32_t ones = byte;
+	uint32_t zeros = (uint8_t)~byte;
+
+	//spread bit i to bit 2i
+	ones = (ones | (ones<<4)) & 0x0F0F;
+	ones = (ones | (ones<<2)) & 0x3333;
+	ones = (ones | (ones<<1)) & 0x5555;
+	zeros = (zeros | (zeros<<4)) & 0x0F0F;
+	zeros = (zeros | (zeros<<2)) & 0x3333;
+	zeros = (zeros | (zeros<<1)) & 0x5555;
+
+	//a 1 is high in its second half, a 0 is high in its first half
+	return (uint16_t)(ones | (zeros<<1));
+}
+
+typedef enum {MD_HUNT, MD_PREAMBLE, MD_DATA, MD_SKIP} DecoderState;
+
+/*
+ * Decoder fed with the time between edges. The bit period is measured
+ * from the preamble and then tracked through the frame, so the sender's
+ * clock only has to be close enough for short and long intervals to be
+ * told apart.
+ */
+typedef struct{
+	DecoderState state;
+	uint8_t level;			//line level after the last edge
+	uint8_t half_pending;	//last edge was a bit boundary
+	uint8_t bits;			//bits in shift
+	uint8_t shift;
+	uint8_t count;			//preamble intervals seen
+	uint32_t sum;			//preamble interval total
+	uint32_t period;		//bit period in timer ticks
+	uint8_t* buf;
+	uint16_t capacity;
+	uint16_t length;
+	uint8_t overflow;
+} ManchesterDecoder;
+
+//number of edge intervals in the preamble after its first edge
+#define MANCHESTER_PREAMBLE_INTERVALS 7
+
+extern void manchester_encoder_start(ManchesterEncoder* enc, const uint8_t* data, uint16_t length);
+extern int manchester_encoder_next(ManchesterEncoder* enc);
+extern void manchester_decoder_start(ManchesterDecoder* dec, uint8_t* buf, uint16_t capacity);
+extern int manchester_decoder_edge(ManchesterDecoder* dec, uint32_t interval);
+extern int manchester_decoder_idle(ManchesterDecoder* dec);
+extern void manchester_decoder_skip(ManchesterDecoder* dec);
+
+#ifdef HOST_EMULATION
+
+/*
+ * Host line simulator, host/manchester_host.c. Turns a frame into the
+ * edge intervals TIM4 would capture from a sender with its own clock
+ * and edge jitter.
+ */
+extern void manchester_host_seed(uint32_t seed);
+extern uint32_t manchester_host_line(const uint8_t* data, uint16_t length, double half_bit,
+		double jitter, uint16_t* intervals, uint32_t capacity);
+
+#endif /* HOST_EMULATION */
+
+#endif /* MANCHESTER_H */
@@ -0,0 +1,57 @@
+/*
+ * mmio.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Register access for registers whose reads or writes have side
+ * effects, such as status flags cleared by reading a data register.
+ * On the STM32 the macros are plain volatile accesses. Built with
+ * HOST_EMULATION they call into the emulated register file in
+ * host/mmio_host.c, which runs a model of the peripheral on every
+ * access.
+ *
+ * On the host the register file is mapped at the real peripheral
+ * addresses, so registers without side effects may still be accessed
+ * directly through their pointers.
+ */
+
+#ifndef MMIO_H
+#define MMIO_H
+
+#include <inttypes.h>
+
+#ifdef HOST_EMULATION
+
+extern uint32_t mmio_read(uintptr_t addr);
+extern void mmio_write(uintptr_t addr, uint32_t value);
+
+#define REG_READ(reg) mmio_read((uintptr_t)(reg))
+#define REG_WRITE(reg, value) mmio_write((uintptr_t)(reg), (value))
+
+/*
+ * A model sees the value stored in the register file and returns what
+ * the read gives, or the value to store for a write.
+ */
+typedef uint32_t (*mmio_read_hook)(uintptr_t addr, uint32_t stored);
+typedef uint32_t (*mmio_write_hook)(uintptr_t addr, uint32_t stored, uint32_t value);
+
+extern int mmio_host_init();
+extern void mmio_hook(uintptr_t addr, mmio_read_hook read, mmio_write_hook write);
+extern void mmio_advance_ns(uint64_t ns);
+extern uint64_t mmio_cycles();
+extern void mmio_usart2_input(const void* data, uint32_t len);
+extern uint32_t mmio_usart2_output(void* data, uint32_t capacity);
+extern void mmio_adc_input(uint16_t sample);
+
+#else
+
+#define REG_READ(reg) (*(reg))
+#define REG_WRITE(reg, value) (*(reg) = (value))
+
+#endif /* HOST_EMULATION */
+
+#define REG_SET(reg, bits) REG_WRITE(reg, REG_READ(reg) | (bits))
+#define REG_CLEAR(reg, bits) REG_WRITE(reg, REG_READ(reg) & ~(bits))
+
+#endif /* MMIO_H */
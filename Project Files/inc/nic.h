@@ -0,0 +1,141 @@
+/*
+ * nic.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Single wire network interface. Frames are Manchester encoded onto
+ * PA0 (TIM5_CH1). Every edge is made by the timer's output compare,
+ * so bit timing does not depend on interrupt latency. The line is read
+ * on PB6 (TIM4_CH1), where input capture timestamps every edge.
+ *
+ * Nodes share the wire. PA0 is open drain, so any node driving low wins
+ * and a node that releases the line but reads it low has collided.
+ * Bus wiring: PA0 and PB6 tied together with an external pull-up.
+ */
+
+#ifndef NIC_H
+#define NIC_H
+
+#include <inttypes.h>
+#include "gpio.h"
+#include "tim.h"
+#include "timer.h"
+#include "manchester.h"
+#include "frame.h"
+#include "pbuf.h"
+
+//RCC constants
+#define APB1ENR_TIM4_F 2
+#define APB1ENR_TIM5_F 3
+
+//transmit pin, PA0 alternate function 2 is TIM5_CH1
+#define NIC_TX_PORT 'A'
+#define NIC_TX_PIN 0
+#define NIC_TX_AF 2
+
+//receive pin, PB6 alternate function 2 is TIM4_CH1
+#define NIC_RX_PORT 'B'
+#define NIC_RX_PIN 6
+#define NIC_RX_AF 2
+
+//96 bit unique device ID
+#define NIC_UID (volatile uint32_t*) 0x1FFF7A10
+
+//TIM4 is IRQ 30, TIM5 is IRQ 50
+#define NIC_TIM4_IRQ 30
+#define NIC_TIM5_IRQ 50
+
+#define NIC_DEFAULT_BITRATE 10000
+#define NIC_MAX_FRAME FRAME_MAX_SIZE	//bytes after the preamble
+#define NIC_TX_SLOTS 4			//must be a power of two
+#define NIC_GAP_BITS 2			//idle bit times between frames
+#define NIC_RX_SLOTS 4			//must be a power of two
+#define NIC_SLOT_BITS 8			//backoff slot in bit times
+#define NIC_BACKOFF_MAX_EXP 8	//backoff window stops doubling at 2^8 slots
+#define NIC_MAX_ATTEMPTS 10		//collisions before a frame is dropped
+
+/*
+ * TIM4 is 16 bits wide and runs at the core clock, so an idle timeout
+ * of 1.5 bit periods limits the bit rate to no lower than about 400 bps.
+ */
+#define NIC_MIN_BITRATE 400
+
+/*
+ * TIM5 and TIM4 count core clock ticks, so every interval the receiver
+ * captures is off by up to a tick. The decoder allows +-25% of a bit
+ * period in the preamble and reads an interval under 3/4 of a period as
+ * half a bit. With that tick of error and the sender's clock 5% off,
+ * frames start failing below 16 ticks per bit, so a bit gets 20 ticks,
+ * 800 kbps at 16 MHz. The interrupt taken per edge sets a lower
+ * practical limit.
+ */
+#define NIC_MIN_HALF_BIT 10		//core clock ticks
+#define NIC_MAX_BITRATE (SYSCLK_HZ/(2*NIC_MIN_HALF_BIT))
+
+typedef enum {CH_IDLE, CH_BUSY, CH_COLLISION} ChannelState;
+
+typedef struct{
+	uint32_t frames_sent;
+	uint32_t frames_dropped;	//queue or pool full, or frame too long
+	uint32_t frames_received;
+	uint32_t rx_errors;			//coding errors, cut short or overlong frames
+	uint32_t rx_dropped;		//good frames lost because the ring or the pool was full
+	uint32_t collisions;
+	uint32_t deferrals;			//sends held back because the line was busy
+	uint32_t tx_aborted;		//frames dropped after NIC_MAX_ATTEMPTS collisions
+	uint32_t rx_filtered;		//frames dropped by the header filter
+} NIC_Stats;
+
+/*
+ * Decides from the first bytes of a frame whether to keep receiving it.
+ * Runs in the receive ISR, returns nonzero to keep the frame.
+ */
+typedef int (*nic_rx_filter)(const uint8_t* header);
+
+typedef void (*nic_rx_callback)(void);
+
+extern void nic_init(uint32_t bitrate);
+extern int nic_send(const uint8_t* data, uint32_t length);
+extern int nic_send_buf(PacketBuf* buf);
+extern uint32_t nic_tx_pending();
+extern uint32_t nic_receive(uint8_t* data, uint32_t capacity);
+extern PacketBuf* nic_receive_buf();
+extern uint32_t nic_rx_pending();
+extern uint32_t nic_half_bit_cycles();
+extern ChannelState nic_channel_state();
+extern const NIC_Stats* nic_stats();
+extern void nic_set_rx_filter(uint32_t header_length, nic_rx_filter filter);
+extern void nic_set_rx_callback(nic_rx_callback callback);
+
+#ifdef HOST_EMULATION
+
+/*
+ * Host bus simulator, host/nic_host.c. NIC_HOST_NODES copies of the
+ * driver, each with its own timers, share one open drain wire. Time
+ * runs in core clock ticks and only moves in nic_host_run.
+ */
+#define NIC_HOST_NODES 3
+
+typedef struct{
+	void (*init)(uint32_t bitrate);
+	int (*send)(const uint8_t* data, uint32_t length);
+	uint32_t (*receive)(uint8_t* data, uint32_t capacity);
+	uint32_t (*tx_pending)();
+	ChannelState (*channel_state)();
+	const NIC_Stats* (*stats)();
+	void (*tim4_irq)(void);
+	void (*tim5_irq)(void);
+	volatile TIMx* tim4;
+	volatile TIMx* tim5;
+} NicHostNode;
+
+extern int nic_host_init(uint32_t bitrate);
+extern const NicHostNode* nic_host_node(uint32_t n);
+extern void nic_host_run(uint32_t ticks);
+extern void nic_host_jam(uint32_t period, uint32_t low);
+extern uint32_t nic_host_now();
+
+#endif /* HOST_EMULATION */
+
+#endif /* NIC_H */
@@ -0,0 +1,60 @@
+/*
+ * pbuf.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Pool of fixed size packet buffers shared by the NIC, the frame layer
+ * and the UART. Buffers are handed from one stage to the next by
+ * pointer instead of being copied. Every buffer starts with
+ * PBUF_HEADROOM bytes free in front of its data so a layer can prepend
+ * its header in place.
+ *
+ * Allocation and release are lock free and may be called from any ISR
+ * or thread context. A buffer is reference counted and goes back to the
+ * pool when the last reference is released.
+ */
+
+#ifndef PBUF_H
+#define PBUF_H
+
+#include <inttypes.h>
+
+#define PBUF_COUNT 16			//at most 32, one bit of the free mask each
+#define PBUF_SIZE 272			//headroom plus the largest frame
+#define PBUF_HEADROOM 8
+
+_Static_assert(PBUF_COUNT <= 32, "PBUF_COUNT must fit in the free mask");
+
+typedef struct{
+	uint16_t offset;			//start of the data in data[]
+	uint16_t length;			//bytes of data
+	uint8_t refs;
+	uint8_t index;				//position in the pool
+	uint64_t stamp;				//RTC_Stamp when a received frame ended, 0 otherwise
+	uint8_t data[PBUF_SIZE];
+} PacketBuf;
+
+typedef struct{
+	uint32_t in_use;
+	uint32_t high_water;		//most buffers ever in use at once
+	uint32_t alloc_failures;
+} PoolStats;
+
+/*
+ * Returns a pointer to the first byte of data
+ */
+static inline uint8_t* pbuf_data(PacketBuf* p){
+	return &p->data[p->offset];
+}
+
+extern PacketBuf* pbuf_alloc();
+extern void pbuf_ref(PacketBuf* p);
+extern void pbuf_free(PacketBuf* p);
+extern uint8_t* pbuf_push(PacketBuf* p, uint32_t n);
+extern uint8_t* pbuf_pull(PacketBuf* p, uint32_t n);
+extern uint8_t* pbuf_append(PacketBuf* p, uint32_t n);
+extern void pbuf_trim(PacketBuf* p, uint32_t n);
+extern const PoolStats* pbuf_stats();
+
+#endif /* PBUF_H */
@@ -30,10 +30,17 @@ typedef struct {
 } Note;
 
 typedef struct {
-	double frequency;
+	uint32_t frequency;		//Hz in Q8, see PIEZO_HZ
 	float duration_ms;
 } Tone;
 
+/*
+ * A sequence only replaces one of the same or lower priority
+ */
+typedef enum {
+	PIEZO_BEEP, PIEZO_ALARM
+} PiezoPriority;
+
 
 //macros used
 #define STK_ENABLE 0x01
@@ -49,11 +56,21 @@ typedef struct {
 #define TIM3_OUTPUT_EN 0x01
 #define TIM3_ON 0x01
 
+#define PIEZO_GAP_MS 5		//silence after each tone to keep them distinct
+#define PIEZO_OCTAVES 9		//notes can be played in octaves 0-8
+
+//Tone frequency from Hz, constant expressions only
+#define PIEZO_HZ(hz) ((uint32_t)((hz)*256 + 0.5))
+
 //fucntions
 extern void init_piezo();
 extern void play_note(const Note *note);
 extern void play_tone(const Tone *tone);
 extern void play_note_sequence(const Note *notes, uint32_t length);
 extern void play_tone_sequence(const Tone *tones, uint32_t length);
+extern int play_tones(const Tone *tones, uint32_t length, PiezoPriority priority, uint8_t loop);
+extern int play_notes(const Note *notes, uint32_t length, PiezoPriority priority, uint8_t loop);
+extern void piezo_stop();
+extern int piezo_busy();
 
 #endif /* PIEZO_H */
@@ -0,0 +1,126 @@
+/*
+ * prof.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Cycle counting probes. A probe times the rest of the scope it is
+ * placed in with the DWT cycle counter and keeps the count, minimum,
+ * maximum, total and a log2 histogram of the results. ISR probes also
+ * track how deeply interrupts are nested.
+ *
+ * Results live in prof_data, which a debugger can read directly, and
+ * prof_dump prints them on USART2. Probes are only built when
+ * PROFILE_ENABLED is 1, which is the default for DEBUG builds. When it
+ * is 0 every macro expands to nothing and prof.c is empty.
+ */
+
+#ifndef PROF_H
+#define PROF_H
+
+#include <inttypes.h>
+
+#ifndef PROFILE_ENABLED
+#ifdef DEBUG
+#define PROFILE_ENABLED 1
+#else
+#define PROFILE_ENABLED 0
+#endif
+#endif
+
+#define PROF_MAGIC 0x464F5250		//"PROF" in memory, to find the table
+#define PROF_BUCKETS 16				//bucket n counts runs of 2^n to 2^(n+1)-1 cycles
+
+typedef enum {
+	PROBE_ADC_ISR,
+	PROBE_KEY_SCAN,
+	PROBE_NIC_TX_ISR,
+	PROBE_NIC_RX_ISR,
+	PROBE_LCD_EXECUTE,
+	PROBE_LCD_PUMP,
+	PROBE_COUNT
+} ProbeId;
+
+typedef struct{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t buckets[PROF_BUCKETS];
+} ProbeStats;
+
+typedef struct{
+	uint32_t magic;
+	uint32_t isr_depth;
+	uint32_t isr_depth_max;
+	ProbeStats probes[PROBE_COUNT];
+} ProfData;
+
+#if PROFILE_ENABLED
+
+#include "timer.h"
+#include "mmio.h"
+
+typedef struct{
+	ProbeId id;
+	uint32_t start;
+} ProfScope;
+
+extern ProfData prof_data;
+
+extern void prof_reset();
+extern void prof_dump();
+
+static inline void prof_record(ProbeId id, uint32_t cycles){
+	ProbeStats* p = &prof_data.probes[id];
+	p->count++;
+	p->total += cycles;
+	if(cycles < p->min){
+		p->min = cycles;
+	}
+	if(cycles > p->max){
+		p->max = cycles;
+	}
+	uint32_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+	p->buckets[bucket < PROF_BUCKETS ? bucket : PROF_BUCKETS-1]++;
+}
+
+static inline void prof_scope_end(ProfScope* scope){
+	prof_record(scope->id, REG_READ(DWT_CYCCNT) - scope->start);
+}
+
+static inline uint32_t prof_isr_enter(){
+	uint32_t depth = ++prof_data.isr_depth;
+	if(depth > prof_data.isr_depth_max){
+		prof_data.isr_depth_max = depth;
+	}
+	return REG_READ(DWT_CYCCNT);
+}
+
+static inline void prof_isr_scope_end(ProfScope* scope){
+	prof_scope_end(scope);
+	prof_data.isr_depth--;
+}
+
+#define PROF_CONCAT2(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT2(a, b)
+#define PROF_NAME PROF_CONCAT(prof_scope_, __LINE__)
+
+//times the rest of the enclosing scope
+#define PROF_SCOPE(id) \
+	ProfScope PROF_NAME __attribute__((cleanup(prof_scope_end))) = {(id), REG_READ(DWT_CYCCNT)}
+
+//first line of an interrupt handler, also tracks the nesting depth
+#define PROF_ISR_SCOPE(id) \
+	ProfScope PROF_NAME __attribute__((cleanup(prof_isr_scope_end))) = {(id), prof_isr_enter()}
+
+#else
+
+#define PROF_SCOPE(id)
+#define PROF_ISR_SCOPE(id)
+#define prof_reset()
+#define prof_dump()
+
+#endif /* PROFILE_ENABLED */
+
+#endif /* PROF_H */
@@ -3,6 +3,10 @@
  *
  *  Created on: Jan 30, 2017
  *      Author: Mitchell Larson
+ *
+ * Single-producer/single-consumer ring buffer. One side may run in an
+ * ISR and the other in thread context without disabling interrupts, as
+ * long as there is only ever one writer and one reader per buffer.
  */
 
 #ifndef RINGBUFFER_H
@@ -10,9 +14,22 @@
 
 #include <stdint.h>
 
-#define BUF_SIZE 50
+//capacity is 2^RB_SIZE_LOG2 so indexes can be wrapped with a mask
+#ifndef RB_SIZE_LOG2
+#define RB_SIZE_LOG2 6
+#endif
+
+#define BUF_SIZE (1u<<RB_SIZE_LOG2)
+#define RB_MASK (BUF_SIZE-1)
 #define BACK_SPACE 127
 
+_Static_assert((BUF_SIZE & RB_MASK) == 0, "BUF_SIZE must be a power of two");
+
+/*
+ * put and get are free running counters. put is only written by the
+ * producer and get is only written by the consumer, so put-get is the
+ * number of elements in the buffer even after the counters wrap.
+ */
 typedef struct {
 	unsigned int put;
 	unsigned int get;
@@ -24,4 +41,11 @@ extern uint8_t get(volatile RingBuffer* buffer);
 extern int hasSpace(volatile RingBuffer* buffer);
 extern int hasElement(volatile RingBuffer* buffer);
 
+extern int rb_try_put(volatile RingBuffer* buffer, uint8_t element);
+extern int rb_try_get(volatile RingBuffer* buffer, uint8_t* element);
+extern unsigned int rb_put_n(volatile RingBuffer* buffer, const uint8_t* src, unsigned int n);
+extern unsigned int rb_get_n(volatile RingBuffer* buffer, uint8_t* dst, unsigned int n);
+extern unsigned int rb_count(volatile RingBuffer* buffer);
+extern unsigned int rb_space(volatile RingBuffer* buffer);
+
 #endif	/*RINGBUFFER_H*/
@@ -0,0 +1,66 @@
+/*
+ * tim.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Register layout shared by the general purpose timers TIM2-TIM5.
+ */
+
+#ifndef TIM_H
+#define TIM_H
+
+#include <inttypes.h>
+
+typedef struct{
+	uint32_t CR1;
+	uint32_t CR2;
+	uint32_t SMCR;
+	uint32_t DIER;
+	uint32_t SR;
+	uint32_t EGR;
+	uint32_t CCMR1;
+	uint32_t CCMR2;
+	uint32_t CCER;
+	uint32_t CNT;
+	uint32_t PSC;
+	uint32_t ARR;
+	uint32_t BLANK;
+	uint32_t CCR1;
+	uint32_t CCR2;
+	uint32_t CCR3;
+	uint32_t CCR4;
+	uint32_t BLANK2;
+	uint32_t DCR;
+	uint32_t DMAR;
+	uint32_t OR;
+} TIMx;
+
+#define TIM2_BASE 0x40000000
+#define TIM3_BASE 0x40000400
+#define TIM4_BASE 0x40000800
+#define TIM5_BASE 0x40000C00
+
+//CR1 bits
+#define TIM_CEN 0
+
+//DIER and SR bits
+#define TIM_UIE 0
+#define TIM_CC1IE 1
+#define TIM_CC2IE 2
+#define TIM_CC1IF 1
+#define TIM_CC2IF 2
+#define TIM_CC1OF 9
+
+//EGR bits
+#define TIM_UG 0
+
+//output compare modes for OCxM
+#define OCM_FROZEN 0b000
+#define OCM_ACTIVE 0b001
+#define OCM_INACTIVE 0b010
+#define OCM_TOGGLE 0b011
+#define OCM_FORCE_INACTIVE 0b100
+#define OCM_FORCE_ACTIVE 0b101
+
+#endif /* TIM_H */
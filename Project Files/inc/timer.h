@@ -14,12 +14,49 @@
 #define STK_LOAD (volatile uint32_t*) 0xE000E014
 #define STK_VAL (volatile uint32_t*) 0xE000E018
 #define STK_ENABLE_F 0
+#define STK_TICKINT_F 1
 #define STK_CLKSOURCE_F 2
 #define STK_CNTFLAG_F 16
 
+//DWT cycle counter constants
+#define DEMCR (volatile uint32_t*) 0xE000EDFC
+#define DWT_CTRL (volatile uint32_t*) 0xE0001000
+#define DWT_CYCCNT (volatile uint32_t*) 0xE0001004
+#define DEMCR_TRCENA_F 24
+#define DWT_CYCCNTENA_F 0
+
+//core clock (HSI)
+#define SYSCLK_HZ 16000000
+#define CYCLES_PER_US (SYSCLK_HZ/1000000)
+
+//number of slots in the software timer wheel, must be a power of two
+#define TIMER_WHEEL_SLOTS 32
+
 #include <inttypes.h>
 
+typedef void (*timer_callback)(void* arg);
+
+/*
+ * Software timer. The caller owns the storage, it must stay valid while
+ * the timer is running. Callbacks run from the SysTick interrupt.
+ */
+typedef struct SoftTimer {
+	struct SoftTimer* next;
+	uint32_t expires;		//tick the timer fires on
+	uint32_t period;		//0 for one shot
+	timer_callback callback;
+	void* arg;
+	uint8_t active;
+} SoftTimer;
+
+extern void timer_init();
 extern void delay_ms(uint32_t t_ms);
 extern void delay_us(uint32_t t_us);
+extern uint64_t now_cycles();
+extern uint64_t now_us();
+extern uint32_t now_ms();
+extern void timer_start(SoftTimer* timer, uint32_t delay_ms, uint32_t period_ms,
+		timer_callback callback, void* arg);
+extern void timer_stop(SoftTimer* timer);
 
-#endif /* TIMER_H */
\ No newline at end of file
+#endif /* TIMER_H */
@@ -0,0 +1,60 @@
+/*
+ * traffic.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Tripwire traffic statistics. Breaks are counted into three rings of
+ * buckets: the last 60 minutes, the last 24 hours and the last 7 days.
+ * Time is a running minute count. A bucket is cleared when the clock
+ * passes it, so old traffic falls out instead of piling up forever.
+ *
+ * Each ring keeps its total and its fullest bucket up to date as counts
+ * come in. Recording is O(1). The only scan happens when the fullest
+ * bucket is cleared, at most once per bucket period.
+ */
+
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include <inttypes.h>
+
+#define TRAFFIC_MINUTES 60
+#define TRAFFIC_HOURS 24		//hour ring index is the hour of the day
+#define TRAFFIC_DAYS 7
+
+typedef struct{
+	uint32_t total;			//sum of the ring, the moving window total
+	uint32_t max_count;		//fullest bucket
+	uint16_t max_index;
+	uint16_t size;
+	uint32_t latest;		//period number of the newest bucket
+	uint32_t* counts;
+} TrafficRing;
+
+typedef struct{
+	TrafficRing minutes;
+	TrafficRing hours;
+	TrafficRing days;
+	uint32_t all_time;
+	uint32_t minute_counts[TRAFFIC_MINUTES];
+	uint32_t hour_counts[TRAFFIC_HOURS];
+	uint32_t day_counts[TRAFFIC_DAYS];
+} TrafficStats;
+
+//words saved by traffic_save: the hour and day rings, their clocks and the all time count
+#define TRAFFIC_SNAPSHOT_WORDS (3 + TRAFFIC_HOURS + TRAFFIC_DAYS + 1)
+
+//bytes per TrafficStats, checked against sizeof in traffic.c
+#define TRAFFIC_RING_BYTES (4*4 + sizeof(uint32_t*))
+#define TRAFFIC_BYTES (3*TRAFFIC_RING_BYTES + 4 + 4*(TRAFFIC_MINUTES+TRAFFIC_HOURS+TRAFFIC_DAYS))
+
+extern void traffic_init(TrafficStats* stats, uint32_t minute);
+extern void traffic_advance(TrafficStats* stats, uint32_t minute);
+extern void traffic_record(TrafficStats* stats, uint32_t minute, uint32_t count);
+extern uint32_t traffic_busiest_hour(const TrafficStats* stats);
+extern uint32_t traffic_average_x10(const TrafficRing* ring);
+extern void traffic_save(const TrafficStats* stats, uint32_t* words);
+extern void traffic_restore(TrafficStats* stats, const uint32_t* words);
+
+#endif /* TRAFFIC_H */
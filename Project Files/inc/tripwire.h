@@ -0,0 +1,65 @@
+/*
+ * tripwire.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Tripwire detector. Works on blocks of raw ADC samples. The beam is
+ * only considered broken once the level has stayed below the low
+ * threshold for a minimum number of samples, and only clear again
+ * once it has stayed above the high threshold for as long. Noise
+ * around a single level can therefore not count one crossing twice.
+ *
+ * Each doorway is a lane with its own detector. The samples of all
+ * lanes arrive interleaved from the ADC scan and are handed to the
+ * detectors in a single pass.
+ *
+ * Every confirmed change is stamped with the RTC time and written to
+ * a lock free event log. The log is filled from the ADC interrupt and
+ * emptied by the main loop.
+ */
+
+#ifndef TRIPWIRE_H
+#define TRIPWIRE_H
+
+#include <inttypes.h>
+#include "fixed.h"
+#include "RTC.h"
+
+#define TRIP_LOG_SIZE 64		//must be a power of two
+#define TRIP_SAMPLE_STAMP (RTC_STAMP_ONE_SECOND/ADC_SAMPLE_HZ)
+
+//defaults: break below 250 mV, clear above 400 mV, 2 ms either way
+#define TRIP_DEFAULT_LOW MV_TO_COUNTS(250)
+#define TRIP_DEFAULT_HIGH MV_TO_COUNTS(400)
+#define TRIP_DEFAULT_DWELL (2*ADC_SAMPLE_HZ/1000)
+
+typedef enum {TRIP_CLEAR, TRIP_BROKEN} TripState;
+
+typedef struct{
+	uint16_t low;			//raw count, below it counts towards a break
+	uint16_t high;			//raw count, above it counts towards clear
+	uint16_t dwell;			//samples the new level must hold, at least 1
+} TripConfig;
+
+typedef struct{
+	TripConfig config;
+	TripState state;
+	uint16_t run;			//samples in a row on the other side
+	uint8_t lane;
+	uint32_t breaks;		//confirmed breaks since init
+	uint32_t unlogged;		//breaks whose event did not fit in the log
+} TripDetector;
+
+typedef struct{
+	RTC_Stamp stamp;		//first sample of the new level
+	uint8_t lane;
+	TripState state;		//TRIP_BROKEN for a break, TRIP_CLEAR when it ends
+} TripEvent;
+
+extern void tripwire_init(TripDetector* det, uint8_t lane, const TripConfig* config);
+extern uint32_t tripwire_process(TripDetector* dets, uint32_t lanes, const uint16_t* block, uint32_t frames, RTC_Stamp end);
+extern int tripwire_next(TripEvent* event);
+extern uint32_t tripwire_dropped();
+
+#endif /* TRIPWIRE_H */
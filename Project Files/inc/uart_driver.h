@@ -9,6 +9,7 @@
 #define UART_DRIVER_H_
 
 #include <inttypes.h>
+#include "pbuf.h"
 
 // RCC registers
 #define RCC_APB1ENR (volatile uint32_t*) 0x40023840
@@ -16,6 +17,7 @@
 
 #define GPIOAEN 0		// GPIOA Enable is bit 0 in RCC_APB1LPENR
 #define USART2EN 17  // USART2 enable is bit 17 in RCC_AHB1LPENR
+#define DMA1EN 21    // DMA1 enable is bit 21 in RCC_AHB1ENR
 
 // GPIOA registers
 #define GPIOA_MODER (volatile uint32_t*) 0x40020000
@@ -27,18 +29,73 @@
 #define USART_CR2   (volatile uint32_t*) 0x40004410
 #define USART_CR3   (volatile uint32_t*) 0x40004414
 
+// DMA1 registers. USART2_RX is stream 5 and USART2_TX is stream 6, both channel 4
+#define DMA1_HISR   (volatile uint32_t*) 0x40026004
+#define DMA1_HIFCR  (volatile uint32_t*) 0x4002600C
+#define DMA1_S5CR   (volatile uint32_t*) 0x40026088
+#define DMA1_S5NDTR (volatile uint32_t*) 0x4002608C
+#define DMA1_S5PAR  (volatile uint32_t*) 0x40026090
+#define DMA1_S5M0AR (volatile uint32_t*) 0x40026094
+#define DMA1_S6CR   (volatile uint32_t*) 0x400260A0
+#define DMA1_S6NDTR (volatile uint32_t*) 0x400260A4
+#define DMA1_S6PAR  (volatile uint32_t*) 0x400260A8
+#define DMA1_S6M0AR (volatile uint32_t*) 0x400260AC
+
 // CR1 bits
 #define UE 13 //UART enable
 #define TE 3  // Transmitter enable
 #define RE 2  // Receiver enable
+#define IDLEIE 4 // Idle line interrupt enable
+
+// CR3 bits
+#define DMAT 7 // DMA enable transmitter
+#define DMAR 6 // DMA enable receiver
 
 // Status register bits
 #define TXE 7  // Transmit register empty
+#define TC 6   // Transmission complete
 #define RXNE 5  // Receive register is not empty..char received
+#define IDLE 4  // Idle line detected
+
+// DMA stream CR bits
+#define DMA_EN 0
+#define DMA_TEIE 2
+#define DMA_HTIE 3
+#define DMA_TCIE 4
+#define DMA_DIR 6
+#define DMA_CIRC 8
+#define DMA_MINC 10
+#define DMA_CHSEL 25
+
+// DMA1 HISR/HIFCR flag groups for streams 5 and 6
+#define DMA_S5_FLAGS (0x3D<<6)
+#define DMA_S5_HTIF (1<<10)
+#define DMA_S5_TCIF (1<<11)
+#define DMA_S6_FLAGS (0x3D<<16)
+#define DMA_S6_TEIF (1<<19)
+#define DMA_S6_TCIF (1<<21)
+
+// Buffer sizes, all must be powers of two
+#define USART2_TX_SIZE 256
+#define USART2_RX_SIZE 128
+#define USART2_TX_BUFS 4		// packet buffers waiting to be sent
+
+typedef void (*usart2_rx_callback)(void);
 
 // Function prototypes
 extern void init_usart2(uint32_t baud, uint32_t sysclk);
 extern char usart2_getch();
 extern void usart2_putch(char c);
+extern uint32_t usart2_write(const void* data, uint32_t len);
+extern int usart2_write_buf(PacketBuf* p);
+extern uint32_t usart2_read(void* data, uint32_t len);
+extern uint32_t usart2_rx_available();
+extern uint32_t usart2_rx_dropped();
+extern uint32_t usart2_echo_dropped();
+extern uint32_t usart2_tx_errors();
+extern uint32_t usart2_tx_space();
+extern void usart2_flush();
+extern void usart2_set_echo(int enable);
+extern void usart2_set_rx_callback(usart2_rx_callback callback);
 
 #endif /* UART_DRIVER_H_ */
@@ -6,15 +6,31 @@
  */
 
 #include "ADC.h"
+#include "mmio.h"
+#include "prof.h"
+#include "timer.h"
+#include "fixed.h"
 
 static void init_clock();
+static void init_dma();
+static void start_dma();
+static void init_channel(uint8_t channel, uint32_t lane);
+
+static uint16_t samples[2*ADC_BLOCK*ADC_MAX_LANES];
+static adc_block_callback block_callback;
+static uint8_t lane_channels[ADC_MAX_LANES] = {ADC_DEFAULT_CHANNEL};
+static uint32_t lane_count = 1;
+static uint32_t overruns;
 
 /**
  * This function initializes the ADC by enable the clock for the ADC and
- * GPIO port A. Pin 6 for port A is then set to analog mode, the channel
- * for the converter is selected, and the converter is turned on.
- * The converter is set up to analyze the temperature sensor.
- * The ADC is also set up to be driven by interrupt
+ * the GPIO ports of the lanes. Each lane's pin is then set to analog mode,
+ * the channels are put in the scan sequence, and the converter is turned on.
+ * Every TIM2 update triggers one scan of all lanes, and DMA2 stream 0
+ * moves the results into the sample buffer, so no interrupt is taken per
+ * sample. The DMA interrupts at the half and full points of the buffer
+ * and passes the finished block to the block callback. An overrun stops
+ * the DMA requests, so it interrupts as well and the stream is restarted.
  * Inputs:
  * 		none
  * Outputs:
@@ -24,62 +40,150 @@ void ADC_init(){
 	//enable clock for ADC1
 	*(APB2ENR) |= 1<<8;
 	
-	//enable clock for GPIOA
-	enable_clock('A');
-	
-	//enable analog mode for GPIOA, pin6
-	set_pin_mode('A', 5, ANALOG);
-	
-	//SELECT CHANNEL
-	*(ADC_SQR3) = 5;
-	
-	//enable EOC interrupt
-	*(ADC_CR1) |= 1<<5;
-	
-	//enable interupt on NVIC(position 18)
-	*(NVIC_ISER0) |= 1<<18;
-	
+	//one conversion per lane in lane order
+	*(ADC_SQR1) = (lane_count-1)<<ADC_L;
+	*(ADC_SQR2) = 0;
+	*(ADC_SQR3) = 0;
+	for(uint32_t i=0;i<lane_count;i++){
+		init_channel(lane_channels[i], i);
+	}
+	*(ADC_CR1) |= (1<<ADC_SCAN)|(1<<ADC_OVRIE);
+
+	init_dma();
+
+	//conversions on the rising edge of TIM2_TRGO, every result requests DMA
+	REG_WRITE(ADC_CR2, (1<<ADC_ADON)|(1<<ADC_DMA)|(1<<ADC_DDS)|(0b0110<<ADC_EXTSEL)|(0b01<<ADC_EXTEN));
+
 	//init clock
 	init_clock();
-	
-	//turn on ADC1
-	*(ADC_CR2) |= 1;
+}
+
+/**
+ * Selects the channels to scan, one per lane. Must be called before
+ * ADC_init. Without it the single lane is ADC_DEFAULT_CHANNEL.
+ * Inputs:
+ * 		*channels - ADC channel of each lane, 0 to 15
+ * 		lanes - number of lanes, 1 to ADC_MAX_LANES
+ * Outputs:
+ * 		0 - the lanes were set
+ * 		-1 - too many or too few lanes, or a channel has no pin
+ */
+int ADC_set_lanes(const uint8_t* channels, uint32_t lanes){
+	if(lanes == 0 || lanes > ADC_MAX_LANES){
+		return -1;
+	}
+	for(uint32_t i=0;i<lanes;i++){
+		if(channels[i] > 15){
+			return -1;
+		}
+	}
+	for(uint32_t i=0;i<lanes;i++){
+		lane_channels[i] = channels[i];
+	}
+	lane_count = lanes;
+	return 0;
+}
+
+/**
+ * Returns the number of ADC overruns. Each one loses the block that was
+ * being filled.
+ */
+uint32_t ADC_overruns(){
+	return overruns;
+}
+
+/**
+ * Registers the function that receives each finished block of samples.
+ * It runs in the DMA interrupt and has until the other half of the
+ * buffer fills, ADC_BLOCK sample periods, to finish with the block.
+ * Inputs:
+ * 		callback - function to call, NULL to discard blocks
+ * Outputs:
+ * 		none
+ */
+void ADC_set_block_callback(adc_block_callback callback){
+	block_callback = callback;
 }
 
 static void init_clock(){
 	//enable clock for TIM2
 	*(APB1ENR) |= 1;
 	
-	//set clock prescalar
-	*(TIM2_PSC) = 16000;		//1000 counts = 1 second
+	//run at the core clock and overflow once per sample
+	*(TIM2_PSC) = 0;
+	*(TIM2_ARR) = (SYSCLK_HZ/ADC_SAMPLE_HZ)-1;
 	
-	//reload set to 100 ms
-	*(TIM2_ARR) = (100-1);
-	
-	//compare to 100 ms
-	*(TIM2_CCR2) = (100-1);
-	
-	//select output mode (0b001)
-	*(TIM2_CCMR1) &= ~(0b111<<12);
-	*(TIM2_CCMR1) |= 0b001<<12;
-	
-	//make OC2 signal an output on corresponding pin5
-	*(TIM2_CCER) |= 1<<4;
-	
-	//enable interrupt
-	*(TIM2_DIER) |= 1<<2;
-	
-	//enable in NVIC
-	*(NVIC_ISER0) |= 1<<28;
+	//update event drives TRGO (MMS = 010)
+	*(TIM2_CR2) = (*(TIM2_CR2) & ~(0b111<<4)) | (0b010<<4);
 	
 	//enable the counter by setting CEN bit in CR1
 	*(TIM2_CR1) |= 1;
 }
 
+static void init_dma(){
+	*(AHB1ENR) |= 1<<AHB1ENR_DMA2EN;
+	start_dma();
+
+	*(NVIC_ISER0) = 1<<ADC_IRQ;
+	*(NVIC_ISER1) = 1<<(DMA2_STREAM0_IRQ-32);
+}
+
+/*
+ * Points DMA2 stream 0 at the start of the sample buffer and starts it,
+ * so the next scan fills the first block from lane 0
+ */
+static void start_dma(){
+	//peripheral to memory, half words, circular over both blocks, channel 0
+	*(DMA2_S0CR) = 0;
+	while(*(DMA2_S0CR) & (1<<DMA_EN)){}
+	*(DMA2_LIFCR) = DMA_S0_FLAGS;
+	*(DMA2_S0PAR) = (uint32_t)(uintptr_t)ADC_DR;
+	*(DMA2_S0M0AR) = (uint32_t)(uintptr_t)samples;
+	*(DMA2_S0NDTR) = 2*ADC_BLOCK*lane_count;
+	*(DMA2_S0CR) = (0b01<<DMA_PSIZE)|(0b01<<DMA_MSIZE)|(1<<DMA_MINC)|(1<<DMA_CIRC)
+			|(1<<DMA_HTIE)|(1<<DMA_TCIE)|(1<<DMA_TEIE);
+	*(DMA2_S0CR) |= 1<<DMA_EN;
+}
+
+/*
+ * Sets a channel's pin to analog mode, gives it the 56 cycle sample time
+ * for the sensor's source impedance and puts it at position lane of the
+ * scan sequence. Channels 0-7 are PA0-PA7, 8-9 are PB0-PB1 and 10-15
+ * are PC0-PC5.
+ */
+static void init_channel(uint8_t channel, uint32_t lane){
+	char port = 'A';
+	uint8_t pin = channel;
+	if(channel >= 10){
+		port = 'C';
+		pin = channel-10;
+	}else if(channel >= 8){
+		port = 'B';
+		pin = channel-8;
+	}
+	enable_clock(port);
+	set_pin_mode(port, pin, ANALOG);
+
+	if(channel >= 10){
+		uint32_t shift = 3*(channel-10);
+		*(ADC_SMPR1) = (*(ADC_SMPR1) & ~(0b111<<shift)) | (0b011<<shift);
+	}else{
+		uint32_t shift = 3*channel;
+		*(ADC_SMPR2) = (*(ADC_SMPR2) & ~(0b111<<shift)) | (0b011<<shift);
+	}
+
+	if(lane < 6){
+		*(ADC_SQR3) |= (uint32_t)channel<<(5*lane);
+	}else{
+		*(ADC_SQR2) |= (uint32_t)channel<<(5*(lane-6));
+	}
+}
+
 /**
  * This function will start a conversion on the ADC when called and then
  * return the data in the data register. The upper half word is cleared
- * in the DR to ensure no garbage data is returned.
+ * in the DR to ensure no garbage data is returned. Only for use before
+ * ADC_init starts the sample stream, after that the DMA takes every result.
  * Inputs:
  * 		none
  * Outputs:
@@ -87,13 +191,13 @@ static void init_clock(){
  */
 uint32_t take_sample(){
 	//start conversion by setting SWSTART bit in ADC_CR2
-	*(ADC_CR2) |= (1<<30);
+	REG_SET(ADC_CR2, 1<<30);
 	
 	//wait for EOC bit to be set
-	while((*(ADC_SR) & (1<<1))==0){}
+	while((REG_READ(ADC_SR) & (1<<1))==0){}
 	
 	//return data in ADC_DR
-	return (*(ADC_DR) & 0xFFFF);
+	return (REG_READ(ADC_DR) & 0xFFFF);
 }
 
 /**
@@ -102,10 +206,10 @@ uint32_t take_sample(){
  * Inputs:
  * 		none
  * Outputs:
- * 		temperature in celcius
+ * 		temperature in tenths of a degree celcius
  */
-float get_tempC(){
-	return 25+((get_mili_volts()-750)/10);
+int32_t get_tempC(){
+	return mv_to_deci_c(get_mili_volts());
 }
 
 /**
@@ -114,10 +218,10 @@ float get_tempC(){
  * Inputs:
  * 		none
  * Outputs:
- * 		temperature in Ferenheit
+ * 		temperature in tenths of a degree Ferenheit
  */
-float get_tempF(){
-	return (get_tempC()*1.8)+32;
+int32_t get_tempF(){
+	return mv_to_deci_f(get_mili_volts());
 }
 
 /**
@@ -126,16 +230,46 @@ float get_tempF(){
  * Inputs:
  * 		none
  * Outputs:
- * 		milivolts
+ * 		milivolts, rounded down
  */
-float get_mili_volts(){
-	return (((take_sample()*3.3)/4095)*1000);
+uint32_t get_mili_volts(){
+	return counts_to_mv(take_sample());
 }
 
-void TIM2_IRQHandler(void){
-	//clear flag
-	*(TIM2_SR) &= ~(1<<2);
-	
-	//start conversion
-	*(ADC_CR2) |= 1<<30;
+void DMA2_Stream0_IRQHandler(void){
+	PROF_ISR_SCOPE(PROBE_ADC_ISR);
+
+	uint32_t flags = *(DMA2_LISR);
+	*(DMA2_LIFCR) = DMA_S0_FLAGS;
+
+	//the half that just filled is complete, DMA moves on to the other
+	const uint16_t* block = 0;
+	if(flags & DMA_S0_TCIF){
+		block = &samples[ADC_BLOCK*lane_count];
+	}else if(flags & DMA_S0_HTIF){
+		block = samples;
+	}
+
+	if(block && block_callback){
+		block_callback(block, ADC_BLOCK, lane_count);
+	}
+}
+
+/*
+ * A conversion finished before the DMA took the last one. The ADC stops
+ * requesting DMA until OVR is cleared, and the scan it broke off is lost,
+ * so the block being filled is dropped and the stream starts over at the
+ * first block. The next trigger begins a new scan at lane 0.
+ */
+void ADC_IRQHandler(void){
+	if(REG_READ(ADC_SR) & (1<<ADC_OVR)){
+		overruns++;
+		if(*(DMA2_LISR) & (DMA_S0_HTIF|DMA_S0_TCIF)){
+			DMA2_Stream0_IRQHandler();	//a block finished before the overrun is kept
+		}
+		start_dma();
+		REG_CLEAR(ADC_CR2, 1<<ADC_DMA);
+		REG_WRITE(ADC_SR, ~(1<<ADC_OVR));
+		REG_SET(ADC_CR2, 1<<ADC_DMA);
+	}
 }
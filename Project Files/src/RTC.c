@@ -1,22 +1,53 @@
 #include "RTC.h"
 #include "RCC.h"
+#include "mmio.h"
+#include "irq.h"
 
 
 #define PWR_CR (volatile uint32_t*) 0x40007000
 
 static volatile RCC_Struct* RCC = (RCC_Struct*) 0x40023800;
-static volatile RTC_Struct* RTC = (RTC_Struct*) 0x40002800;
+static volatile RTC_Struct* RTC = (RTC_Struct*) RTC_BASE;
 
 void init_rtc(RTC_Date*,RTC_Time*);
 void setDate(RTC_Date*);
 void setTime(RTC_Time*);
 char* time_to_string(char* time);
 uint8_t get_Hour();
+uint8_t get_Minute();
+uint32_t get_rtc_minutes();
+int rtc_is_set();
+void rtc_clock_init();
+void rtc_get_clock(RTC_Clock* clock);
+uint32_t rtc_seconds();
+void rtc_set_second_callback(rtc_second_callback callback);
+RTC_Stamp rtc_stamp_now();
+void rtc_stamp_capture_enable(rtc_stamp_callback callback);
+uint32_t rtc_stamp_overruns();
+int rtc_calibrate(int32_t ppb);
+uint64_t rtc_stamp_to_us(RTC_Stamp stamp);
+RTC_Stamp rtc_stamp_from_us(uint64_t us);
+int64_t rtc_stamp_diff_us(RTC_Stamp later, RTC_Stamp earlier);
+void rtc_stamp_to_clock(RTC_Stamp stamp, RTC_Clock* clock);
 static void disable_RTC_write_protect();
 static void enable_RTC_write_protect();
 static void disable_RTC_init();
 static void enable_RTC_init();
 static uint8_t RTC_ByteToBcd2(uint8_t Value);
+static void read_clock(RTC_Clock* clock);
+static void decode_clock(uint32_t tr, uint32_t dr, RTC_Clock* clock);
+
+//days before the first of each month in a common year
+static const uint16_t month_days[12] = {0,31,59,90,120,151,181,212,243,273,304,334};
+
+static RTC_Clock cached;			//written by the wakeup ISR
+static rtc_second_callback second_callback;
+
+static uint32_t prediv_s;			//SSR counts down from here once a second
+static uint32_t ss_scale;			//2^32/(prediv_s+1), one SSR count as a stamp fraction
+static RTC_Stamp last_stamp;		//keeps rtc_stamp_now from going backwards
+static rtc_stamp_callback stamp_callback;
+static uint32_t stamp_overruns;
 
 /**
  * This function will initialize the RTC clock. In order to do so, a
@@ -49,6 +80,11 @@ void init_rtc(RTC_Date* date,RTC_Time* time){
 	
 	enable_RTC_init();
 
+	//stamps only stay monotonic within one setting of the calendar
+	uint32_t primask = irq_save();
+	last_stamp = 0;
+	irq_restore(primask);
+
 	//set for 1Hz internal clock and configure RTC precalar
 	RTC->PRER = SYNCHPREDIV & 0x7FFF;
 	RTC->PRER |= (ASYNCHPREDIV<<16);
@@ -75,7 +111,7 @@ void setDate(RTC_Date* date){
 						(date->RTC_WeekDay << 13) | \
 						(date->RTC_Year << 16);
 	//disable_RTC_write_protect();
-	RTC->DR = tempDate&0x00FFFF3F;
+	REG_WRITE(&RTC->DR, tempDate&0x00FFFF3F);
 	//enable_RTC_write_protect();
 }
 
@@ -92,12 +128,13 @@ void setTime(RTC_Time* time){
 						(time->RTC_Hours << 16) | \
 						(time->timeMode << 22);
 	//disable_RTC_write_protect();
-	RTC->TR = (tempTime & 0x007F7F7F);
+	REG_WRITE(&RTC->TR, (tempTime & 0x007F7F7F));
 	//enable_RTC_write_protect();
 }
 
 /**
- * returns a string representation fo the current time
+ * returns a string representation fo the current time, taken from the
+ * cache kept by the wakeup interrupt
  * Inputs:
  * 		char* - string to populate with current time(at least 12 characters)
  * Outputs:
@@ -105,48 +142,397 @@ void setTime(RTC_Time* time){
  */
 char* time_to_string(char* time){
 	if(strlen(time)<12){
-		uint8_t one_hour = ((RTC->TR) & 0xF0000)>>16;
-		uint8_t ten_hour = ((RTC->TR) & 0x300000)>>20;
-		uint8_t ten_min = ((RTC->TR) & 0x7000)>>12;
-		uint8_t one_min = ((RTC->TR) & 0xF00)>>8;
-		uint8_t ten_sec = ((RTC->TR) & 0x70)>>4;
-		uint8_t one_sec = (RTC->TR) & 0xF;
-		uint8_t am_pm = ((RTC->TR) & 0x400000)>>22;
-
-		uint8_t hours = (ten_hour<<4) | one_hour;
-		uint8_t mins = (ten_min<<4) | one_min;
-		uint8_t secs = (ten_sec*10)+one_sec;
-
-
-		sprintf(time, "%d%d:%d%d:%d%d ",ten_hour,one_hour,ten_min,one_min,ten_sec,one_sec);
-		if(am_pm){
-			strcat(time,"PM");
-		}else{
-			strcat(time,"AM");
+		RTC_Clock now;
+		rtc_get_clock(&now);
+		uint8_t hours = now.hours%12;
+		if(hours==0){
+			hours = 12;
 		}
-
-		uint32_t ignore = (RTC->DR);	//need to read date to keep system synced.
+		sprintf(time, "%02d:%02d:%02d %s", hours, now.minutes, now.seconds, now.hours>=12 ? "PM" : "AM");
 	}
 	return time;	
 }
 
 /**
  * This function will return a numeric representation of the current hour
+ * from the cached time
  * Inputs:
  * 		none
  * Outputs:
  * 		uint8_t - current hour(24 hour time)
  */
 uint8_t get_Hour(){
-	uint8_t ten_hour = ((RTC->TR) & 0x300000)>>20;
-	uint8_t one_hour = ((RTC->TR) & 0xF0000)>>16;
-	uint8_t am_pm = ((RTC->TR) & 0x400000)>>22;
-	uint8_t hours = (ten_hour*10)+one_hour;
-	if(am_pm==1&&hours!=12){//if PM
-		hours+=12;
+	return cached.hours;
+}
+
+/**
+ * This function will return a numeric representation of the current minute
+ * from the cached time
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		uint8_t - current minute
+ */
+uint8_t get_Minute(){
+	return cached.minutes;
+}
+
+/**
+ * This function will return the minutes since midnight on Jan 1 2000.
+ * The running count does not jump at midnight, so it can be used as a
+ * time stamp that survives resets.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		uint32_t - minutes since 2000
+ */
+uint32_t get_rtc_minutes(){
+	return rtc_seconds()/60;
+}
+
+/**
+ * This function will check whether the calendar is still running from
+ * before a reset. The RTC is in the backup domain, so only a power loss
+ * clears it. Waits for the calendar registers to resync after the reset.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		1 - the calendar has been set and can be read
+ * 		0 - the time and date have to be entered
+ */
+int rtc_is_set(){
+	if((REG_READ(&RTC->ISR) & (1<<INITS)) == 0){
+		return 0;
 	}
-	uint32_t ignore = (RTC->DR);
-	return hours;
+	while((REG_READ(&RTC->ISR) & (1<<RSF)) == 0){}
+	return 1;
+}
+
+/**
+ * Fills the time cache and starts the 1 Hz wakeup interrupt that keeps
+ * it current. Call after the calendar is running, either from init_rtc
+ * or from before the reset. Readers of the time then never touch the
+ * RTC registers.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+void rtc_clock_init(){
+	//the shadow registers resync after a reset or init mode
+	while((REG_READ(&RTC->ISR) & (1<<RSF)) == 0){}
+	read_clock(&cached);
+	prediv_s = REG_READ(&RTC->PRER) & 0x7FFF;
+	ss_scale = (uint32_t)(RTC_STAMP_ONE_SECOND/(prediv_s+1));
+
+	disable_RTC_write_protect();
+	REG_CLEAR(&RTC->CR, (1<<WUTE)|(1<<WUTIE));
+	while((REG_READ(&RTC->ISR) & (1<<WUTWF)) == 0){}
+	REG_WRITE(&RTC->WUTR, 0);			//one ck_spre period
+	REG_WRITE(&RTC->CR, (REG_READ(&RTC->CR) & ~(0b111<<WUCKSEL)) | (0b100<<WUCKSEL));
+	REG_SET(&RTC->CR, (1<<WUTIE)|(1<<WUTE));
+	enable_RTC_write_protect();
+
+	*(EXTI_IMR) |= 1<<RTC_WKUP_EXTI;
+	*(EXTI_RTSR) |= 1<<RTC_WKUP_EXTI;
+	*(EXTI_PR) = 1<<RTC_WKUP_EXTI;
+	*(NVIC_ISER0) = 1<<RTC_WKUP_IRQ;
+}
+
+/**
+ * Copies the cached calendar time. Safe from any context.
+ * Inputs:
+ * 		*clock - destination
+ * Outputs:
+ * 		none
+ */
+void rtc_get_clock(RTC_Clock* clock){
+	uint32_t primask = irq_save();
+	*clock = cached;
+	irq_restore(primask);
+}
+
+/**
+ * Returns the cached seconds since midnight Jan 1 2000
+ */
+uint32_t rtc_seconds(){
+	return cached.epoch;
+}
+
+/**
+ * Registers a function to be called from the wakeup interrupt once a
+ * second, after the cache has been updated.
+ */
+void rtc_set_second_callback(rtc_second_callback callback){
+	second_callback = callback;
+}
+
+void RTC_WKUP_IRQHandler(void){
+	//WUTF is cleared by writing 0, INIT must keep its value
+	REG_WRITE(&RTC->ISR, ~((1<<WUTF)|(1<<INIT)) | (REG_READ(&RTC->ISR) & (1<<INIT)));
+	*(EXTI_PR) = 1<<RTC_WKUP_EXTI;
+
+	//the wakeup can beat the shadow copy of the new second
+	RTC_Clock now;
+	uint32_t tries = 0;
+	do{
+		read_clock(&now);
+	}while(now.epoch == cached.epoch && ++tries < RTC_SYNC_TRIES);
+	cached = now;
+
+	if(second_callback){
+		second_callback();
+	}
+}
+
+/**
+ * Returns the current time with sub-second resolution, one count of
+ * the synchronous prescaler, 1/256 s with the default divider. Cheap
+ * enough for an ISR: three register reads and no division by a
+ * variable. Consecutive calls never go backwards, even across a
+ * calibration shift, until init_rtc sets the calendar again.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		RTC_Stamp - seconds since 2000 and fraction of a second
+ */
+RTC_Stamp rtc_stamp_now(){
+	//reading SSR locks TR and DR until DR is read, an ISR must not cut in between
+	uint32_t primask = irq_save();
+	uint32_t ssr = REG_READ(&RTC->SSR) & 0xFFFF;
+	uint32_t tr = REG_READ(&RTC->TR);
+	uint32_t dr = REG_READ(&RTC->DR);
+
+	RTC_Clock now;
+	decode_clock(tr, dr, &now);
+	uint32_t fraction = ssr <= prediv_s ? (prediv_s - ssr)*ss_scale : 0;
+	RTC_Stamp stamp = ((RTC_Stamp)now.epoch<<32) | fraction;
+
+	if(stamp < last_stamp){
+		stamp = last_stamp;
+	}else{
+		last_stamp = stamp;
+	}
+	irq_restore(primask);
+	return stamp;
+}
+
+/**
+ * Starts time stamping edges on RTC_AF1 (PC13). The RTC latches the
+ * calendar and SSR on the rising edge, so the stamp does not include
+ * interrupt latency. Call after rtc_clock_init.
+ * Inputs:
+ * 		callback - called from the interrupt with each captured stamp
+ * Outputs:
+ * 		none
+ */
+void rtc_stamp_capture_enable(rtc_stamp_callback callback){
+	stamp_callback = callback;
+
+	disable_RTC_write_protect();
+	REG_CLEAR(&RTC->CR, (1<<TSE)|(1<<TSIE)|(1<<TSEDGE));
+	REG_WRITE(&RTC->ISR, ~((1<<TSF)|(1<<TSOVF)|(1<<INIT)) | (REG_READ(&RTC->ISR) & (1<<INIT)));
+	REG_SET(&RTC->CR, (1<<TSIE)|(1<<TSE));
+	enable_RTC_write_protect();
+
+	*(EXTI_IMR) |= 1<<RTC_STAMP_EXTI;
+	*(EXTI_RTSR) |= 1<<RTC_STAMP_EXTI;
+	*(EXTI_PR) = 1<<RTC_STAMP_EXTI;
+	*(NVIC_ISER0) = 1<<RTC_STAMP_IRQ;
+}
+
+/**
+ * Returns the number of edges that came while a stamp was still waiting
+ * to be read. Only the first of them was stamped.
+ */
+uint32_t rtc_stamp_overruns(){
+	return stamp_overruns;
+}
+
+void TAMP_STAMP_IRQHandler(void){
+	uint32_t isr = REG_READ(&RTC->ISR);
+	*(EXTI_PR) = 1<<RTC_STAMP_EXTI;
+	if((isr & (1<<TSF)) == 0){
+		return;
+	}
+
+	uint32_t ssr = REG_READ(&RTC->TSSSR) & 0xFFFF;
+	uint32_t tr = REG_READ(&RTC->TSTR);
+	uint32_t dr = REG_READ(&RTC->TSDR);
+
+	//TSF has to be cleared before TSOVF, INIT must keep its value
+	uint32_t init = isr & (1<<INIT);
+	REG_WRITE(&RTC->ISR, ~((1<<TSF)|(1<<INIT)) | init);
+	if(isr & (1<<TSOVF)){
+		REG_WRITE(&RTC->ISR, ~((1<<TSOVF)|(1<<INIT)) | init);
+		stamp_overruns++;
+	}
+
+	//the capture has no year. An edge in December seen in January is last
+	//year, one on Jan 1 seen before the wakeup has turned the cache is next
+	uint32_t year = cached.year;
+	uint32_t month = ((dr>>12)&0x1)*10 + ((dr>>8)&0xF);
+	if(month > cached.month && year > 0){
+		year--;
+	}else if(month == 1 && cached.month == 12 && year < 99){
+		year++;
+	}
+	dr = (dr & 0xFFFF) | ((year/10)<<20) | ((year%10)<<16);
+
+	RTC_Clock when;
+	decode_clock(tr, dr, &when);
+	uint32_t fraction = ssr <= prediv_s ? (prediv_s - ssr)*ss_scale : 0;
+
+	if(stamp_callback){
+		stamp_callback(((RTC_Stamp)when.epoch<<32) | fraction);
+	}
+}
+
+/**
+ * Trims the RTC frequency with smooth calibration. RTCCLK pulses are
+ * added or masked evenly over each 32 s cycle, about 0.954 ppm a step,
+ * so the calendar never jumps. Feed it the drift measured against a
+ * reference such as a network time source.
+ * Inputs:
+ * 		ppb - parts per billion to speed the clock up, negative slows it
+ * Outputs:
+ * 		0 - calibration written
+ * 		-1 - outside the +-487 ppm the hardware can correct
+ */
+int rtc_calibrate(int32_t ppb){
+	int64_t scaled = (int64_t)ppb << 20;
+	int32_t net = (int32_t)((scaled + (scaled < 0 ? -500000000 : 500000000))/1000000000);
+	if(net < RTC_CAL_MIN || net > RTC_CAL_MAX){
+		return -1;
+	}
+
+	//CALP adds 512 pulses, CALM masks up to 511
+	uint32_t calr = net > 0 ? (1<<CALP) | ((512 - net)<<CALM) : (uint32_t)(-net)<<CALM;
+
+	disable_RTC_write_protect();
+	while(REG_READ(&RTC->ISR) & (1<<RECALPF)){}
+	REG_WRITE(&RTC->CALR, calr);
+	enable_RTC_write_protect();
+	return 0;
+}
+
+/**
+ * Converts a stamp to microseconds since 2000
+ */
+uint64_t rtc_stamp_to_us(RTC_Stamp stamp){
+	return (uint64_t)rtc_stamp_seconds(stamp)*1000000 + (((stamp & 0xFFFFFFFF)*1000000)>>32);
+}
+
+/**
+ * Converts microseconds since 2000 to a stamp
+ */
+RTC_Stamp rtc_stamp_from_us(uint64_t us){
+	uint64_t seconds = us/1000000;
+	uint64_t rest = us - seconds*1000000;
+	return (seconds<<32) | (((rest<<32) + 999999)/1000000);	//rounded up so rtc_stamp_to_us gives us back
+}
+
+/**
+ * Returns later-earlier in microseconds, negative if later is the
+ * older stamp. The seconds and the fraction are scaled apart so the
+ * whole range fits.
+ * Inputs:
+ * 		later - stamp to subtract from
+ * 		earlier - stamp to subtract
+ * Outputs:
+ * 		int64_t - difference in microseconds
+ */
+int64_t rtc_stamp_diff_us(RTC_Stamp later, RTC_Stamp earlier){
+	int64_t diff = (int64_t)(later - earlier);
+	int64_t seconds = diff>>32;				//floor, the fraction below is always positive
+	uint64_t fraction = (uint64_t)diff & 0xFFFFFFFF;
+	return seconds*1000000 + (int64_t)((fraction*1000000)>>32);
+}
+
+/**
+ * Converts the seconds of a stamp to a calendar time
+ * Inputs:
+ * 		stamp - time to convert
+ * 		*clock - destination
+ * Outputs:
+ * 		none
+ */
+void rtc_stamp_to_clock(RTC_Stamp stamp, RTC_Clock* clock){
+	uint32_t epoch = rtc_stamp_seconds(stamp);
+	uint32_t days = epoch/86400;
+	uint32_t secs = epoch - days*86400;
+
+	//2000 is a leap year, so every 4 year cycle starts with one
+	uint32_t year = (days/1461)*4;
+	uint32_t day = days%1461;
+	if(day >= 366){
+		day -= 366;
+		year++;
+		while(day >= 365){
+			day -= 365;
+			year++;
+		}
+	}
+
+	uint32_t leap = (year%4) == 0;
+	uint32_t month = 12;
+	while(month > 1 && day < month_days[month-1] + (month > 2 ? leap : 0)){
+		month--;
+	}
+	day -= month_days[month-1] + (month > 2 ? leap : 0);
+
+	clock->hours = secs/3600;
+	clock->minutes = (secs/60)%60;
+	clock->seconds = secs%60;
+	clock->day = day + 1;
+	clock->month = month;
+	clock->weekday = ((days + 5)%7) + 1;	//Jan 1 2000 was a Saturday
+	clock->year = year;
+	clock->epoch = epoch;
+}
+
+/*
+ * Takes one snapshot of the calendar. Reading TR locks DR until DR is
+ * read, so the two registers are read once each and always agree.
+ */
+static void read_clock(RTC_Clock* clock){
+	uint32_t tr = REG_READ(&RTC->TR);
+	uint32_t dr = REG_READ(&RTC->DR);
+	decode_clock(tr, dr, clock);
+}
+
+/*
+ * Converts TR and DR layout BCD fields, as in the calendar and the time
+ * stamp registers, to a calendar time and its epoch.
+ */
+static void decode_clock(uint32_t tr, uint32_t dr, RTC_Clock* clock){
+	uint32_t hours = ((tr>>20)&0x3)*10 + ((tr>>16)&0xF);
+	if(REG_READ(&RTC->CR) & (1<<FMT)){
+		hours = (hours%12) + (((tr>>PM)&1) ? 12 : 0);
+	}
+	uint32_t mins = ((tr>>12)&0x7)*10 + ((tr>>8)&0xF);
+	uint32_t secs = ((tr>>4)&0x7)*10 + (tr&0xF);
+
+	uint32_t year = ((dr>>20)&0xF)*10 + ((dr>>16)&0xF);
+	uint32_t month = ((dr>>12)&0x1)*10 + ((dr>>8)&0xF);
+	uint32_t day = ((dr>>4)&0x3)*10 + (dr&0xF);
+	if(month < 1 || month > 12){
+		month = 1;
+	}
+
+	uint32_t days = year*365 + (year+3)/4 + month_days[month-1] + day - 1;
+	if(month > 2 && (year%4) == 0){
+		days++;
+	}
+
+	clock->hours = hours;
+	clock->minutes = mins;
+	clock->seconds = secs;
+	clock->day = day;
+	clock->month = month;
+	clock->weekday = (dr>>13)&0x7;
+	clock->year = year;
+	clock->epoch = ((days*24 + hours)*60 + mins)*60 + secs;
 }
 
 /**
@@ -185,7 +571,7 @@ static void enable_RTC_write_protect(){
  */
 static void disable_RTC_init(){
 	//exit init mode
-	RTC->ISR &= ~(1<<INIT);
+	REG_CLEAR(&RTC->ISR, 1<<INIT);
 }
 
 /**
@@ -199,7 +585,7 @@ static void disable_RTC_init(){
 static void enable_RTC_init(){
 	//enter init mode
 	disable_RTC_write_protect();
-	RTC->ISR |= (1<<INIT);
-	while((RTC->ISR & 1<<INITF) != 1<<INITF){}
+	REG_SET(&RTC->ISR, 1<<INIT);
+	while((REG_READ(&RTC->ISR) & 1<<INITF) != 1<<INITF){}
 	//enable_RTC_write_protect();
 }
@@ -0,0 +1,40 @@
+/*
+ * crc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * The lookup table is generated by the preprocessor, so it is built at
+ * compile time and lives in flash. The STM32F4 CRC unit only computes
+ * CRC-32 over whole words, so it cannot produce this checksum.
+ */
+
+#include "crc.h"
+
+//one shift of the bitwise algorithm
+#define CRC_BIT(c) ((((c) & 0x8000) ? (((c)<<1) ^ CRC16_POLY) : ((c)<<1)) & 0xFFFF)
+#define CRC_ENTRY(n) CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT((n)<<8))))))))
+
+#define CRC_ROW4(n) CRC_ENTRY(n), CRC_ENTRY((n)+1), CRC_ENTRY((n)+2), CRC_ENTRY((n)+3)
+#define CRC_ROW16(n) CRC_ROW4(n), CRC_ROW4((n)+4), CRC_ROW4((n)+8), CRC_ROW4((n)+12)
+#define CRC_ROW64(n) CRC_ROW16(n), CRC_ROW16((n)+16), CRC_ROW16((n)+32), CRC_ROW16((n)+48)
+
+const uint16_t crc16_table[256] = {
+	CRC_ROW64(0), CRC_ROW64(64), CRC_ROW64(128), CRC_ROW64(192)
+};
+
+/**
+ * Computes the CRC of a block, one table lookup per byte.
+ * Inputs:
+ * 		*data - bytes to check
+ * 		length - number of bytes
+ * 		crc - CRC16_INIT, or the result of a previous call to continue it
+ * Outputs:
+ * 		the updated CRC
+ */
+uint16_t crc16(const uint8_t* data, uint32_t length, uint16_t crc){
+	while(length--){
+		crc = crc16_update(crc, *data++);
+	}
+	return crc;
+}
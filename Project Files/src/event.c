@@ -0,0 +1,194 @@
+/*
+ * event.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * The queue is a bounded multi producer, single consumer ring. Every
+ * cell carries a sequence number: a producer claims a cell by moving
+ * the put counter forward with compare and swap, fills it, then
+ * publishes it by advancing its sequence. A post from an ISR that
+ * interrupts another post simply claims the next cell. The consumer
+ * only takes a cell once it has been published, so a slow producer
+ * holds up dispatch but never corrupts it.
+ */
+
+#include "event.h"
+#include "timer.h"
+#include "irq.h"
+#include "mmio.h"
+#include <stddef.h>
+
+#define QUEUE_MASK (EVENT_QUEUE_SIZE-1)
+
+_Static_assert((EVENT_QUEUE_SIZE & QUEUE_MASK) == 0, "EVENT_QUEUE_SIZE must be a power of two");
+
+typedef struct{
+	volatile uint32_t sequence;
+	Event event;
+} Cell;
+
+static Cell queue[EVENT_QUEUE_SIZE];
+static volatile uint32_t put;		//claimed by producers
+static uint32_t get;				//only touched by the loop
+static event_handler handlers[EV_TYPES];
+static EventStats stats;
+
+/**
+ * Empties the queue and clears the handlers and statistics. The cycle
+ * counter keeps running while the core sleeps, so idle time and
+ * timestamps stay accurate; the core itself still stops in WFI.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+void event_init(){
+	*(DBGMCU_CR) |= 1<<DBGMCU_DBG_SLEEP_F;
+
+	for(uint32_t i=0;i<EVENT_QUEUE_SIZE;i++){
+		queue[i].sequence = i;
+	}
+	put = get = 0;
+	for(uint32_t i=0;i<EV_TYPES;i++){
+		handlers[i] = NULL;
+	}
+	stats = (EventStats){0};
+}
+
+/**
+ * Registers the function that handles every event of a type. Handlers
+ * run in thread context from the loop and must not block.
+ * Inputs:
+ * 		type - event type
+ * 		handler - function to call, NULL to drop events of this type
+ * Outputs:
+ * 		none
+ */
+void event_subscribe(EventType type, event_handler handler){
+	if(type < EV_TYPES){
+		handlers[type] = handler;
+	}
+}
+
+/**
+ * Queues an event. Safe to call from any ISR or from thread context.
+ * Never blocks.
+ * Inputs:
+ * 		type - event type
+ * 		data - passed to the handler
+ * Outputs:
+ * 		1 - event queued
+ * 		0 - queue full, the event was counted as an overflow
+ */
+int event_post(EventType type, uint32_t data){
+	uint32_t p = __atomic_load_n(&put, __ATOMIC_RELAXED);
+	Cell* cell;
+	for(;;){
+		cell = &queue[p & QUEUE_MASK];
+		int32_t diff = (int32_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - p);
+		if(diff == 0){
+			if(__atomic_compare_exchange_n(&put, &p, p+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+				break;
+			}
+		}else if(diff < 0){
+			__atomic_fetch_add(&stats.overflows, 1, __ATOMIC_RELAXED);
+			return 0;
+		}else{
+			p = __atomic_load_n(&put, __ATOMIC_RELAXED);
+		}
+	}
+
+	cell->event.type = type;
+	cell->event.data = data;
+	cell->event.posted = REG_READ(DWT_CYCCNT);
+	__atomic_store_n(&cell->sequence, p+1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/**
+ * Runs the handler for the oldest published event, timing how long it
+ * waited and how long it ran.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		1 - an event was dispatched
+ * 		0 - the queue is empty
+ */
+int event_dispatch(){
+	Cell* cell = &queue[get & QUEUE_MASK];
+	if(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != get+1){
+		return 0;
+	}
+
+	Event event = cell->event;
+	__atomic_store_n(&cell->sequence, get+EVENT_QUEUE_SIZE, __ATOMIC_RELEASE);
+	get++;
+
+	event_handler handler = event.type < EV_TYPES ? handlers[event.type] : NULL;
+	if(handler == NULL){
+		stats.unhandled++;
+		return 1;
+	}
+
+	uint32_t start = REG_READ(DWT_CYCCNT);
+	handler(&event);
+	uint32_t run = REG_READ(DWT_CYCCNT) - start;
+
+	HandlerStats* h = &stats.handlers[event.type];
+	uint32_t latency = start - event.posted;
+	h->count++;
+	h->total_run += run;
+	if(latency > h->max_latency){
+		h->max_latency = latency;
+	}
+	if(run > h->max_run){
+		h->max_run = run;
+	}
+	return 1;
+}
+
+/**
+ * Dispatches events forever. When the queue is empty the core sleeps
+ * until the next interrupt. Interrupts are masked between the final
+ * check and WFI so an event posted in that window still wakes the core.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none, never returns
+ */
+void event_loop(){
+	stats.started = now_cycles();
+	while(1){
+		while(event_dispatch()){}
+
+		uint32_t primask = irq_save();
+		Cell* cell = &queue[get & QUEUE_MASK];
+		if(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != get+1){
+			uint64_t slept = now_cycles();
+#ifndef HOST_EMULATION
+			__asm volatile ("wfi" ::: "memory");
+#endif
+			stats.idle += now_cycles() - slept;
+		}
+		irq_restore(primask);
+	}
+}
+
+/**
+ * Returns the loop and handler counters. Cycle counts are at the core clock.
+ */
+const EventStats* event_stats(){
+	return &stats;
+}
+
+/**
+ * Returns the share of time since the loop started spent asleep, in percent
+ */
+uint32_t event_idle_percent(){
+	uint64_t elapsed = now_cycles() - stats.started;
+	if(stats.started == 0 || elapsed == 0){
+		return 0;
+	}
+	return (uint32_t)((stats.idle*100)/elapsed);
+}
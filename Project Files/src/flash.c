@@ -0,0 +1,84 @@
+/*
+ * flash.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ */
+
+#include "flash.h"
+#include "mmio.h"
+
+static void unlock();
+static void lock();
+static int wait_idle();
+
+/**
+ * Erases one sector, every byte reads back as 0xFF.
+ * Inputs:
+ * 		sector - sector number, 0 to 7
+ * Outputs:
+ * 		0 - erased
+ * 		-1 - the flash interface reported an error
+ */
+int flash_erase_sector(uint32_t sector){
+	unlock();
+	REG_WRITE(FLASH_SR, FLASH_ERRORS);
+	REG_WRITE(FLASH_CR, (0b10<<FLASH_PSIZE)|(sector<<FLASH_SNB)|(1<<FLASH_SER));
+	REG_SET(FLASH_CR, 1<<FLASH_STRT);
+	int result = wait_idle();
+	REG_CLEAR(FLASH_CR, 1<<FLASH_SER);
+	lock();
+
+	//the data cache may still hold the old contents
+	uint32_t acr = REG_READ(FLASH_ACR);
+	if(acr & (1<<FLASH_DCEN)){
+		REG_WRITE(FLASH_ACR, acr & ~(1<<FLASH_DCEN));
+		REG_WRITE(FLASH_ACR, (acr & ~(1<<FLASH_DCEN)) | (1<<FLASH_DCRST));
+		REG_WRITE(FLASH_ACR, acr);
+	}
+	return result;
+}
+
+/**
+ * Programs words into erased flash, in order. Programming can only clear
+ * bits, so every word must still be erased for the result to be exact.
+ * Inputs:
+ * 		*address - word aligned destination in flash
+ * 		*words - data to write
+ * 		count - number of words
+ * Outputs:
+ * 		0 - programmed and read back
+ * 		-1 - the flash interface reported an error or a word did not verify
+ */
+int flash_program(volatile uint32_t* address, const uint32_t* words, uint32_t count){
+	int result = 0;
+	unlock();
+	REG_WRITE(FLASH_SR, FLASH_ERRORS);
+	REG_WRITE(FLASH_CR, (0b10<<FLASH_PSIZE)|(1<<FLASH_PG));
+	for(uint32_t i=0;i<count && result==0;i++){
+		address[i] = words[i];
+		result = wait_idle();
+		if(result==0 && address[i] != words[i]){
+			result = -1;
+		}
+	}
+	REG_CLEAR(FLASH_CR, 1<<FLASH_PG);
+	lock();
+	return result;
+}
+
+static void unlock(){
+	if(REG_READ(FLASH_CR) & (1<<FLASH_LOCK)){
+		REG_WRITE(FLASH_KEYR, FLASH_KEY1);
+		REG_WRITE(FLASH_KEYR, FLASH_KEY2);
+	}
+}
+
+static void lock(){
+	REG_SET(FLASH_CR, 1<<FLASH_LOCK);
+}
+
+static int wait_idle(){
+	while(REG_READ(FLASH_SR) & (1<<FLASH_BSY)){}
+	return (REG_READ(FLASH_SR) & FLASH_ERRORS) ? -1 : 0;
+}
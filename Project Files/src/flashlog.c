@@ -0,0 +1,358 @@
+/*
+ * flashlog.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ */
+
+#include "flashlog.h"
+#include "flash.h"
+#include "crc.h"
+
+#define SECTOR_WORDS (FLASHLOG_SECTOR_SIZE/4)
+#define SLOT_WORDS 4
+#define ERASED 0xFFFFFFFF
+#define HEADER 0
+#define INDEX 4
+#define RECORDS (INDEX+FLASHLOG_INDEX_ENTRIES)
+#define PARTS(words) (((words)+1+FLASHLOG_DATA_WORDS-1)/FLASHLOG_DATA_WORDS)
+#define RESERVE ((PARTS(FLASHLOG_MAX_CHECKPOINT)+FLASHLOG_CHECKPOINT_INTERVAL)*SLOT_WORDS)
+
+_Static_assert(RECORDS % SLOT_WORDS == 0, "records must start on a slot boundary");
+_Static_assert(PARTS(FLASHLOG_MAX_CHECKPOINT) <= 256, "checkpoint parts are numbered in 8 bits");
+
+//from LinkerScript.ld
+extern uint32_t _flashlog_start[];
+
+static int active = -1;
+static uint32_t next;				//word offset of the next free slot
+static uint32_t replay_start;		//first slot after the loaded checkpoint
+static uint32_t index_used;
+static uint32_t top_generation;		//newest header seen, valid or not
+static int formatted;				//a header has been seen
+static FlashLogStats stats;
+
+static volatile uint32_t* sector(int s);
+static void make_slot(uint32_t* slot, uint8_t type, uint8_t tag, const uint32_t* data);
+static int slot_valid(volatile const uint32_t* slot);
+static int slot_erased(volatile const uint32_t* slot);
+static int header_valid(volatile const uint32_t* base);
+static int load_checkpoint(volatile const uint32_t* base, uint32_t offset, uint32_t* words, uint32_t capacity);
+static int open_sector(int s, uint32_t* checkpoint, uint32_t capacity);
+static int write_checkpoint(volatile uint32_t* base, uint32_t offset, const uint32_t* words, uint32_t count);
+static int move_sector(const uint32_t* words, uint32_t count);
+
+/**
+ * Finds the newest sector and loads its newest checkpoint. The records
+ * written after it are handed over by flashlog_replay.
+ * Inputs:
+ * 		*checkpoint - destination for the checkpoint words
+ * 		capacity - size of checkpoint in words
+ * Outputs:
+ * 		>0 - number of checkpoint words loaded
+ * 		0 - the log is empty, the first checkpoint creates it
+ */
+int flashlog_init(uint32_t* checkpoint, uint32_t capacity){
+	//sectors with a valid header, newest first
+	int order[FLASHLOG_SECTORS];
+	uint32_t found = 0;
+	formatted = 0;
+	for(int s=0;s<FLASHLOG_SECTORS;s++){
+		if(!header_valid(sector(s))){
+			continue;
+		}
+		uint32_t generation = sector(s)[HEADER+1];
+		if(!formatted || (int32_t)(generation - top_generation) > 0){
+			top_generation = generation;
+		}
+		formatted = 1;
+
+		uint32_t i = found++;
+		while(i > 0 && (int32_t)(generation - sector(order[i-1])[HEADER+1]) > 0){
+			order[i] = order[i-1];
+			i--;
+		}
+		order[i] = s;
+	}
+
+	active = -1;
+	for(uint32_t i=0;i<found;i++){
+		int loaded = open_sector(order[i], checkpoint, capacity);
+		if(loaded >= 0){
+			return loaded;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Calls replay for every caller record written after the checkpoint
+ * loaded by flashlog_init, oldest first. Call it once, before anything
+ * is appended.
+ * Inputs:
+ * 		replay - record handler
+ * Outputs:
+ * 		none
+ */
+void flashlog_replay(flashlog_replay_handler replay){
+	if(active < 0){
+		return;
+	}
+	volatile uint32_t* base = sector(active);
+	for(uint32_t slot=replay_start;slot<next;slot+=SLOT_WORDS){
+		if(slot_valid(&base[slot]) && (base[slot]>>24) != FLASHLOG_CHECKPOINT_TYPE){
+			uint32_t data[FLASHLOG_DATA_WORDS];
+			for(uint32_t i=0;i<FLASHLOG_DATA_WORDS;i++){
+				data[i] = base[slot+1+i];
+			}
+			replay(base[slot]>>24, base[slot]>>16, data);
+		}
+	}
+}
+
+/**
+ * Writes one record. The sector always keeps room for a checkpoint and
+ * FLASHLOG_CHECKPOINT_INTERVAL records, so as long as checkpoints are
+ * written when flashlog_checkpoint_due asks, this only fails on a
+ * flash error or before the first checkpoint.
+ * Inputs:
+ * 		type - 1 to 0x7E
+ * 		tag - caller defined
+ * 		*data - FLASHLOG_DATA_WORDS words
+ * Outputs:
+ * 		0 - written
+ * 		-1 - no active sector, no room or a flash error
+ */
+int flashlog_append(uint8_t type, uint8_t tag, const uint32_t* data){
+	if(active < 0 || next + SLOT_WORDS > SECTOR_WORDS){
+		return -1;
+	}
+
+	uint32_t slot[SLOT_WORDS];
+	make_slot(slot, type, tag, data);
+	volatile uint32_t* base = sector(active);
+	int result = flash_program(&base[next], slot, SLOT_WORDS);
+	next += SLOT_WORDS;		//a failed slot is not reused
+	stats.used = next*4;
+	if(result < 0){
+		stats.errors++;
+		return -1;
+	}
+	stats.records++;
+	return 0;
+}
+
+/**
+ * Writes the caller's whole state. Moves to the other sector when the
+ * active one is short of room or out of index entries.
+ * Inputs:
+ * 		*words - state to save
+ * 		count - number of words, at most FLASHLOG_MAX_CHECKPOINT
+ * Outputs:
+ * 		0 - written
+ * 		-1 - too long or a flash error
+ */
+int flashlog_checkpoint(const uint32_t* words, uint32_t count){
+	if(count > FLASHLOG_MAX_CHECKPOINT){
+		return -1;
+	}
+
+	uint32_t length = PARTS(count)*SLOT_WORDS;
+	if(active < 0 || index_used >= FLASHLOG_INDEX_ENTRIES ||
+			next + length + FLASHLOG_CHECKPOINT_INTERVAL*SLOT_WORDS > SECTOR_WORDS){
+		return move_sector(words, count);
+	}
+
+	volatile uint32_t* base = sector(active);
+	uint32_t offset = next;
+	next += length;
+	stats.used = next*4;
+	if(write_checkpoint(base, offset, words, count) < 0 ||
+			flash_program(&base[INDEX+index_used], &offset, 1) < 0){
+		stats.errors++;
+		return -1;
+	}
+	index_used++;
+	stats.records = 0;
+	return 0;
+}
+
+/**
+ * Returns nonzero when a checkpoint should be written: enough records
+ * have gone by, the sector is getting full, or there is no log yet.
+ */
+int flashlog_checkpoint_due(){
+	return active < 0 || stats.records >= FLASHLOG_CHECKPOINT_INTERVAL ||
+			index_used >= FLASHLOG_INDEX_ENTRIES || next + RESERVE > SECTOR_WORDS;
+}
+
+/**
+ * Returns the log counters
+ */
+const FlashLogStats* flashlog_stats(){
+	return &stats;
+}
+
+static volatile uint32_t* sector(int s){
+	return (volatile uint32_t*)_flashlog_start + s*SECTOR_WORDS;
+}
+
+/*
+ * Slot layout: type in bits 31-24 of the first word, tag in 23-16 and
+ * the CRC of type, tag and data in 15-0, then the data words.
+ */
+static void make_slot(uint32_t* slot, uint8_t type, uint8_t tag, const uint32_t* data){
+	uint16_t crc = crc16_update(crc16_update(CRC16_INIT, type), tag);
+	for(uint32_t i=0;i<FLASHLOG_DATA_WORDS;i++){
+		slot[1+i] = data[i];
+	}
+	crc = crc16((const uint8_t*)&slot[1], FLASHLOG_DATA_WORDS*4, crc);
+	slot[0] = ((uint32_t)type<<24) | ((uint32_t)tag<<16) | crc;
+}
+
+static int slot_valid(volatile const uint32_t* slot){
+	uint32_t copy[SLOT_WORDS];
+	for(uint32_t i=0;i<SLOT_WORDS;i++){
+		copy[i] = slot[i];
+	}
+	uint32_t check[SLOT_WORDS];
+	make_slot(check, copy[0]>>24, copy[0]>>16, &copy[1]);
+	return check[0] == copy[0] && (copy[0]>>24) != 0 && (copy[0]>>24) <= FLASHLOG_CHECKPOINT_TYPE;
+}
+
+static int slot_erased(volatile const uint32_t* slot){
+	return (slot[0] & slot[1] & slot[2] & slot[3]) == ERASED;
+}
+
+static int header_valid(volatile const uint32_t* base){
+	return base[HEADER] == FLASHLOG_MAGIC && base[HEADER+2] == ~base[HEADER+1];
+}
+
+/*
+ * Checkpoint parts carry their number in the tag. The first data word
+ * of part 0 is the word count, the state follows.
+ */
+static int load_checkpoint(volatile const uint32_t* base, uint32_t offset, uint32_t* words, uint32_t capacity){
+	if(offset < RECORDS || offset % SLOT_WORDS != 0 || offset + SLOT_WORDS > SECTOR_WORDS){
+		return -1;
+	}
+	volatile const uint32_t* slot = &base[offset];
+	if(!slot_valid(slot) || (slot[0]>>24) != FLASHLOG_CHECKPOINT_TYPE || ((slot[0]>>16) & 0xFF) != 0){
+		return -1;
+	}
+	uint32_t count = slot[1];
+	if(count > capacity || offset + PARTS(count)*SLOT_WORDS > SECTOR_WORDS){
+		return -1;
+	}
+
+	for(uint32_t part=0;part<PARTS(count);part++){
+		slot = &base[offset + part*SLOT_WORDS];
+		if(!slot_valid(slot) || (slot[0]>>24) != FLASHLOG_CHECKPOINT_TYPE || ((slot[0]>>16) & 0xFF) != part){
+			return -1;
+		}
+		for(uint32_t i=0;i<FLASHLOG_DATA_WORDS;i++){
+			uint32_t n = part*FLASHLOG_DATA_WORDS + i;		//0 is the count
+			if(n > 0 && n <= count){
+				words[n-1] = slot[1+i];
+			}
+		}
+	}
+	return count;
+}
+
+/*
+ * Makes a sector active if one of its checkpoints loads, and finds the
+ * end of the records after it.
+ */
+static int open_sector(int s, uint32_t* checkpoint, uint32_t capacity){
+	volatile uint32_t* base = sector(s);
+	index_used = 0;
+	while(index_used < FLASHLOG_INDEX_ENTRIES && base[INDEX+index_used] != ERASED){
+		index_used++;
+	}
+
+	//newest checkpoint that reads back whole, an older one if it was torn
+	int loaded = -1;
+	uint32_t offset = RECORDS;
+	for(uint32_t i=index_used;i>0 && loaded<0;i--){
+		offset = base[INDEX+i-1];
+		loaded = load_checkpoint(base, offset, checkpoint, capacity);
+	}
+	if(loaded < 0){
+		return -1;
+	}
+
+	active = s;
+	stats.generation = base[HEADER+1];
+	stats.records = 0;
+	replay_start = offset + PARTS(loaded)*SLOT_WORDS;
+	next = replay_start;
+	while(next + SLOT_WORDS <= SECTOR_WORDS && !slot_erased(&base[next])){
+		if(!slot_valid(&base[next])){
+			stats.torn++;
+		}else if((base[next]>>24) != FLASHLOG_CHECKPOINT_TYPE){
+			stats.records++;
+		}
+		next += SLOT_WORDS;
+	}
+	stats.used = next*4;
+	return loaded;
+}
+
+static int write_checkpoint(volatile uint32_t* base, uint32_t offset, const uint32_t* words, uint32_t count){
+	for(uint32_t part=0;part<PARTS(count);part++){
+		uint32_t data[FLASHLOG_DATA_WORDS];
+		for(uint32_t i=0;i<FLASHLOG_DATA_WORDS;i++){
+			uint32_t n = part*FLASHLOG_DATA_WORDS + i;
+			data[i] = n == 0 ? count : n <= count ? words[n-1] : ERASED;
+		}
+		uint32_t slot[SLOT_WORDS];
+		make_slot(slot, FLASHLOG_CHECKPOINT_TYPE, part, data);
+		if(flash_program(&base[offset + part*SLOT_WORDS], slot, SLOT_WORDS) < 0){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Starts the other sector with a checkpoint. The header goes in last,
+ * so the sector only takes over once the checkpoint is complete.
+ */
+static int move_sector(const uint32_t* words, uint32_t count){
+	int target = active < 0 ? 0 : (active+1) % FLASHLOG_SECTORS;
+	volatile uint32_t* base = sector(target);
+
+	int erased = 1;
+	for(uint32_t i=0;i<SECTOR_WORDS && erased;i++){
+		erased = base[i] == ERASED;
+	}
+	if(!erased){
+		stats.erases++;
+		if(flash_erase_sector(FLASHLOG_FIRST_SECTOR + target) < 0){
+			stats.errors++;
+			return -1;
+		}
+	}
+
+	uint32_t offset = RECORDS;
+	uint32_t generation = formatted ? top_generation+1 : 0;
+	uint32_t header[3] = {FLASHLOG_MAGIC, generation, ~generation};
+	if(write_checkpoint(base, offset, words, count) < 0 ||
+			flash_program(&base[INDEX], &offset, 1) < 0 ||
+			flash_program(&base[HEADER], header, 3) < 0){
+		stats.errors++;
+		return -1;
+	}
+
+	active = target;
+	formatted = 1;
+	top_generation = generation;
+	stats.generation = generation;
+	index_used = 1;
+	next = RECORDS + PARTS(count)*SLOT_WORDS;
+	replay_start = next;
+	stats.used = next*4;
+	stats.records = 0;
+	return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * frame.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ */
+
+#include "frame.h"
+#include "nic.h"
+#include "crc.h"
+#include <string.h>
+
+_Static_assert(PBUF_HEADROOM >= 1+FRAME_HEADER_SIZE, "no headroom for the preamble and header");
+
+static uint8_t address = FRAME_BROADCAST;
+static FrameStats stats;
+
+static int accept_header(const uint8_t* header);
+
+/**
+ * Sets this node's address and installs the header filter on the NIC.
+ * nic_init must be called first.
+ * Inputs:
+ * 		addr - node address, FRAME_ADDRESS_FROM_UID to derive one from the
+ * 			device's unique ID. FRAME_BROADCAST is not a valid address.
+ * Outputs:
+ * 		none
+ */
+void frame_init(uint8_t addr){
+	if(addr == FRAME_ADDRESS_FROM_UID){
+		uint32_t uid = *(NIC_UID) ^ *(NIC_UID+1) ^ *(NIC_UID+2);
+		uid ^= uid>>16;
+		uid ^= uid>>8;
+		addr = uid;
+		//keep clear of the two reserved values
+		if(addr == FRAME_ADDRESS_FROM_UID || addr == FRAME_BROADCAST){
+			addr = 0x01;
+		}
+	}
+	address = addr;
+	nic_set_rx_filter(FRAME_HEADER_SIZE, accept_header);
+}
+
+/**
+ * Returns this node's address
+ */
+uint8_t frame_address(){
+	return address;
+}
+
+/**
+ * Builds a frame around the payload and queues it on the NIC. Never
+ * blocks.
+ * Inputs:
+ * 		dst - destination address or FRAME_BROADCAST
+ * 		*payload - bytes to send
+ * 		length - number of bytes, at most FRAME_MAX_PAYLOAD
+ * Outputs:
+ * 		1 - frame queued
+ * 		0 - payload too long, no free buffer or transmit queue full
+ */
+int frame_send(uint8_t dst, const uint8_t* payload, uint32_t length){
+	if(length > FRAME_MAX_PAYLOAD){
+		return 0;
+	}
+
+	PacketBuf* p = pbuf_alloc();
+	if(p == NULL){
+		return 0;
+	}
+	memcpy(pbuf_append(p, length), payload, length);
+	return frame_send_buf(dst, p);
+}
+
+/**
+ * Wraps a packet buffer holding a payload in a frame and queues it on
+ * the NIC. The header goes into the headroom and the CRC after the
+ * payload, so nothing is copied. The NIC takes over the caller's
+ * reference whether or not the frame is queued.
+ * Inputs:
+ * 		dst - destination address or FRAME_BROADCAST
+ * 		*p - payload, at most FRAME_MAX_PAYLOAD bytes
+ * Outputs:
+ * 		1 - frame queued
+ * 		0 - payload too long or transmit queue full, the buffer has been freed
+ */
+int frame_send_buf(uint8_t dst, PacketBuf* p){
+	uint32_t length = p->length;
+	if(length > FRAME_MAX_PAYLOAD){
+		pbuf_free(p);
+		return 0;
+	}
+
+	FrameHeader* header = (FrameHeader*)pbuf_push(p, FRAME_HEADER_SIZE);
+	header->dst = dst;
+	header->src = address;
+	header->version = FRAME_VERSION;
+	header->length = length;
+
+	uint16_t crc = crc16(pbuf_data(p), p->length, CRC16_INIT);
+	uint8_t* trailer = pbuf_append(p, FRAME_CRC_SIZE);
+	trailer[0] = crc>>8;
+	trailer[1] = crc;
+
+	return nic_send_buf(p);
+}
+
+/**
+ * Takes the next frame addressed to this node off the NIC. Frames that
+ * fail the length or CRC check are counted and skipped. Never blocks.
+ * Inputs:
+ * 		*frame - destination, header.length gives the payload size
+ * Outputs:
+ * 		1 - a frame was received
+ * 		0 - no frame is waiting
+ */
+int frame_receive(Frame* frame){
+	PacketBuf* p = frame_receive_buf(&frame->header);
+	if(p == NULL){
+		return 0;
+	}
+	memcpy(frame->payload, pbuf_data(p), p->length);
+	pbuf_free(p);
+	return 1;
+}
+
+/**
+ * Takes the next good frame addressed to this node off the NIC without
+ * copying it. The header and CRC are stripped from the buffer.
+ * Inputs:
+ * 		*header - filled in with the frame's header
+ * Outputs:
+ * 		the payload, which the caller must pbuf_free, or NULL if no frame is waiting
+ */
+PacketBuf* frame_receive_buf(FrameHeader* header){
+	PacketBuf* p;
+	while((p = nic_receive_buf()) != NULL){
+		const FrameHeader* h = (const FrameHeader*)pbuf_data(p);
+		if(p->length < FRAME_HEADER_SIZE+FRAME_CRC_SIZE
+				|| p->length != FRAME_HEADER_SIZE+h->length+FRAME_CRC_SIZE){
+			stats.length_errors++;
+			pbuf_free(p);
+			continue;
+		}
+
+		//the CRC over the data and its own trailer leaves no remainder
+		if(crc16(pbuf_data(p), p->length, CRC16_INIT) != 0){
+			stats.crc_errors++;
+			pbuf_free(p);
+			continue;
+		}
+
+		*header = *h;
+		pbuf_pull(p, FRAME_HEADER_SIZE);
+		pbuf_trim(p, FRAME_CRC_SIZE);
+		return p;
+	}
+	return NULL;
+}
+
+/**
+ * Returns the frame check counters
+ */
+const FrameStats* frame_stats(){
+	return &stats;
+}
+
+/*
+ * Header filter run by the NIC's receive ISR as soon as the header has
+ * been decoded. Keeps frames for this node or broadcast, of a version
+ * it understands, that it did not send itself.
+ */
+static int accept_header(const uint8_t* header){
+	const FrameHeader* h = (const FrameHeader*)header;
+	return h->version == FRAME_VERSION
+			&& (h->dst == address || h->dst == FRAME_BROADCAST)
+			&& h->src != address;
+}
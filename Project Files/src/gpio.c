@@ -5,16 +5,14 @@
  *      Author: larsonma
  *  This is an API designed to make GPIO initialization and modification easy to
  *  use, while minimizing risk of mistakes. Currently works for ports A,B, and C
+ *
+ *  The single pin functions look the port up at run time. Drivers that
+ *  touch several pins, or a pin on a hot path, use the PinGroup functions
+ *  in gpio.h instead.
  */
  
 #include "gpio.h"
 
-static volatile GPIOx *GPIOA = (GPIOx *) 0x40020000;
-static volatile GPIOx *GPIOB = (GPIOx *) 0x40020400;
-static volatile GPIOx *GPIOC = (GPIOx *) 0x40020800;
-
-static void set_low_reg_alt_func(char port, uint8_t pin, uint8_t altFunc);
-static void set_high_reg_alt_func(char port, uint8_t pin,uint8_t altFunc);
 static volatile GPIOx* assignPort(char port);
 
 /*
@@ -54,32 +52,9 @@ void enable_clock(char port){
  * 		none
  */
 void set_pin_mode(char port, uint8_t pin, Mode mode){
-	if(pin >=0 && pin <= 15){
-		volatile GPIOx* portX = assignPort(port);
-		
-		//check to see if port is null
-		if(!portX) return;
-		
-		//clear pins associated with pin mode
-		portX->MODER &= ~(0b11<<(pin*2));
-		
-		//set pin according to MODE specified
-		switch(mode){
-			case INPUT:
-				portX->MODER |= (0b00<<(pin*2));
-				break;
-			case OUTPUT:
-				portX->MODER |= (0b01<<(pin*2));
-				break;
-			case ALTFUNC:
-				portX->MODER |= (0b10<<(pin*2));
-				break;
-			case ANALOG:
-				portX->MODER |= (0b11<<(pin*2));
-				break;
-			default:
-				return;
-		}
+	volatile GPIOx* portX = assignPort(port);
+	if(pin <= 15 && portX && mode <= ANALOG){
+		gpio_group_mode(PIN(portX, pin), mode);
 	}
 }
 
@@ -95,27 +70,10 @@ void set_pin_mode(char port, uint8_t pin, Mode mode){
  * 		none
  */
 void set_pin_output_type(char port, uint8_t pin, OutputType outtype){
-	if(pin >= 0 && pin <= 15){
-		volatile GPIOx* portX = assignPort(port);
-		
-		//check to see if port is null
-		if(!portX) return;
-
-		//clear pin specified
-		portX->OTYPER &= ~(1<<pin);
-
-		//switch output type of pin to type specified.
-		switch(outtype){
-			case PUSH_PULL:
-				portX->OTYPER |= (0<<pin);
-				break;
-			case OPEN_DRAIN:
-				portX->OTYPER |= (1<<pin);
-				break;
-			default:
-				return;
-		}
-	}		
+	volatile GPIOx* portX = assignPort(port);
+	if(pin <= 15 && portX && outtype <= OPEN_DRAIN){
+		gpio_group_output_type(PIN(portX, pin), outtype);
+	}
 }
 
 /*
@@ -130,33 +88,10 @@ void set_pin_output_type(char port, uint8_t pin, OutputType outtype){
  * 		none
  */
 void set_output_speed(char port, uint8_t pin, Speed speed){
-	if(pin >= 0 && pin <= 15){
-		volatile GPIOx* portX = assignPort(port);
-		
-		//check to see if port is null
-		if(!portX) return;
-
-		//clear speed set at specified pin
-		portX->OSPEEDR &= ~(0b11<<(pin*2));
-
-		//set pin to specified speed
-		switch(speed){
-			case LOW:
-				portX->OSPEEDR |= (0b00<<(pin*2));
-				break;
-			case MED:
-				portX->OSPEEDR |= (0b01<<(pin*2));
-				break;
-			case FAST:
-				portX->OSPEEDR |= (0b10<<(pin*2));
-				break;
-			case HIGH:
-				portX->OSPEEDR |= (0b11<<(pin*2));
-				break;
-			default:
-				return;
-		}
-	}		
+	volatile GPIOx* portX = assignPort(port);
+	if(pin <= 15 && portX && speed <= HIGH){
+		gpio_group_speed(PIN(portX, pin), speed);
+	}
 }
 
 /*
@@ -171,30 +106,10 @@ void set_output_speed(char port, uint8_t pin, Speed speed){
  * 		none
  */
 void set_pin_PUPDR(char port, uint8_t pin, PullType pulltype){
-	if(pin >= 0 && pin <= 15){
-		volatile GPIOx* portX = assignPort(port);
-		
-		//check to see if portX is null
-		if(!portX) return;
-
-		//clear pull type set at specified pin
-		portX->PUPDR &= ~(0b11<<(pin*2));
-
-		//set pin the the specified pull type
-		switch(pulltype){
-			case NONE:
-				portX->PUPDR |= (0b00<<(pin*2));
-				break;
-			case PULLUP:
-				portX->PUPDR |= (0b01<<(pin*2));
-				break;
-			case PULLDOWN:
-				portX->PUPDR |= (0b10<<(pin*2));
-				break;
-			default:
-				return;
-		}
-	}		
+	volatile GPIOx* portX = assignPort(port);
+	if(pin <= 15 && portX && pulltype <= PULLDOWN){
+		gpio_group_pull(PIN(portX, pin), pulltype);
+	}
 }
 
 /*
@@ -209,138 +124,9 @@ void set_pin_PUPDR(char port, uint8_t pin, PullType pulltype){
  * 		none
  */
 void set_alt_func(char port, uint8_t pin, uint8_t altFunc){
-	if(pin >= 0 && pin <=7){
-		set_low_reg_alt_func(port,pin,altFunc);		//if pin corresponds to pin 0-7, use the alternate function low register
-	}else if(pin >=8 && pin <= 15){
-		set_high_reg_alt_func(port,pin,altFunc);	//if pin corresponds to pin 8-15, use the alternate function high register
-	}else{
-		return;
-	}
-}
-
-static void set_low_reg_alt_func(char port, uint8_t pin, uint8_t altFunc){
 	volatile GPIOx* portX = assignPort(port);
-		
-	//check to see if port is null
-	if(!portX) return;
-			
-	portX->AFRL &= ~(0b1111<<(pin*4));
-
-	switch(altFunc){
-		case 0:
-			portX->AFRL |= (0b0000<<(pin*4));
-			break;
-		case 1:
-			portX->AFRL |= (0b0001<<(pin*4));
-			break;
-		case 2:
-			portX->AFRL |= (0b0010<<(pin*4));
-			break;
-		case 3:
-			portX->AFRL |= (0b0011<<(pin*4));
-			break;
-		case 4:
-			portX->AFRL |= (0b0100<<(pin*4));
-			break;
-		case 5:
-			portX->AFRL |= (0b0101<<(pin*4));
-			break;
-		case 6:
-			portX->AFRL |= (0b0110<<(pin*4));
-			break;
-		case 7:
-			portX->AFRL |= (0b0111<<(pin*4));
-			break;
-		case 8:
-			portX->AFRL |= (0b1000<<(pin*4));
-			break;
-		case 9:
-			portX->AFRL |= (0b1001<<(pin*4));
-			break;
-		case 10:
-			portX->AFRL |= (0b1010<<(pin*4));
-			break;
-		case 11:
-			portX->AFRL |= (0b1011<<(pin*4));
-			break;
-		case 12:
-			portX->AFRL |= (0b1100<<(pin*4));
-			break;
-		case 13:
-			portX->AFRL |= (0b1101<<(pin*4));
-			break;
-		case 14:
-			portX->AFRL |= (0b1110<<(pin*4));
-			break;
-		case 15:
-			portX->AFRL |= (0b1111<<(pin*4));
-			break;
-		default:
-			return;
-	}
-}
-
-static void set_high_reg_alt_func(char port, uint8_t pin,uint8_t altFunc){
-	pin -= 8;
-	
-	volatile GPIOx* portX = assignPort(port);
-		
-	//check to see if port is null
-	if(!portX) return;
-				
-	portX->AFRH &= ~(0b1111<<(pin*4));
-
-	switch(altFunc){
-		case 0:
-			portX->AFRH |= (0b0000<<(pin*4));
-			break;
-		case 1:
-			portX->AFRH |= (0b0001<<(pin*4));
-			break;
-		case 2:
-			portX->AFRH |= (0b0010<<(pin*4));
-			break;
-		case 3:
-			portX->AFRH |= (0b0011<<(pin*4));
-			break;
-		case 4:
-			portX->AFRH |= (0b0100<<(pin*4));
-			break;
-		case 5:
-			portX->AFRH |= (0b0101<<(pin*4));
-			break;
-		case 6:
-			portX->AFRH |= (0b0110<<(pin*4));
-			break;
-		case 7:
-			portX->AFRH |= (0b0111<<(pin*4));
-			break;
-		case 8:
-			portX->AFRH |= (0b1000<<(pin*4));
-			break;
-		case 9:
-			portX->AFRH |= (0b1001<<(pin*4));
-			break;
-		case 10:
-			portX->AFRH |= (0b1010<<(pin*4));
-			break;
-		case 11:
-			portX->AFRH |= (0b1011<<(pin*4));
-			break;
-		case 12:
-			portX->AFRH |= (0b1100<<(pin*4));
-			break;
-		case 13:
-			portX->AFRH |= (0b1101<<(pin*4));
-			break;
-		case 14:
-			portX->AFRH |= (0b1110<<(pin*4));
-			break;
-		case 15:
-			portX->AFRH |= (0b1111<<(pin*4));
-			break;
-		default:
-			return;
+	if(pin <= 15 && portX && altFunc <= 15){
+		gpio_group_alt_func(PIN(portX, pin), altFunc);
 	}
 }
 
@@ -348,17 +134,14 @@ static volatile GPIOx* assignPort(char port){
 	switch(port){
 		case 'A':
 		case 'a':
-			return GPIOA;
+			return GPIO_PORT_A;
 		case 'B':
 		case 'b':
-			return GPIOB;
+			return GPIO_PORT_B;
 		case 'C':
 		case 'c':
-			return GPIOC;
+			return GPIO_PORT_C;
 		default:
 			return NULL;		//error
 	}
 }
-
-
-
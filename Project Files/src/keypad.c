@@ -9,76 +9,97 @@
  */
 
 #include "keypad.h"
+#include "timer.h"
+#include "prof.h"
+
+#define QUEUE_MASK (KEY_QUEUE_SIZE-1)
+#define NO_KEY 0xFF
+
+//MODER image of the keypad pins with one row driven
+#define ROW_OUTPUT(row) gpio_mode_image(1<<(KEY_ROW_PIN+(row)), OUTPUT)
+
+_Static_assert((KEY_QUEUE_SIZE & QUEUE_MASK) == 0, "KEY_QUEUE_SIZE must be a power of two");
+_Static_assert(KEY_ROW_PIN == KEY_COL_PIN+KEY_COLS, "rows must follow the columns");
 
 const char keys[] = "123A456B789C*0#D";
 const int integers[] = {1,2,3,10,4,5,6,11,7,8,9,12,14,0,15,13};
 
-static void setRows_readCol();
-static void setCol_readRows();
-static uint8_t getRow(uint8_t rows);
-static uint8_t getCol(uint8_t cols);
-static void disable_keys_interrupt();
-static void enable_keys_interrupt();
+static void scan(void* arg);
+static void debounce(uint32_t scanned, uint32_t pressed, uint32_t now);
+static void queue_event(uint8_t key, KeyAction action, uint32_t time_ms);
+static uint8_t next_press(int repeats);
 
-static volatile GPIOx *GPIOC = (GPIOx *) 0x40020800;
-static volatile RingBuffer* rowBuffer;
-static volatile RingBuffer* colBuffer;
+static SoftTimer scanTimer;
+static uint8_t row;							//row driven low since the last scan
+static uint16_t stable;						//debounced state, bit n is key n+1 held
+static uint16_t settling;					//keys whose raw state differs from stable
+static uint8_t counts[KEY_COUNT];			//samples the difference has held
+static uint32_t since[KEY_COUNT];			//now_ms when the difference was first seen
+static uint8_t repeatKey = NO_KEY;
+static uint32_t repeatAt;
 
-static uint8_t col_code;
-static uint8_t row_code;
+static KeyEvent events[KEY_QUEUE_SIZE];
+static volatile uint32_t queue_put;			//written by the scan
+static volatile uint32_t queue_get;			//written by key_next
+static uint32_t dropped;
+
+static key_callback callback;
 
 /*
  * This function initializes the keyboard by enabling the clock the keyboard
  * resides on and setting all pins associated with the keyboard to pull up.
  * This will cause pins to default to logic high 1 when reading pins. The
- * pins are then set to 0 in case they were previously changed prior to use
- * by the keyboard
+ * first row is driven low and the scan is started on the timer wheel, so
+ * timer_init must have been called.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
 void key_init(){
-	//setup recieveBuffer
-	static volatile RingBuffer temp1 = {0,0};
-	static volatile RingBuffer temp2 = {0,0};
-	rowBuffer = &temp1;
-	colBuffer = &temp2;
-
 	//enable clock
-	enable_clock('C');
-	
-	//set pins to pullup
-	for(int i=0;i<=7;i++){
-		set_pin_PUPDR('C',i,PULLUP);
+	enable_clock(KEY_PORT);
+
+	//pull every pin up, an output row only ever drives low
+	gpio_group_pull(KEY_PINS, PULLUP);
+	gpio_group_clear(KEY_ROW_PINS);
+
+	row = 0;
+	gpio_group_modes(KEY_PINS, ROW_OUTPUT(0));
+
+	timer_start(&scanTimer, KEY_SCAN_MS, KEY_SCAN_MS, scan, 0);
+}
+
+/**
+ * Takes the oldest event off the queue. Never blocks.
+ * Inputs:
+ * 		*event - destination
+ * Outputs:
+ * 		1 - an event was copied
+ * 		0 - the queue is empty
+ */
+int key_next(KeyEvent* event){
+	uint32_t g = queue_get;
+	if(__atomic_load_n(&queue_put, __ATOMIC_ACQUIRE) == g){
+		return 0;
 	}
-	
-	//enable clock for SysCFG
-	*(RCC_APB2ENR) |= 1<<14;
-	
-	//connect PC0-3 to EXTI0-3, PC4-7 to EXTI4-7
-	*(SYSCFG_EXTICR1) = (uint16_t)(0x2222);
-	
-	//unmask EXTI0-7 in EXTI
-	*(EXTI_IMR) |= 0x0F;
-	
-	//set falling edge
-	*(EXTI_FTSR) |= 0x0F;
-	
-	//enable Interrupt in NVIC
-	//IRQ0-3 is 6th-9th bit in first ISR Reg.
-	*(NVIC_ISER0) |= 0b1111<<6;
-	
-	//write 0's to key pins(4-7)
-	GPIOC->ODR &= ~(0xFF);
-	
-	setRows_readCol();
+	*event = events[g & QUEUE_MASK];
+	__atomic_store_n(&queue_get, g+1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/**
+ * Returns the number of events lost because the queue was full
+ */
+uint32_t key_dropped(){
+	return dropped;
 }
 
 /*
- * This function will retrieve the key being pressed when the function is called.
- * This function will not block if no key is pressed, returning a 0 if no key is
- * pressed.
+ * This function will retrieve the next key press from the event queue.
+ * Releases and the repeats of a held key are skipped, so a key held while
+ * typing a password or a date is only entered once. This function will not
+ * block, returning a 0 if no key is pressed.
  * Inputs:
  * 		none
  * Outputs:
@@ -86,34 +107,40 @@ void key_init(){
  * 			right, top to bottom.
  */
 uint8_t key_getkey_noblock(){
-	if(hasElement(rowBuffer) && hasElement(colBuffer)){
-		uint8_t row = getRow(get(rowBuffer));						//get the int representation of the row
-		uint8_t col = getCol(get(colBuffer));						//get the int representation of the col
-		return ((row-1)*4)+col;	
-	}else{
-		return 0;
-	}
+	return next_press(0);
+}
+
+/*
+ * This function will retrieve the next key press, or repeat of a held key,
+ * from the event queue, for callers that want auto-repeat such as scrolling.
+ * Releases are skipped. This function will not block, returning a 0 if no
+ * key is pressed.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		number 0-16 corresponding to key pressed, as key_getkey_noblock
+ */
+uint8_t key_getkey_repeat_noblock(){
+	return next_press(1);
 }
 
 /*
  * This function returns a number corresponding to the key that was pressed on the
  * keypad. If no key is pressed, the function will block until a keypress is detected.
- * Then, the function will block until the key is released.
  * Inputs:
  * 		none
  * Outputs:
  * 		number 1-16 corresponding to key pressed. See previous funtion for description.
  */
-uint8_t key_getkey(){	
-	uint8_t row = getRow(get(rowBuffer));						//get the int representation of the row
-	uint8_t col = getCol(get(colBuffer));						//get the int representation of the col
-	
-	return ((row-1)*4)+col;							//return the number associated with key(1-16)	
+uint8_t key_getkey(){
+	uint8_t key;
+	while((key = key_getkey_noblock()) == 0){}
+	return key;
 }
 
 /*
  * This function returns the ascii character corresponding to the key pressed. This function will
- * block until a key is pressed and released. The ascii character is determined by indexing the
+ * block until a key is pressed. The ascii character is determined by indexing the
  * character array, keyPressed.
  * Inputs:
  * 		none
@@ -127,7 +154,7 @@ char key_getchar(){
 
 /*
  * This function returns the ascii character corresponding to the key pressed. This function wont
- * block until a key is pressed and released. The ascii character is determined by indexing the
+ * block until a key is pressed. The ascii character is determined by indexing the
  * character array, keyPressed. If no key is pressed, 0 is returned
  * Inputs:
  * 		none
@@ -142,6 +169,23 @@ char key_getchar_noblock(){
 	return 0;
 }
 
+/*
+ * This function returns the ascii character of the next key press or repeat
+ * of a held key, as key_getkey_repeat_noblock. If no key is pressed, 0 is
+ * returned.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		ascii character corresponding to key pressed.
+ */
+char key_getchar_repeat_noblock(){
+	uint8_t keyPressed = key_getkey_repeat_noblock();
+	if(keyPressed!=0){
+		return keys[keyPressed-1];
+	}
+	return 0;
+}
+
 /*
  * This function returns the interger number associated with the key. This is different from
  * the regular getKey as pressing 9 will return the value 9 in this function. This function
@@ -156,202 +200,110 @@ uint8_t key_getint(){
 	return integers[keyPressed-1];
 }
 
-
-static void setRows_readCol(){
-	//set the rows to output mode
-	for(int i=4;i<=7;i++){
-		set_pin_mode('C',i,OUTPUT);
-	}
-	
-	//set columns to input
-	for(int i=0;i<=3;i++){
-		set_pin_mode('C',i,INPUT);
-	}
+/*
+ * This function registers a function to be called from interrupt context
+ * every time a key event is queued. NULL removes the callback.
+ * Inputs:
+ * 		cb - function to call
+ * Outputs:
+ * 		none
+ */
+void key_set_callback(key_callback cb){
+	callback = cb;
 }
 
-static void setCol_readRows(){
-	//set the rows to input mode
-	for(int i=4;i<=7;i++){
-		set_pin_mode('C',i,INPUT);
-	}
-	
-	//set columns to output
-	for(int i=0;i<=3;i++){
-		set_pin_mode('C',i,OUTPUT);
-	}
-}
+/*
+ * Timer wheel callback, runs in the SysTick interrupt. Samples the row
+ * driven since the last tick, then moves the drive to the next row.
+ * With no key changing this is an IDR read, a MODER write and a compare.
+ */
+static void scan(void* arg){
+	PROF_SCOPE(PROBE_KEY_SCAN);
+	uint32_t now = now_ms();
 
-static void disable_keys_interrupt(){
-	//*(NVIC_ICER0) |= 0b1111<<6;
-	*(EXTI_IMR) &= ~(0x0F);
-}
+	//a pressed key pulls its column low
+	uint32_t pressed = (gpio_group_read(KEY_COL_PINS) ^ KEY_COL_PINS.mask) >> KEY_COL_PIN;
+	uint32_t sampled = row;
+	row = (row+1) & (KEY_ROWS-1);
+	gpio_group_modes(KEY_PINS, ROW_OUTPUT(row));
 
-static void enable_keys_interrupt(){
-	//*(NVIC_ISER0) |= 0b1111<<6;
-	*(EXTI_IMR) |= 0x0F;
-}
+	debounce(sampled, pressed, now);
 
-static uint8_t getRow(uint8_t rows){
-	uint8_t row = -1;
-	
-	//return row number corresponding to the row encoding
-	switch(rows){
-		case 0b1111:
-			row=0;
-			break;
-		case 0b1110:
-			row=1;
-			break;
-		case 0b1101:
-			row=2;
-			break;
-		case 0b1011:
-			row=3;
-			break;
-		case 0b0111:
-			row=4;
-			break;
-		default:
-			row=0;
-			break;			
+	if(repeatKey != NO_KEY && (int32_t)(now - repeatAt) >= 0){
+		repeatAt += KEY_REPEAT_MS;
+		queue_event(repeatKey+1, KEY_REPEAT, now);
 	}
-	
-	return row;
 }
 
-static uint8_t getCol(uint8_t cols){
-	int col = -1;
-	
-	//return column corresponding to column encoding
-	switch(cols){
-		case 0b1111:
-			col=0;
-			break;
-		case 0b1110:
-			col=1;
-			break;
-		case 0b1101:
-			col=2;
-			break;
-		case 0b1011:
-			col=3;
-			break;
-		case 0b0111:
-			col=4;
-			break;
-		default:
-			col=0;
-			break;			
+/*
+ * Debounces the keys of one row. A key changes state once its new level
+ * has been seen KEY_DEBOUNCE_SAMPLES times in a row. The event is
+ * stamped with the first of those samples.
+ */
+static void debounce(uint32_t scanned, uint32_t pressed, uint32_t now){
+	uint32_t shift = scanned*KEY_COLS;
+	uint32_t diff = ((pressed << shift) ^ stable) & (0xF << shift);
+	if((diff | (settling & (0xF << shift))) == 0){
+		return;
 	}
-	
-	return col;
-}
 
-//ISR functions to handle a key being pressed
-
-void EXTI0_IRQHandler(void){
-	//clear interrupt
-	*(EXTI_PR) |= 0b1;
-	if(hasSpace(colBuffer) && hasSpace(rowBuffer)){
-		disable_keys_interrupt();
-	
-		//save column encoding
-		for(int i=0;i<=3;i++){
-			set_pin_mode('C',i,INPUT);
+	for(uint32_t k=shift;k<shift+KEY_COLS;k++){
+		uint16_t bit = 1<<k;
+		if((diff & bit) == 0){
+			settling &= ~bit;			//bounced back before it settled
+			continue;
+		}
+		if((settling & bit) == 0){
+			settling |= bit;
+			counts[k] = 0;
+			since[k] = now;
+		}
+		if(++counts[k] < KEY_DEBOUNCE_SAMPLES){
+			continue;
 		}
-		
-		put(colBuffer,GPIOC->IDR & 0x0F);
-		
-		//read rows, set columns
-		setCol_readRows();
-		
-		put(rowBuffer,(GPIOC->IDR & 0xF0)>>4);
-		
-		//set rows to output, read columns
-		setRows_readCol();
-
-		enable_keys_interrupt();
-	}	
-}
 
-void EXTI1_IRQHandler(void){
-	//clear interrupt
-	*(EXTI_PR) |= 0b1<<1;
-	if(hasSpace(colBuffer) && hasSpace(rowBuffer)){
-		disable_keys_interrupt();
-	
-		//save column encoding
-		for(int i=0;i<=3;i++){
-			set_pin_mode('C',i,INPUT);
+		settling &= ~bit;
+		stable ^= bit;
+		if(stable & bit){
+			repeatKey = k;
+			repeatAt = since[k] + KEY_REPEAT_DELAY_MS;
+			queue_event(k+1, KEY_DOWN, since[k]);
+		}else{
+			if(repeatKey == k){
+				repeatKey = NO_KEY;
+			}
+			queue_event(k+1, KEY_UP, since[k]);
 		}
-		
-		put(colBuffer,GPIOC->IDR & 0x0F);
-		
-		//read rows, set columns
-		setCol_readRows();
-		
-		put(rowBuffer,(GPIOC->IDR & 0xF0)>>4);
-		
-		//set rows to output, read columns
-		setRows_readCol();
-
-		enable_keys_interrupt();
-	}	
+	}
 }
 
-void EXTI2_IRQHandler(void){
-	//clear interrupt
-	*(EXTI_PR) |= 0b1<<2;
-	if(hasSpace(colBuffer) && hasSpace(rowBuffer)){
-		disable_keys_interrupt();
-	
-		//save column encoding
-		for(int i=0;i<=3;i++){
-			set_pin_mode('C',i,INPUT);
-		}
-		
-		put(colBuffer,GPIOC->IDR & 0x0F);
-		
-		//read rows, set columns
-		setCol_readRows();
-		
-		put(rowBuffer,(GPIOC->IDR & 0xF0)>>4);
-		
-		//set rows to output, read columns
-		setRows_readCol();
-
-		enable_keys_interrupt();
-	}	
+static void queue_event(uint8_t key, KeyAction action, uint32_t time_ms){
+	uint32_t p = queue_put;
+	if(p - __atomic_load_n(&queue_get, __ATOMIC_ACQUIRE) >= KEY_QUEUE_SIZE){
+		dropped++;
+		return;
+	}
+	KeyEvent* e = &events[p & QUEUE_MASK];
+	e->time_ms = time_ms;
+	e->key = key;
+	e->action = action;
+	__atomic_store_n(&queue_put, p+1, __ATOMIC_RELEASE);
+
+	if(callback){
+		callback();
+	}
 }
 
-void EXTI3_IRQHandler(void){
-	//clear interrupt
-	*(EXTI_PR) |= 0b1<<3;
-	if(hasSpace(colBuffer) && hasSpace(rowBuffer)){
-		disable_keys_interrupt();
-	
-		//save column encoding
-		for(int i=0;i<=3;i++){
-			set_pin_mode('C',i,INPUT);
+/*
+ * Takes events off the queue until a press, or a repeat if repeats is set.
+ * Returns the key, or 0 once the queue is empty.
+ */
+static uint8_t next_press(int repeats){
+	KeyEvent event;
+	while(key_next(&event)){
+		if(event.action == KEY_DOWN || (repeats && event.action == KEY_REPEAT)){
+			return event.key;
 		}
-		
-		put(colBuffer,GPIOC->IDR & 0x0F);
-		
-		//read rows, set columns
-		setCol_readRows();
-		
-		put(rowBuffer,(GPIOC->IDR & 0xF0)>>4);
-		
-		//set rows to output, read columns
-		setRows_readCol();
-
-		enable_keys_interrupt();
-	}	
+	}
+	return 0;
 }
-
-
-
-
-
-
-
@@ -5,79 +5,116 @@
  *      Author: larsonma
  *
  * This file implements an API for the LCD to allow for easy use of the LCD.
+ *
+ * Text is written into a 2x16 shadow framebuffer and never touches the
+ * bus directly. A refresh engine running from a 1 ms software timer
+ * sends one bus operation per tick: either the next changed cell or a
+ * cursor move. Cells already shown on the display are skipped, and a
+ * cursor move is only sent when the next changed cell is not where the
+ * display's auto-increment already points.
  */
 
 #include "lcd.h"
+#include "prof.h"
+
+#define LCD_CELLS (LCD_ROWS*LCD_COLS)
+#define CURSOR_UNKNOWN 0xFF
+#define LCD_FUNCTION_SET_US 85		//function set runs in 37 us, with margin
 
 void static set_upper_nibble(uint8_t command);
 void static set_lower_nibble(uint8_t command);
 void static latch();
 void static lcd_execute(uint8_t command);
+void static lcd_function_set(uint8_t command);
 void static poll_busy();
+void static data_pins_output();
+void static bus_write(uint8_t value, uint8_t rs);
+void static refresh(void* arg);
+static uint8_t cell_addr(uint8_t cell);
+
+_Static_assert(LCD_CELLS <= 32, "dirty mask holds one bit per cell");
+
+static char frame[LCD_CELLS];			//what callers want shown
+static char shown[LCD_CELLS];			//what the display holds
+static volatile uint32_t dirty;			//cells where frame may differ from shown
+static uint8_t cursor;					//software cursor, cell index
+static uint8_t hw_addr = CURSOR_UNKNOWN;	//DDRAM address of the display's cursor
+static Cursor_Mode cursor_mode;
+static SoftTimer refresh_timer;
 
 
 
 /*
  * Initializes the LCD to 4 line mode so that its following
  * methods can be run to create ease of use of interfacing with
- * outside viewers
+ * outside viewers. Once the controller is set up, the refresh
+ * engine is started, so timer_init must already have been called.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
 void lcd_init(Cursor_Mode mode){
-	
+
 	//wait 40ms for the LCD display to power on
 	delay_ms(40);
-	
+
 	//enable gpio b and gpio c ports
 	enable_clock('B');
 	enable_clock('C');
-	
+
 	//set port B pins 0-2 to output mode
-	for(int i=0;i<=2;i++){
-		set_pin_mode('B',i,OUTPUT);
-	}
-	
+	gpio_group_mode(LCD_CTRL_PINS, OUTPUT);
+
 	//set port C pins 8-11 to output mode
-	for(int i =8;i<=11;i++){
-		set_pin_mode('C',i,OUTPUT);
-	}
-	
-	lcd_cmd(0x30);	//set to 8 pin mode by sending command 0x30
-	lcd_cmd(0x28);	//set to 4 pin mode by sending command 0x28
-	lcd_clear();	//clear by sending command 0x01
-	lcd_home();		//move home by sending command 0x02
+	data_pins_output();
+
+	cursor_mode = mode;
+	lcd_function_set(0x30);	//set to 8 pin mode by sending command 0x30
+	lcd_function_set(0x28);	//set to 4 pin mode by sending command 0x28
+	lcd_cmd(0x01);	//clear by sending command 0x01
+	lcd_cmd(0x02);	//move home by sending command 0x02
 	lcd_cmd(0x06);	//set entry mode, move right, no shift, command 0x06
 	if(mode==C_ON){
 		lcd_cmd(0x0D);	//display on, no cursor, blinking, 0x0D
 	}else{
 		lcd_cmd(0x0C);
 	}
+
+	//the display is blank with the cursor home
+	for(int i=0;i<LCD_CELLS;i++){
+		frame[i] = ' ';
+		shown[i] = ' ';
+	}
+	dirty = 0;
+	cursor = 0;
+	hw_addr = 0;
+
+	timer_start(&refresh_timer, LCD_REFRESH_MS, LCD_REFRESH_MS, refresh, 0);
 }
 
 /*
- * This function allows a user to clear the lcd by sending the clear command to
- * the LCD controller
+ * This function allows a user to clear the lcd. Only the framebuffer
+ * is cleared, the refresh engine blanks the cells that were showing text.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
 void lcd_clear(){
-	lcd_cmd(0x01);
+	for(int i=0;i<LCD_CELLS;i++){
+		lcd_fb_put(i/LCD_COLS, i%LCD_COLS, ' ');
+	}
 }
 
 /*This function allows a user to return the cursor on the LCD to the home position(row 0, col 0)
- *by sending the home command to the LCD controller.
  *Inputs:
  *		none
  *Outputs:
  *		none
  */
 void lcd_home(){
-	lcd_cmd(0x02);
+	cursor = 0;
 }
 
 /**
@@ -124,23 +161,15 @@ void lcd_row1(){
  * 		none
  */
 void lcd_set_position(uint8_t row,uint8_t col){
-	if(row >= 0 && col >= 0){
-		lcd_home();			//send the LCD home
-
-		//determine amount of times for lcd to shift by multiplying by the
-		//amount of characters per line(40) and adding the columns to the result
-		uint32_t shftAmt = (row*40) + col;
-
-		//shift the cursor shftAmt times using the lcd command for shifting
-		for(int i=0;i<shftAmt;i++){
-			lcd_cmd(0b10100);
-		}
+	if(row < LCD_ROWS && col < LCD_COLS){
+		cursor = (row*LCD_COLS) + col;
 	}
 }
 
 /*
  * This function accepts a pointer to a String(character array) and prints the String to
- * the lcd. Once the String is printed, the length of the string is returned.
+ * the lcd. Once the String is printed, the length of the string is returned. Characters
+ * past the end of the row are dropped.
  * Inputs:
  * 		*pointer - pointer to the character array to be printed
  * Outputs:
@@ -151,7 +180,6 @@ int lcd_print_string(const char *pointer){
 	for(;*pointer!='\0';pointer++){
 		lcd_data(*pointer);
 		length++;
-		//delay_us(100);
 	}
 	return length;
 }
@@ -171,7 +199,7 @@ int lcd_print_num(int num){
 		lcd_data(0+48);
 		return 1;
 	}
-	
+
 	char asciiNum[MAX_INT+1];				//create array to store BCD representation
 	int count=0;							//initialize count to 0
 	while(num!=0){							//if number doesn't equal 0, execute algorithm
@@ -180,55 +208,182 @@ int lcd_print_num(int num){
 		asciiNum[count] = (result+48);		//convert to ascii to print number
 		count++;
 	}
-		
+
 	int length=0;
 	for(--count;count>=0;count--){			//pop ascii characters off array
 		lcd_data(asciiNum[count]);			//print ascii representation of number
 		length++;
 	}
-	
+
 	return length;
 }
 
 /*
  * This function allows a user to execute a command for the lcd to execute. It is the
- * responsibility of the user to verify that the command is valid.
+ * responsibility of the user to verify that the command is valid. The command is sent
+ * immediately and blocks until the controller is ready. Afterwards every cell is
+ * resent, since the command may have changed what the display shows.
  * Inputs:
  * 		uint8_t command - command to send to lcd controller
  * Outputs:
  * 		none
  */
 void lcd_cmd(uint8_t command){
+	timer_stop(&refresh_timer);
+
 	//make sure rw and rs are low
-	GPIOB->ODR &= ~(0b11);	//clear the rw and rs bits
-	
+	gpio_group_clear(LCD_RS_RW_PINS);	//clear the rw and rs bits
+
 	//send the command
 	lcd_execute(command);
+	data_pins_output();
+
+	if(hw_addr != CURSOR_UNKNOWN){
+		hw_addr = CURSOR_UNKNOWN;
+		for(int i=0;i<LCD_CELLS;i++){
+			shown[i] = 0;
+		}
+		__atomic_store_n(&dirty, 0xFFFFFFFF, __ATOMIC_RELAXED);
+		timer_start(&refresh_timer, LCD_REFRESH_MS, LCD_REFRESH_MS, refresh, 0);
+	}
 }
 
 /*
- * This function allows a user to print raw data to the lcd. It is the
- * responsibility of the user to verify that the data is valid.
+ * This function writes a character at the cursor and advances the cursor. Writes past
+ * the end of a row are dropped.
  * Inputs:
- * 		uint8_t data - data to send to lcd controller
+ * 		uint8_t data - character to print
  * Outputs:
  * 		none
  */
 void lcd_data(uint8_t data){
-	//make sure rw is low and rs is high
-	GPIOB->ODR &= ~(0b11);			//clear the rw and rs bits
-	GPIOB->ODR |= (1<<LCD_RS_F);	//set rs high
-	
-	//send data
-	lcd_execute(data);
+	if(cursor >= LCD_CELLS) return;
+
+	lcd_fb_put(cursor/LCD_COLS, cursor%LCD_COLS, data);
+
+	//park past the end of the row so further writes are dropped
+	cursor = ((cursor%LCD_COLS) == LCD_COLS-1) ? LCD_CELLS : cursor+1;
+}
+
+/*
+ * Writes a character into the framebuffer. Never blocks.
+ * Inputs:
+ * 		row, col - cell to write (0 based)
+ * 		c - character to show
+ * Outputs:
+ * 		none
+ */
+void lcd_fb_put(uint8_t row, uint8_t col, char c){
+	if(row >= LCD_ROWS || col >= LCD_COLS) return;
+
+	uint8_t cell = (row*LCD_COLS) + col;
+	if(frame[cell] != c){
+		frame[cell] = c;
+		__atomic_fetch_or(&dirty, 1u<<cell, __ATOMIC_RELEASE);
+	}
+}
+
+/*
+ * Writes a string into the framebuffer starting at row, col. Never blocks.
+ * Inputs:
+ * 		row, col - first cell to write (0 based)
+ * 		*pointer - string to print
+ * Outputs:
+ * 		number of characters that fit on the row
+ */
+int lcd_fb_print(uint8_t row, uint8_t col, const char *pointer){
+	int length = 0;
+	for(;*pointer!='\0' && col<LCD_COLS;pointer++){
+		lcd_fb_put(row, col++, *pointer);
+		length++;
+	}
+	return length;
+}
+
+/*
+ * Performs one bus operation of the refresh engine. Called from the refresh timer,
+ * at most once per millisecond, so the controller is always idle and no busy flag
+ * polling is needed.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+void lcd_pump(){
+	PROF_SCOPE(PROBE_LCD_PUMP);
+	uint32_t pending = __atomic_load_n(&dirty, __ATOMIC_ACQUIRE);
+
+	//drop cells that changed and changed back before they were sent
+	while(pending){
+		uint8_t cell = __builtin_ctz(pending);
+		if(frame[cell] != shown[cell]) break;
+		__atomic_fetch_and(&dirty, ~(1u<<cell), __ATOMIC_RELAXED);
+		pending &= ~(1u<<cell);
+	}
+
+	if(!pending){
+		//park the blinking cursor where the caller left it
+		if(cursor_mode==C_ON && cursor<LCD_CELLS && hw_addr!=cell_addr(cursor)){
+			hw_addr = cell_addr(cursor);
+			bus_write(0x80 | hw_addr, 0);
+		}
+		return;
+	}
+
+	//prefer the cell the display's cursor already points at
+	uint8_t cell = __builtin_ctz(pending);
+	for(uint8_t i=cell;i<LCD_CELLS;i++){
+		if((pending & (1u<<i)) && cell_addr(i)==hw_addr){
+			cell = i;
+			break;
+		}
+	}
+
+	if(cell_addr(cell) != hw_addr){
+		hw_addr = cell_addr(cell);
+		bus_write(0x80 | hw_addr, 0);		//set DDRAM address
+		return;
+	}
+
+	__atomic_fetch_and(&dirty, ~(1u<<cell), __ATOMIC_ACQUIRE);
+	char c = frame[cell];
+	bus_write(c, 1);
+	shown[cell] = c;
+	hw_addr++;
+}
+
+void static refresh(void* arg){
+	lcd_pump();
+}
+
+static uint8_t cell_addr(uint8_t cell){
+	return (cell < LCD_COLS) ? cell : (LCD_ROW1_ADDR + cell - LCD_COLS);
+}
+
+void static data_pins_output(){
+	//PC8-11 to output mode in one write
+	gpio_group_mode(LCD_DATA_PINS, OUTPUT);
+}
+
+/*
+ * Sends one byte without waiting on the busy flag. The data pins must be outputs.
+ */
+void static bus_write(uint8_t value, uint8_t rs){
+	//rw low, rs as requested
+	gpio_group_write(LCD_RS_RW_PINS, rs ? (1<<LCD_RS_F) : 0);
+
+	gpio_group_write(LCD_DATA_PINS, (value>>4)<<LCD_DATA_OFFSET);
+	latch();
+	gpio_group_write(LCD_DATA_PINS, (value&0x0F)<<LCD_DATA_OFFSET);
+	latch();
 }
 
 void static lcd_execute(uint8_t command){
+	PROF_SCOPE(PROBE_LCD_EXECUTE);
+
 	//ensure data pins are set to output mode
-	for(int i =8;i<=11;i++){
-		set_pin_mode('C',i,OUTPUT);
-	}
-	
+	data_pins_output();
+
 	set_upper_nibble(command);
 	latch();
 	set_lower_nibble(command);
@@ -236,50 +391,58 @@ void static lcd_execute(uint8_t command){
 	poll_busy();
 }
 
+/*
+ * Sends a function set while the interface width is still changing. The
+ * busy flag cannot be read until the function set has completed, so this
+ * waits a fixed time instead of polling it.
+ */
+void static lcd_function_set(uint8_t command){
+	gpio_group_clear(LCD_RS_RW_PINS);
+	data_pins_output();
+
+	set_upper_nibble(command);
+	latch();
+	set_lower_nibble(command);
+	latch();
+	delay_us(LCD_FUNCTION_SET_US);
+}
+
 static void set_upper_nibble(uint8_t command){
-	GPIOC->ODR &= ~(0b1111 << LCD_DATA_OFFSET);	//clear the PortC 8-11 bits
-	
-	//logical shift the most significant nibble right by 4 to elimintate the 
-	//least significant nibble. Then shift it into the data transfer bits.
-	GPIOC->ODR |= ((command >> 4) << LCD_DATA_OFFSET);
+	//clear the PortC 8-11 bits and set the most significant nibble in one write
+	gpio_group_write(LCD_DATA_PINS, (command >> 4) << LCD_DATA_OFFSET);
 }
 
 static void set_lower_nibble(uint8_t command){
-	GPIOC->ODR &= ~(0b1111 << LCD_DATA_OFFSET);	//clear the PortC 8-11 bits
-	command &= ~(0b1111<<4);						//clear the upper nibble
-	GPIOC->ODR |= (command << LCD_DATA_OFFSET); 	//shift lower nibble to data transfer bits.
+	gpio_group_write(LCD_DATA_PINS, (command & 0x0F) << LCD_DATA_OFFSET);
 }
 
 static void latch(){
-	GPIOB->ODR |= (1<<LCD_E_F);	//bring E high(pin 2)
-	delay_us(1);					//delay 1 microsecond to latch
-	GPIOB->ODR &= ~(1<<LCD_E_F);	//bring E low
-	delay_us(1);					//let E settle
+	gpio_group_set(LCD_E_PIN);			//bring E high(pin 2)
+	delay_us(1);						//delay 1 microsecond to latch
+	gpio_group_clear(LCD_E_PIN);		//bring E low
+	delay_us(1);						//let E settle
 }
 
 static void poll_busy(){
 	//set RS low and R/W high
-	GPIOB->ODR &= ~(0b11);
-	GPIOB->ODR |= (1<<LCD_RW_F);
-	
+	gpio_group_write(LCD_RS_RW_PINS, 1<<LCD_RW_F);
+
 	//set pin 11 on port C to input mode
-	set_pin_mode('C',11,INPUT);
-	
-	//delay 80 us
-	delay_us(85);
-	
+	gpio_group_mode(LCD_BUSY_PIN, INPUT);
+
 	//loop until busy flag is 0
 	uint8_t bf = 1;
 	while(bf!=0){
-		GPIOB->ODR |= (1<<LCD_E_F);	//bring E high(pin 2)
+		gpio_group_set(LCD_E_PIN);		//bring E high(pin 2)
 		delay_us(1);					//delay 1 microsecond to latch
-		if((GPIOC->IDR &= (1<<11))!=(1<<11)){//check bf
+		if(gpio_group_read(LCD_BUSY_PIN) == 0){//check bf
 			bf = 0;
 		}
-		GPIOB->ODR &= ~(1<<LCD_E_F);	//bring E low
+		gpio_group_clear(LCD_E_PIN);	//bring E low
 		delay_us(1);					//let E settle
 		latch();		//latch
 	}
-}
-
 
+	//leave R/W low so the data pins can drive the bus again
+	gpio_group_clear(LCD_RW_PIN);
+}
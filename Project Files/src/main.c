@@ -17,111 +17,183 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ADC.h"
+#include "fixed.h"
+#include "nic.h"
+#include "frame.h"
+#include "pbuf.h"
+#include "event.h"
+#include "tripwire.h"
+#include "traffic.h"
+#include "flashlog.h"
+#include "uart_driver.h"
+#include <stdio.h>
 #include <stdbool.h>
-#include <math.h>
 
 #define NAME_LENGTH 16
 #define USERNAME_LENGTH 5
 #define PASSWORD_LENGTH 6
+#define DIGITS_LENGTH 6			//MMDDYY or HHMMSS
 #define TOINT 48
-
-typedef enum {INITIALIZE,SCAN,ALARM,ACCESS} TASKMODE;
+#define LANES (sizeof(laneChannels)/sizeof(laneChannels[0]))
+#define SERIAL_BAUD 115200
+#define TRAFFIC_RAM ((LANES+1)*TRAFFIC_BYTES)
+#define TRAFFIC_RAM_BUDGET 4096
+#define LOG_COUNT 1				//flash log record: minute, breaks, tag is the lane
+#define CHECKPOINT_WORDS (TRAFFIC_SNAPSHOT_WORDS+LANES)
+
+typedef enum {MENU,SCAN,ALARM,ACCESS,LOGIN} TASKMODE;
 typedef enum {INCORRECT, CORRECT} Result;
 
+//steps of the login and clock entry, one key at a time
+typedef enum {ENTER_USERNAME, ENTER_PASSWORD, ENTER_DATE, ENTER_TIME, ENTER_AM_PM} EntryStep;
+
 typedef struct{
 	char name[NAME_LENGTH+1];
 	char username[USERNAME_LENGTH+1];
 	char password[PASSWORD_LENGTH+1];
 } ADMIN;
 
-static uint32_t doorCount = 0;
 static ADMIN mitchell = {"Mitchell","62653","123ABC"};
-static bool blocked = false;
-static uint32_t hourCount[24] = {0};
+static const uint8_t laneChannels[] = {ADC_DEFAULT_CHANNEL};	//ADC channel of each doorway
+static TripDetector beams[LANES];
+static TrafficStats laneTraffic[LANES];
+static TrafficStats traffic;			//all lanes
+static uint32_t clockMinute;			//get_rtc_minutes when the clock was read
+static uint32_t unloggedSeen[LANES];	//TripDetector.unlogged already counted
+static uint32_t pendingBreaks[LANES];	//counted but not yet in the flash log
+static uint32_t pendingMinute;
+static uint32_t unclockedBreaks[LANES];	//counted before the clock was set
+static bool clockReady = false;
+static EntryStep entryStep;
+static char entry[NAME_LENGTH+1];		//keys of the current entry step
+static uint8_t entryIndex;
+static bool entryFailed;				//"Incorrect." shown until the next key
+static char dateDigits[DIGITS_LENGTH];
+static char timeDigits[DIGITS_LENGTH];
 static char currentPassword[PASSWORD_LENGTH+1];
 static uint8_t passwordIndex = 0;
 static bool alarmed = false;
+static TASKMODE mode = MENU;
+static uint8_t menuPage = 0;
+static uint32_t prevCount = -1;
+static uint32_t prevHr = -1;
+static const Note alarm[] = {
+	{C,NATURAL,8,250},
+	{C,NATURAL,6,250},
+	{REST,NATURAL,4,480},		//pads the pair out to one second
+};
+static const Note note = {C,NATURAL,4,250};
+
+_Static_assert(TRAFFIC_RAM <= TRAFFIC_RAM_BUDGET, "traffic statistics exceed their RAM budget");
+_Static_assert(CHECKPOINT_WORDS <= FLASHLOG_MAX_CHECKPOINT, "traffic checkpoint does not fit the flash log");
 
 static void promt_for_time();
 static void promt_for_date();
-static char* get_date();
-static char* get_time();
-static RTC_Time* conv_time(char*);
-static RTC_Date* conv_date(char*);
+static void conv_time(const char* digits, uint8_t pm, RTC_Time* time);
+static void conv_date(const char* digits, RTC_Date* date);
 static void bootUp();
-static Result login();
-static TASKMODE getCommand();
-static void initClock();
+static void begin_login(bool failed);
+static void begin_entry(EntryStep step);
+static void entry_key(char keyPressed);
+static void enter_menu();
+static void enter_mode(TASKMODE newMode);
+static void start_clock();
 static void print_time();
-static Result checkPassword();
+static Result checkPassword(char keyPressed);
 static void print_scan_status();
+static void on_key(const Event* event);
+static void on_tripwire(const Event* event);
+static void on_second(const Event* event);
+static void on_frame(const Event* event);
+static void on_serial(const Event* event);
+static void print_traffic();
+static void print_buffers();
+static void print_events();
+static void count_break(uint8_t lane, uint32_t minute);
+static void restore_traffic();
+static void replay_record(uint8_t type, uint8_t tag, const uint32_t* data);
+static void record_break(uint8_t lane, uint32_t minute);
+static void flush_traffic();
+static void save_traffic();
+static void post_key();
+static void post_frame();
+static void post_second();
+static void post_serial();
+static void on_adc_block(const uint16_t* block, uint32_t frames, uint32_t lanes);
 
 /**
- * The main function for this application runs a state machine, while
- * periodically checking for a user entering the admin password. In
- * order to perform tasks, many of the tasks are accomplished by
- * calling static functions within this file
+ * The main function for this application starts the tripwire and hands
+ * control to the event loop. Key presses, tripwire breaks, received
+ * frames and the RTC's one second wakeup are posted as events from
+ * their interrupts, and the handlers below act on them according to
+ * the current mode. The core sleeps between events. Logging in and
+ * setting the clock are driven by key events too, so counting and the
+ * network keep running while the admin types.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
 int main(void){
-	TASKMODE mode = INITIALIZE;
-	Note alarm1 = {C,NATURAL,8,250};
-	Note alarm2 = {C,NATURAL,6,250};
-	Note note = {C,NATURAL,4,250};
-	uint32_t current_count = 0;
-	while(1){
-		switch(mode){
-			case INITIALIZE:
-				bootUp();
-				while(login() == INCORRECT){
-					lcd_reset();
-					lcd_print_string("Incorrect.");
-					delay_ms(500);
-				};
-				initClock();
-				mode = getCommand();
-				ADC_init();
-				break;
-			case SCAN:
-				if((current_count+1) == doorCount){	//check if tripwire has been broken
-					current_count++;
-					hourCount[get_Hour()] = hourCount[get_Hour()] +1;
-					play_note(&note);
-				}
-				print_time();
-				break;
-			case ALARM:
-				if((current_count+1) == doorCount){
-					alarmed = true;
-				}
+	bootUp();
 
-				if(alarmed){
-					play_note(&alarm1);
-					play_note(&alarm2);
-				}
+	TripConfig trip = {TRIP_DEFAULT_LOW, TRIP_DEFAULT_HIGH, TRIP_DEFAULT_DWELL};
+	for(uint32_t i=0;i<LANES;i++){
+		tripwire_init(&beams[i], i, &trip);
+	}
+	ADC_set_lanes(laneChannels, LANES);
+	ADC_set_block_callback(on_adc_block);
+	ADC_init();
+
+	event_subscribe(EV_KEY, on_key);
+	event_subscribe(EV_TRIPWIRE, on_tripwire);
+	event_subscribe(EV_SECOND, on_second);
+	event_subscribe(EV_FRAME, on_frame);
+	event_subscribe(EV_SERIAL, on_serial);
+	key_set_callback(post_key);
+	nic_set_rx_callback(post_frame);
+	usart2_set_rx_callback(post_serial);
+	rtc_set_second_callback(post_second);
+
+	//the clock is only asked for if the RTC lost power
+	if(rtc_is_set()){
+		start_clock();
+	}
+	begin_login(false);
+	event_loop();
 
-				break;
-			case ACCESS:
-				if((current_count+1) == doorCount){
-					current_count++;
-					hourCount[get_Hour()] = hourCount[get_Hour()] +1;
-					play_note(&note);
-				}
-				print_scan_status();
-				break;
+	return 0;
+}
+
+/**
+ * Handles a key press. In the menu the key picks the mode, otherwise
+ * it is part of the admin password that brings the menu back and
+ * silences the alarm.
+ * Inputs:
+ * 		*event - EV_KEY
+ * Outputs:
+ * 		none
+ */
+static void on_key(const Event* event){
+	char keyPressed;
+	while((keyPressed = key_getchar_noblock()) != 0){
+		if(mode == LOGIN){
+			entry_key(keyPressed);
+			continue;
+		}
+		if(mode == MENU){
+			if(keyPressed >= '1' && keyPressed <= '3'){
+				enter_mode(keyPressed - '0');
+			}
+			continue;
 		}
 
-		//check to see if the user has attempted to enter a password to
-		//switch modes of the lcd/disable the alarm. Keypad is buffered
-		//so there is no risk of losing data
-		Result result = checkPassword();
+		Result result = checkPassword(keyPressed);
 		if(result==CORRECT){
-			mode = getCommand();
 			passwordIndex = 0;
 			alarmed = false;
+			piezo_stop();
+			enter_menu();
 		}else if(result==INCORRECT){
 			passwordIndex = 0;
 			lcd_row1();
@@ -129,166 +201,438 @@ int main(void){
 			lcd_row1();
 		}
 	}
+}
 
-	return 0;
+/**
+ * Drains the tripwire log. Every break is counted in the traffic
+ * statistics of its lane and of the whole store at the minute of its
+ * RTC stamp, never later than the current minute. Breaks whose event
+ * did not fit in the log are taken from the detectors and counted now,
+ * so the totals stay exact. The alarm mode starts the alarm instead of chiming, it
+ * loops in the background until the admin password is entered.
+ * Inputs:
+ * 		*event - EV_TRIPWIRE
+ * Outputs:
+ * 		none
+ */
+static void on_tripwire(const Event* event){
+	TripEvent trip;
+	uint32_t breaks = 0;
+	uint32_t now = get_rtc_minutes();
+	while(tripwire_next(&trip)){
+		if(trip.state == TRIP_BROKEN){
+			//a stamp taken before the calendar was set again can be ahead of it
+			uint32_t minute = rtc_stamp_seconds(trip.stamp)/60;
+			count_break(trip.lane, minute < now ? minute : now);
+			breaks++;
+		}
+	}
+	for(uint32_t i=0;i<LANES;i++){
+		uint32_t missed = beams[i].unlogged - unloggedSeen[i];
+		unloggedSeen[i] += missed;
+		for(uint32_t j=0;j<missed;j++){
+			count_break(i, now);
+		}
+		breaks += missed;
+	}
+	if(breaks == 0){
+		return;
+	}
+
+	switch(mode){
+		case SCAN:
+			play_note(&note);
+			break;
+		case ALARM:
+			if(!alarmed){
+				alarmed = true;
+				play_notes(alarm, sizeof(alarm)/sizeof(alarm[0]), PIEZO_ALARM, 1);
+			}
+			break;
+		case ACCESS:
+			play_note(&note);
+			print_scan_status();
+			break;
+		default:
+			break;
+	}
 }
 
 /**
- * This function will print the prompt to inform the user to enter the
- * time onto the LCD.
+ * Handles the one second tick. Refreshes the display for the current
+ * mode and steps through the menu pages.
  * Inputs:
+ * 		*event - EV_SECOND
+ * Outputs:
  * 		none
+ */
+static void on_second(const Event* event){
+	uint32_t minute = get_rtc_minutes();
+	traffic_advance(&traffic, minute);
+	for(uint32_t i=0;i<LANES;i++){
+		traffic_advance(&laneTraffic[i], minute);
+	}
+	if(minute != pendingMinute){
+		flush_traffic();
+	}
+
+	switch(mode){
+		case MENU:
+			menuPage = (menuPage % 2) + 1;
+			lcd_reset();
+			if(menuPage == 1){
+				lcd_print_string("1-Scan.");
+				lcd_row1();
+				lcd_print_string("2-Alarm.");
+			}else{
+				lcd_print_string("3-Access.");
+			}
+			break;
+		case SCAN:
+			print_time();
+			break;
+		case ALARM:
+		case LOGIN:
+			break;
+		case ACCESS:
+			print_scan_status();
+			break;
+	}
+}
+
+/**
+ * Handles received frames. There is no network protocol yet, so frames
+ * are taken off the NIC to keep its buffers free.
+ * Inputs:
+ * 		*event - EV_FRAME
  * Outputs:
  * 		none
  */
-static void promt_for_time(){
-	lcd_reset();
-	lcd_print_string("Enter the time:");
-	lcd_row1();
-	lcd_print_string("  :  :  ");
-	delay_ms(1000);
-	lcd_row1();
+static void on_frame(const Event* event){
+	FrameHeader header;
+	PacketBuf* p;
+	while((p = frame_receive_buf(&header)) != NULL){
+		pbuf_free(p);
+	}
 }
 
 /**
- * This function will print the prompt to inform the user to enter the
- * date onto the LCD.
+ * Answers statistics queries on USART2. 's' prints the traffic summary
+ * once the clock is set, 'b' the packet buffer pool counters and 'e'
+ * the event loop counters. Other characters are ignored.
+ * Inputs:
+ * 		*event - EV_SERIAL
+ * Outputs:
+ * 		none
+ */
+static void on_serial(const Event* event){
+	char c;
+	while(usart2_read(&c, 1) == 1){
+		if((c == 's' || c == 'S') && clockReady){
+			print_traffic();
+		}else if(c == 'b' || c == 'B'){
+			print_buffers();
+		}else if(c == 'e' || c == 'E'){
+			print_events();
+		}
+	}
+}
+
+/**
+ * Prints the traffic windows of the whole store and the totals of each
+ * lane to USART2. Averages are printed with one decimal.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
-static void promt_for_date(){
-	lcd_reset();
-	lcd_print_string("Enter the date:");
-	lcd_row1();
-	lcd_print_string("  /  /  ");
-	delay_ms(1000);
-	lcd_row1();
+static void print_traffic(){
+	uint32_t perMinute = traffic_average_x10(&traffic.minutes);
+	uint32_t perHour = traffic_average_x10(&traffic.hours);
+	uint32_t perDay = traffic_average_x10(&traffic.days);
+
+	printf("\r\ntotal %lu\r\n", (unsigned long)traffic.all_time);
+	printf("last hour %lu, %lu.%lu/min\r\n", (unsigned long)traffic.minutes.total,
+			(unsigned long)perMinute/10, (unsigned long)perMinute%10);
+	printf("last day %lu, %lu.%lu/hr\r\n", (unsigned long)traffic.hours.total,
+			(unsigned long)perHour/10, (unsigned long)perHour%10);
+	printf("last week %lu, %lu.%lu/day\r\n", (unsigned long)traffic.days.total,
+			(unsigned long)perDay/10, (unsigned long)perDay%10);
+	printf("busiest hour %02lu:00, %lu\r\n", (unsigned long)traffic_busiest_hour(&traffic),
+			(unsigned long)traffic.hours.max_count);
+	for(uint32_t i=0;i<LANES;i++){
+		printf("lane %lu: %lu total, %lu last hour\r\n", (unsigned long)i,
+				(unsigned long)laneTraffic[i].all_time, (unsigned long)laneTraffic[i].minutes.total);
+	}
 }
 
 /**
- * This function will get the time from the keyboard entered from the user
- * Memory is then allocated in order to return the string.
+ * Prints the packet buffer pool counters to USART2. A high water mark
+ * at PBUF_COUNT or any failed allocation means frames were lost for
+ * want of a buffer.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
-static char* get_time(){
-	char time[8];
-	uint8_t index=0;
-	for(int i=0; i<8;i++){
-		if(i==2||i==5){
-			lcd_data(':');
-		}else{
-			time[index] = key_getchar();
-			lcd_data(time[index]);
-			index++;
+static void print_buffers(){
+	const PoolStats* stats = pbuf_stats();
+	printf("\r\nbuffers %lu of %u in use, high water %lu\r\n", (unsigned long)stats->in_use,
+			PBUF_COUNT, (unsigned long)stats->high_water);
+	printf("failed allocations %lu\r\n", (unsigned long)stats->alloc_failures);
+}
+
+/**
+ * Prints the event loop counters to USART2: the share of time asleep,
+ * lost and unhandled events, and for each event type how many were
+ * handled with the worst latency and run time and the mean run time,
+ * in microseconds.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+static void print_events(){
+	static const char* const names[] = {"key", "tripwire", "second", "frame", "serial"};
+	_Static_assert(sizeof(names)/sizeof(names[0]) == EV_TYPES, "one name per event type");
+	const uint32_t cyclesPerUs = SYSCLK_HZ/1000000;
+	const EventStats* stats = event_stats();
+
+	printf("\r\nidle %lu%%, %lu lost, %lu unhandled\r\n", (unsigned long)event_idle_percent(),
+			(unsigned long)stats->overflows, (unsigned long)stats->unhandled);
+	for(uint32_t i=0;i<EV_TYPES;i++){
+		const HandlerStats* h = &stats->handlers[i];
+		uint32_t meanRun = h->count ? (uint32_t)(h->total_run/h->count) : 0;
+		printf("%s %lu, latency %lu us, run %lu us max %lu us\r\n", names[i], (unsigned long)h->count,
+				(unsigned long)(h->max_latency/cyclesPerUs), (unsigned long)(meanRun/cyclesPerUs),
+				(unsigned long)(h->max_run/cyclesPerUs));
+	}
+}
+
+/*
+ * Counts one break of a lane. Minute 0 is midnight on Jan 1 2000, so
+ * the hour ring index is the hour of the day. Breaks before the clock
+ * is set wait for start_clock.
+ */
+static void count_break(uint8_t lane, uint32_t minute){
+	if(clockReady){
+		record_break(lane, minute);
+	}else{
+		unclockedBreaks[lane]++;
+	}
+}
+
+/**
+ * Loads the traffic statistics saved in the flash log: the newest
+ * checkpoint, then the breaks logged after it. Per lane only the all
+ * time count is kept. Creates the log on the first boot.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+static void restore_traffic(){
+	uint32_t words[CHECKPOINT_WORDS];
+	traffic_init(&traffic, clockMinute);
+	for(uint32_t i=0;i<LANES;i++){
+		traffic_init(&laneTraffic[i], clockMinute);
+	}
+
+	if(flashlog_init(words, CHECKPOINT_WORDS) == CHECKPOINT_WORDS){
+		traffic_restore(&traffic, words);
+		for(uint32_t i=0;i<LANES;i++){
+			laneTraffic[i].all_time = words[TRAFFIC_SNAPSHOT_WORDS+i];
 		}
 	}
+	flashlog_replay(replay_record);
 
-	lcd_reset();
-	lcd_print_string("0 - AM");
-	lcd_row1();
-	lcd_print_string("1 - PM");
+	traffic_advance(&traffic, clockMinute);
+	pendingMinute = clockMinute;
+	if(flashlog_checkpoint_due()){
+		save_traffic();
+	}
+}
 
-	uint8_t am_pm = -1;
-	while(am_pm != 0 && am_pm != 1){
-		am_pm = key_getint();
-		time[6] = am_pm;
+static void replay_record(uint8_t type, uint8_t tag, const uint32_t* data){
+	if(type == LOG_COUNT){
+		traffic_record(&traffic, data[0], data[1]);
+		if(tag < LANES){
+			traffic_record(&laneTraffic[tag], data[0], data[1]);
+		}
 	}
+}
 
-	char* temp= malloc(strlen(time)+1);
-	strcpy(temp,time);
-	return temp;
+/*
+ * Counts one break. The flash log is written once a minute, see
+ * flush_traffic.
+ */
+static void record_break(uint8_t lane, uint32_t minute){
+	if(minute != pendingMinute){
+		flush_traffic();
+		pendingMinute = minute;
+	}
+	traffic_record(&laneTraffic[lane], minute, 1);
+	traffic_record(&traffic, minute, 1);
+	pendingBreaks[lane]++;
 }
 
 /**
- * This function will get the date from the keyboard entered from the user
- * Memory is then allocated in order to return the string.
+ * Writes the breaks of the pending minute to the flash log, one record
+ * per lane, and a checkpoint when the log asks for one. A reset loses
+ * at most the minute that was still pending.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
-static char* get_date(){
-	char date[7];
-	uint8_t index=0;
-	for(int i=0; i<8;i++){
-		if(i==2||i==5){
-			lcd_data('/');
-		}else{
-			date[index] = key_getchar();
-			lcd_data(date[index]);
-			index++;
+static void flush_traffic(){
+	for(uint32_t i=0;i<LANES;i++){
+		if(pendingBreaks[i] == 0){
+			continue;
+		}
+		uint32_t data[FLASHLOG_DATA_WORDS] = {pendingMinute, pendingBreaks[i], 0};
+		if(flashlog_append(LOG_COUNT, i, data) < 0){
+			save_traffic();		//the checkpoint covers what is pending
+			return;
 		}
+		pendingBreaks[i] = 0;
 	}
-	char* temp= malloc(strlen(date)+1);
-	strcpy(temp,date);
-	return temp;
+	pendingMinute = get_rtc_minutes();
+
+	if(flashlog_checkpoint_due()){
+		save_traffic();
+	}
+}
+
+/*
+ * Writes a checkpoint of everything counted so far. Moving the log to
+ * the other sector erases it first, which stalls the core for over a
+ * second, about once every few thousand records.
+ */
+static void save_traffic(){
+	uint32_t words[CHECKPOINT_WORDS];
+	traffic_save(&traffic, words);
+	for(uint32_t i=0;i<LANES;i++){
+		words[TRAFFIC_SNAPSHOT_WORDS+i] = laneTraffic[i].all_time;
+	}
+	if(flashlog_checkpoint(words, CHECKPOINT_WORDS) == 0){
+		for(uint32_t i=0;i<LANES;i++){
+			pendingBreaks[i] = 0;
+		}
+	}
+}
+
+//interrupt context callbacks, they only post events
+
+static void post_key(){
+	event_post(EV_KEY, 0);
+}
+
+static void post_frame(){
+	event_post(EV_FRAME, 0);
+}
+
+static void post_second(){
+	event_post(EV_SECOND, 0);
+}
+
+static void post_serial(){
+	event_post(EV_SERIAL, 0);
+}
+
+/**
+ * This function will print the prompt to inform the user to enter the
+ * time onto the LCD.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+static void promt_for_time(){
+	lcd_reset();
+	lcd_print_string("Enter the time:");
+	lcd_row1();
+	lcd_print_string("  :  :  ");
+}
+
+/**
+ * This function will print the prompt to inform the user to enter the
+ * date onto the LCD.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+static void promt_for_date(){
+	lcd_reset();
+	lcd_print_string("Enter the date:");
+	lcd_row1();
+	lcd_print_string("  /  /  ");
 }
 
 /**
- * This function is used to work with the get_time() function. The string
- * that is returned from that function is parsed, converted out of string
- * form into BCD form. A RTC_Time structure is created with the parsed
- * data, and returned.
+ * This function converts the time digits typed by the user, HHMMSS,
+ * into BCD form in a RTC_Time structure.
  * Inputs:
- * 		char* time_in - the current time in string form
+ * 		const char* digits - six digits, not NUL terminated
+ * 		uint8_t pm - 1 for PM, 0 for AM
+ * 		RTC_Time* time - structure to fill
  * Outputs:
- * 		RTC_Time* - pointer to the structure created to represent time.
+ * 		none
  */
-static RTC_Time* conv_time(char* time_in){
-	uint8_t hours = ((uint8_t)((*time_in)-TOINT)<<4) | (*(++time_in)-TOINT);
-	uint8_t mins = ((uint8_t)(*(++time_in)-TOINT)<<4) | (*(++time_in))-TOINT;
-	uint8_t sec = ((uint8_t)(*(++time_in)-TOINT)<<4) | (*(++time_in))-TOINT;
-	uint8_t am_pm = *(++time_in);
-	RTC_Time rtcTime = {hours,mins,sec,am_pm};
-	RTC_Time* temp = malloc(sizeof(rtcTime));
-	memcpy(temp,&rtcTime,sizeof(rtcTime));
-	return temp;
+static void conv_time(const char* digits, uint8_t pm, RTC_Time* time){
+	time->RTC_Hours = ((digits[0]-TOINT)<<4) | (digits[1]-TOINT);
+	time->RTC_Minutes = ((digits[2]-TOINT)<<4) | (digits[3]-TOINT);
+	time->RTC_Seconds = ((digits[4]-TOINT)<<4) | (digits[5]-TOINT);
+	time->timeMode = pm;
 }
 
 /**
- * This function is used to work with the get_date() function. The string
- * that is returned from that function is parsed, converted out of string
- * form into BCD form. A RTC_Date structure is created with the parsed
- * data, and returned.
+ * This function converts the date digits typed by the user, MMDDYY,
+ * into BCD form in a RTC_Date structure.
  * Inputs:
- * 		char* date_in - the current date in string form
+ * 		const char* digits - six digits, not NUL terminated
+ * 		RTC_Date* date - structure to fill
  * Outputs:
- * 		RTC_Date* - pointer to the structure created to represent the date.
+ * 		none
  */
-static RTC_Date* conv_date(char* date_in){
-	uint8_t month = (((*date_in)-TOINT)<<4) | (*(++date_in)-TOINT);
-	uint8_t day = (*((++date_in)-TOINT)<<4) | (*(++date_in))-TOINT;
-	uint8_t year = (*((++date_in)-TOINT)<<4) | (*(++date_in))-TOINT;
-	RTC_Date rtcDate = {2,month,day,year};
-	RTC_Date* temp = malloc(sizeof(rtcDate));
-	memcpy(temp,&rtcDate,sizeof(rtcDate));
-	return temp;
+static void conv_date(const char* digits, RTC_Date* date){
+	date->RTC_WeekDay = 2;
+	date->RTC_Month = ((digits[0]-TOINT)<<4) | (digits[1]-TOINT);
+	date->RTC_Date = ((digits[2]-TOINT)<<4) | (digits[3]-TOINT);
+	date->RTC_Year = ((digits[4]-TOINT)<<4) | (digits[5]-TOINT);
 }
 
 /**
- * This function initializes the RTC clock by getting the date and time
- * from the user, converting it to it's necessary RTC structures, and
- * calling the init_rtc function.
+ * Starts the calendar services once the RTC is running: the one second
+ * wakeup, the minute count of the traffic statistics and the statistics
+ * saved in flash. Breaks seen before the clock was set are counted in
+ * the current minute. When the clock is set again the pending minute is
+ * written under the old calendar first, and the statistics in RAM are
+ * kept rather than reloaded from flash.
  * Input:
  * 		none
  * Output:
  * 		none
  */
-static void initClock(){
-	promt_for_date();
-	char* date_in = get_date();
-	lcd_reset();
-	promt_for_time();
-	char* time_in = get_time();
-	init_rtc(conv_date(date_in),conv_time(time_in));
+static void start_clock(){
+	if(clockReady){
+		flush_traffic();
+	}
+	rtc_clock_init();
+	clockMinute = get_rtc_minutes();
+	if(clockReady){
+		pendingMinute = clockMinute;
+	}else{
+		restore_traffic();
+	}
+	clockReady = true;
 
-	free(date_in);
-	free(time_in);
+	for(uint32_t i=0;i<LANES;i++){
+		for(;unclockedBreaks[i]>0;unclockedBreaks[i]--){
+			record_break(i, clockMinute);
+		}
+	}
 }
 
 /**
@@ -299,99 +643,196 @@ static void initClock(){
  * 		none
  */
 static void bootUp(){
+	event_init();
+	timer_init();
 	init_piezo();
 	key_init();
 	lcd_init(C_OFF);
+	nic_init(NIC_DEFAULT_BITRATE);
+	frame_init(FRAME_ADDRESS_FROM_UID);
+	init_usart2(SERIAL_BAUD, SYSCLK_HZ);
 }
 
 /**
  * This function prompts a user to login using their username and
- * password. Users are forced to enter their entire user name and
- * password before being checked in order to eliminate brute force
- * hacking. An enumerated type Result is returned based on the result
- * of the login
+ * password. The keys arrive one at a time through entry_key, so
+ * nothing waits here. Users are forced to enter their entire user name
+ * before it is checked, and their entire password before that is.
  * Inputs:
- * 		none
+ * 		failed - the last attempt was wrong, say so until the next key
  * Outputs:
- * 		CORRECT - successful login
- * 		INCORRECT - failed login
+ * 		none
  */
-static Result login(){
-	lcd_reset();
-	lcd_print_string("Username:");
-	lcd_row1();
-	char username_in[USERNAME_LENGTH+1];
+static void begin_login(bool failed){
+	mode = LOGIN;
+	begin_entry(ENTER_USERNAME);
+	if(failed){
+		lcd_row1();
+		lcd_print_string("Incorrect.");
+	}
+	entryFailed = failed;
+}
 
-	for(int i=0;i<strlen(mitchell.username); i++){
-		char keyPressed = key_getchar();
-		username_in[i] = keyPressed;
-		lcd_data(keyPressed);
+/*
+ * Shows the prompt for an entry step and clears the keys typed so far
+ */
+static void begin_entry(EntryStep step){
+	entryStep = step;
+	entryIndex = 0;
+	switch(step){
+		case ENTER_USERNAME:
+			lcd_reset();
+			lcd_print_string("Username:");
+			break;
+		case ENTER_PASSWORD:
+			lcd_reset();
+			lcd_print_string("Password:");
+			break;
+		case ENTER_DATE:
+			promt_for_date();
+			break;
+		case ENTER_TIME:
+			promt_for_time();
+			break;
+		case ENTER_AM_PM:
+			lcd_reset();
+			lcd_print_string("0 - AM");
+			lcd_row1();
+			lcd_print_string("1 - PM");
+			break;
 	}
-	username_in[USERNAME_LENGTH] = '\0';
-	if(strcmp(username_in,mitchell.username)) return INCORRECT;
+}
 
-	lcd_reset();
-	lcd_print_string("Password:");
-	lcd_row1();
+/**
+ * Feeds one key to the login and clock entry. The username is echoed,
+ * the password shows as '*'. The date and time only take digits, which
+ * fill the blanks around the separators. A wrong username or password
+ * starts the login over. After a login the clock is asked for if it is
+ * not running, then the menu is shown.
+ * Inputs:
+ * 		keyPressed - the key that was pressed
+ * Outputs:
+ * 		none
+ */
+static void entry_key(char keyPressed){
+	switch(entryStep){
+		case ENTER_USERNAME:
+			if(entryFailed){
+				lcd_row1();
+				lcd_print_string("          ");
+				entryFailed = false;
+			}
+			entry[entryIndex] = keyPressed;
+			lcd_set_position(1,entryIndex);
+			lcd_data(keyPressed);
+			if(++entryIndex == USERNAME_LENGTH){
+				entry[entryIndex] = '\0';
+				if(strcmp(entry,mitchell.username)){
+					begin_login(true);
+				}else{
+					begin_entry(ENTER_PASSWORD);
+				}
+			}
+			break;
+
+		case ENTER_PASSWORD:
+			entry[entryIndex] = keyPressed;
+			lcd_set_position(1,entryIndex);
+			lcd_data('*');
+			if(++entryIndex == PASSWORD_LENGTH){
+				entry[entryIndex] = '\0';
+				if(strcmp(entry,mitchell.password)){
+					begin_login(true);
+				}else if(clockReady){
+					enter_menu();
+				}else{
+					begin_entry(ENTER_DATE);
+				}
+			}
+			break;
 
-	char pass_in[PASSWORD_LENGTH+1];
-	for(int i=0;i<strlen(mitchell.password); i++){
-		pass_in[i] = key_getchar();
-		lcd_data('*');
+		case ENTER_DATE:
+		case ENTER_TIME:
+			if(keyPressed < '0' || keyPressed > '9'){
+				break;
+			}
+			entry[entryIndex] = keyPressed;
+			lcd_set_position(1,entryIndex + entryIndex/2);		//skip the separators
+			lcd_data(keyPressed);
+			if(++entryIndex == DIGITS_LENGTH){
+				if(entryStep == ENTER_DATE){
+					memcpy(dateDigits,entry,DIGITS_LENGTH);
+					begin_entry(ENTER_TIME);
+				}else{
+					memcpy(timeDigits,entry,DIGITS_LENGTH);
+					begin_entry(ENTER_AM_PM);
+				}
+			}
+			break;
+
+		case ENTER_AM_PM:
+			if(keyPressed == '0' || keyPressed == '1'){
+				RTC_Date date;
+				RTC_Time time;
+				conv_date(dateDigits,&date);
+				conv_time(timeDigits,keyPressed-TOINT,&time);
+				init_rtc(&date,&time);
+				start_clock();
+				enter_menu();
+			}
+			break;
 	}
-	pass_in[PASSWORD_LENGTH] = '\0';
-	if(strcmp(pass_in,mitchell.password)) return INCORRECT;
-
-	lcd_reset();
-	return CORRECT;
 }
 
 /**
- * This function prompts a user for which mode to run. This is how
- * control is shifted in the state machine. Only valid results can
- * be chosen
+ * This function shows the menu used to pick which mode to run. This is
+ * how control is shifted in the state machine. The menu pages change
+ * on the second tick and only valid keys are accepted, see on_key.
  * Inputs:
  * 		none
  * Outputs:
- * 		TASKMODE - mode to switch system to.
+ * 		none
  */
-static TASKMODE getCommand(){
+static void enter_menu(){
+	mode = MENU;
+	menuPage = 0;
 	lcd_reset();
 	lcd_print_string("What should I do?");
-	delay_ms(1000);
-	uint8_t choice = 0;
-	while(choice==0 || choice>3){
-		lcd_reset();
-		lcd_print_string("1-Scan.");
-		lcd_row1();
-		lcd_print_string("2-Alarm.");
-		delay_ms(1000);
-		lcd_reset();
-		lcd_print_string("3-Access.");
-		delay_ms(1000);
-		choice = key_getkey_noblock();
+}
+
+/**
+ * This function switches the system to a mode chosen from the menu.
+ * Inputs:
+ * 		newMode - mode to switch system to.
+ * Outputs:
+ * 		none
+ */
+static void enter_mode(TASKMODE newMode){
+	mode = newMode;
+	lcd_reset();
+
+	//redraw the status from scratch
+	prevCount = -1;
+	prevHr = -1;
+	if(mode == SCAN){
+		print_time();
+	}else if(mode == ACCESS){
+		print_scan_status();
 	}
-	return choice;
 }
 
 /**
- * This function will print the current time to the LCD, but only
- * if there has been a change in time. Otherwise nothing is printed
+ * This function will print the current time to the LCD. The LCD
+ * framebuffer only sends the characters that changed.
  * Inputs:
  * 		none
  * Outputs:
  * 		none
  */
 static void print_time(){
-	char time_string[12];
-	char previous[12];
+	char time_string[12] = "";
 
-	lcd_row0();
-	strcpy(time_string,time_to_string(time_string));
-	if(strcmp(previous,time_string)){
-		lcd_print_string(time_to_string(time_string));
-		strcpy(previous,time_string);
-	}
+	lcd_fb_print(0,0,time_to_string(time_string));
 }
 
 /**
@@ -405,15 +846,9 @@ static void print_time(){
  * 		none
  */
 static void print_scan_status(){
-	static uint32_t prevCount = -1;
-	static uint32_t prevHr = -1;
-	uint32_t customerCount = ceil(doorCount/2);
-	uint32_t busiestHr=0;
-	for(int i=0;i<24;i++){
-		if(hourCount[i]>hourCount[busiestHr]){
-			busiestHr = i;
-		}
-	}
+	uint32_t customerCount = traffic.all_time;
+
+	uint32_t busiestHr = traffic_busiest_hour(&traffic);
 
 	if(prevCount!=customerCount){
 		prevCount = customerCount;
@@ -450,18 +885,15 @@ static void print_scan_status(){
 }
 
 /**
- * This function will check the if a password is correct. This function
- * will not block so that it can be called in a continous loop. Since
- * the keypad is buffered, only periodically checking the entered
- * password will be okay.
+ * This function will check the if a password is correct. It is fed one
+ * key at a time from the key event handler and never blocks.
  * Inputs:
- * 		none
+ * 		keyPressed - the key that was pressed
  * Outputs:
  * 		Result - CORRECT, INCORRECT
  * 		-1 - password entry not complete
  */
-static Result checkPassword(){
-	char keyPressed = key_getchar_noblock();
+static Result checkPassword(char keyPressed){
 	if(keyPressed!=0){
 		currentPassword[passwordIndex] = keyPressed;
 		lcd_set_position(1,passwordIndex);
@@ -479,22 +911,20 @@ static Result checkPassword(){
 	return -1;
 }
 
-void ADC_IRQHandler(void){
-	//clear interupt flag
-	*(ADC_SR) &= ~(1<<1);
-	
-	//load data from data register
-	uint16_t data = *(ADC_DR) & 0xFFFF;
-	float mV = ((3.3*data)/4095)*1000;
-	if(mV<250){
-		if(!blocked){
-			blocked = true;
-			doorCount++;
-		}
-	}else{
-		if(blocked){
-			blocked = false;
-		}
+/**
+ * Receives each block of tripwire samples from the ADC and runs it
+ * through the lane detectors. The detectors log every break with its
+ * time, the event loop is only woken when there is something to read.
+ * Inputs:
+ * 		*block - raw samples, interleaved by lane
+ * 		frames - number of samples per lane
+ * 		lanes - number of lanes
+ * Outputs:
+ * 		none
+ */
+static void on_adc_block(const uint16_t* block, uint32_t frames, uint32_t lanes){
+	uint32_t breaks = tripwire_process(beams, lanes, block, frames, rtc_stamp_now());
+	if(breaks){
+		event_post(EV_TRIPWIRE, breaks);
 	}
 }
-
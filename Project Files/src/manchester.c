@@ -0,0 +1,206 @@
+/*
+ * manchester.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ */
+
+#include "manchester.h"
+
+/**
+ * Prepares an encoder to send a buffer. The buffer must stay valid until
+ * the encoder reports the end of the data.
+ * Inputs:
+ * 		*enc - encoder state
+ * 		*data - bytes to encode
+ * 		length - number of bytes
+ * Outputs:
+ * 		none
+ */
+void manchester_encoder_start(ManchesterEncoder* enc, const uint8_t* data, uint16_t length){
+	enc->data = data;
+	enc->length = length;
+	enc->index = 0;
+	enc->shift = 0;
+	enc->halves = 0;
+}
+
+/**
+ * Returns the level of the next half bit. A byte is expanded once when
+ * it is loaded, so every other call is a shift and a mask.
+ * Inputs:
+ * 		*enc - encoder state
+ * Outputs:
+ * 		0 or 1 - line level for the next half bit
+ * 		-1 - all data has been sent
+ */
+int manchester_encoder_next(ManchesterEncoder* enc){
+	if(enc->halves == 0){
+		if(enc->index >= enc->length){
+			return -1;
+		}
+		enc->shift = manchester_expand(enc->data[enc->index++]);
+		enc->halves = 16;
+	}
+
+	int level = (enc->shift >> 15) & 1;
+	enc->shift <<= 1;
+	enc->halves--;
+	return level;
+}
+
+/**
+ * Prepares a decoder to receive a frame into buf. The line is assumed to
+ * be idle.
+ * Inputs:
+ * 		*dec - decoder state
+ * 		*buf - storage for the decoded bytes
+ * 		capacity - size of buf
+ * Outputs:
+ * 		none
+ */
+void manchester_decoder_start(ManchesterDecoder* dec, uint8_t* buf, uint16_t capacity){
+	dec->state = MD_HUNT;
+	dec->level = MANCHESTER_IDLE_LEVEL;
+	dec->half_pending = 0;
+	dec->bits = 0;
+	dec->shift = 0;
+	dec->count = 0;
+	dec->sum = 0;
+	dec->buf = buf;
+	dec->capacity = capacity;
+	dec->length = 0;
+	dec->overflow = 0;
+}
+
+/**
+ * Handles one edge on the line. Every edge is decided with a couple of
+ * compares. The level after the edge is tracked by toggling, starting
+ * from the idle level.
+ *
+ * The first edge of the preamble is the middle of a 0, and the preamble
+ * only has edges at bit centres, so its intervals give the bit period.
+ * After that an interval near the full period is a bit centre, and two
+ * intervals near half the period are a bit boundary then a bit centre.
+ * The level after a bit centre edge is the bit's value.
+ * Inputs:
+ * 		*dec - decoder state
+ * 		interval - timer ticks since the previous edge
+ * Outputs:
+ * 		0 - edge accepted
+ * 		-1 - the edge did not fit the coding, the decoder went back to hunting
+ */
+int manchester_decoder_edge(ManchesterDecoder* dec, uint32_t interval){
+	dec->level ^= 1;
+
+	switch(dec->state){
+		case MD_HUNT:
+			if(dec->level != 0){
+				return 0;			//not the falling edge that opens the preamble
+			}
+			dec->state = MD_PREAMBLE;
+			dec->count = 0;
+			dec->sum = 0;
+			return 0;
+
+		case MD_PREAMBLE:
+			//every preamble interval is one bit period, allow +-25% drift from the average
+			if(dec->count != 0){
+				uint32_t avg = dec->sum/dec->count;
+				if(interval < avg-(avg>>2) || interval > avg+(avg>>2)){
+					break;
+				}
+			}
+			dec->sum += interval;
+			if(++dec->count == MANCHESTER_PREAMBLE_INTERVALS){
+				dec->period = dec->sum/MANCHESTER_PREAMBLE_INTERVALS;
+				dec->state = MD_DATA;
+				dec->half_pending = 0;
+				dec->bits = 0;
+			}
+			return 0;
+
+		case MD_DATA:{
+			uint32_t period = dec->period;
+			if(interval < (period>>2) || interval > period+(period>>1)){
+				break;
+			}
+
+			int is_short = interval < ((period*3)>>2);
+			if(dec->half_pending){
+				if(!is_short) break;
+				dec->half_pending = 0;
+			}else if(is_short){
+				dec->half_pending = 1;		//bit boundary, the centre edge follows
+				return 0;
+			}else{
+				//track the sender's clock through the frame
+				dec->period = period - (period>>3) + (interval>>3);
+			}
+
+			dec->shift = (dec->shift<<1) | dec->level;
+			if(++dec->bits == 8){
+				if(dec->length < dec->capacity){
+					dec->buf[dec->length++] = dec->shift;
+				}else{
+					dec->overflow = 1;
+				}
+				dec->bits = 0;
+			}
+			return 0;
+		}
+
+		case MD_SKIP:
+			return 0;
+	}
+
+	dec->state = MD_HUNT;
+	dec->level = MANCHESTER_IDLE_LEVEL;
+	dec->length = 0;
+	dec->overflow = 0;
+	return -1;
+}
+
+/**
+ * Ends the frame being received when the line has been idle for longer
+ * than a bit period. The decoder is left hunting for the next preamble.
+ * Inputs:
+ * 		*dec - decoder state
+ * Outputs:
+ * 		>0 - number of bytes in the completed frame
+ * 		0 - nothing was being received, or the frame was skipped
+ * 		-1 - the frame was cut short or did not fit in the buffer
+ */
+int manchester_decoder_idle(ManchesterDecoder* dec){
+	int result = 0;
+	if(dec->state == MD_DATA){
+		if(dec->bits == 0 && dec->length > 0 && !dec->overflow){
+			result = dec->length;
+		}else{
+			result = -1;
+		}
+	}else if(dec->state == MD_PREAMBLE){
+		result = -1;
+	}
+
+	dec->state = MD_HUNT;
+	dec->level = MANCHESTER_IDLE_LEVEL;
+	dec->half_pending = 0;
+	dec->length = 0;
+	dec->overflow = 0;
+	return result;
+}
+
+/**
+ * Stops decoding the frame being received. Its remaining edges are
+ * ignored and the frame ends without a result at the next idle. Also
+ * used when an edge has been lost, so it applies whatever the state:
+ * the level can no longer be trusted until the line goes idle.
+ * Inputs:
+ * 		*dec - decoder state
+ * Outputs:
+ * 		none
+ */
+void manchester_decoder_skip(ManchesterDecoder* dec){
+	dec->state = MD_SKIP;
+}
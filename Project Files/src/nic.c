@@ -0,0 +1,565 @@
+/*
+ * nic.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Transmit side of the network interface. TIM5 free runs at the core
+ * clock. For every half bit the compare ISR moves CCR1 forward by one
+ * half bit period and selects "set active" or "set inactive on match"
+ * for the next level, so the edge itself is made by the timer. Frames
+ * are packet buffers queued by nic_send_buf and drained by the ISR; the
+ * preamble is pushed into the buffer's headroom.
+ *
+ * Receive side: TIM4 captures both edges on PB6. The capture ISR hands
+ * the interval since the previous edge to the decoder, which writes
+ * straight into a packet buffer taken from the pool. Channel 2 of
+ * the same timer is moved 1.5 bit periods past every edge; when it
+ * matches, the line has gone idle and the frame is complete. Once the
+ * header has been decoded an optional filter can reject the frame, and
+ * the decoder then ignores the rest of it.
+ *
+ * Channel state: an edge makes the channel busy and the receive idle
+ * timeout makes it idle again. A frame only starts on an idle channel;
+ * otherwise it waits for the idle timeout. While sending, TIM5 channel
+ * 2 samples the line a quarter bit into every half bit. Reading low
+ * while driving high is a collision: the frame is cut off and retried
+ * after a random binary exponential backoff.
+ */
+
+#include "nic.h"
+#include "mmio.h"
+#include "timer.h"
+#include "irq.h"
+#include "prof.h"
+#include "RTC.h"
+#include <string.h>
+
+#define RCC_APB1ENR (volatile uint32_t*) 0x40023840
+#define TX_SLOT_MASK (NIC_TX_SLOTS-1)
+#define RX_SLOT_MASK (NIC_RX_SLOTS-1)
+
+_Static_assert((NIC_TX_SLOTS & TX_SLOT_MASK) == 0, "NIC_TX_SLOTS must be a power of two");
+_Static_assert((NIC_RX_SLOTS & RX_SLOT_MASK) == 0, "NIC_RX_SLOTS must be a power of two");
+_Static_assert(PBUF_HEADROOM >= 1, "no headroom for the preamble");
+_Static_assert(PBUF_SIZE - PBUF_HEADROOM >= NIC_MAX_FRAME, "packet buffers too small for a frame");
+
+typedef enum {TX_IDLE, TX_DEFER, TX_SENDING, TX_LAST, TX_GAP, TX_BACKOFF} TxState;
+
+static volatile TIMx* tim4 = (TIMx*) TIM4_BASE;
+static volatile TIMx* tim5 = (TIMx*) TIM5_BASE;
+static volatile GPIOx* rx_port = (GPIOx*) 0x40020400;
+
+static PacketBuf* tx_slots[NIC_TX_SLOTS];
+static volatile uint32_t tx_put;		//written by nic_send_buf
+static volatile uint32_t tx_get;		//written by the ISR
+static volatile TxState tx_state = TX_IDLE;
+static ManchesterEncoder encoder;
+static uint32_t half_bit;
+static uint8_t line_level;				//level on the pin during this half bit
+static uint8_t next_level;				//level the pin takes at the next match
+static uint8_t attempts;				//collisions on the frame at the head of the queue
+static uint32_t random_state;
+static volatile ChannelState channel = CH_IDLE;
+static NIC_Stats stats;
+
+static PacketBuf* rx_slots[NIC_RX_SLOTS];
+static uint8_t rx_discard[NIC_MAX_FRAME];	//decode target when there is nowhere to keep the frame
+static PacketBuf* rx_buf;				//buffer the decoder is writing into, NULL for rx_discard
+static volatile uint32_t rx_put;		//written by the ISR
+static volatile uint32_t rx_get;		//written by nic_receive_buf
+static ManchesterDecoder decoder;
+static uint16_t last_edge;
+static uint16_t idle_ticks;
+static nic_rx_filter rx_filter;
+static uint32_t rx_header_length;
+static uint8_t rx_header_checked;
+static nic_rx_callback rx_callback;
+
+static void set_next_level(uint32_t mode);
+static void try_start();
+static void start_frame();
+static void collision();
+static void tx_release();
+static uint32_t backoff_random();
+static void rx_init();
+static void rx_arm();
+static void rx_frame_end();
+
+/**
+ * This function sets up PA0 as TIM5_CH1 and starts TIM5 free running
+ * at the core clock. The line is held at its idle level. The receiver
+ * is then started on PB6.
+ * Inputs:
+ * 		bitrate - bits per second on the wire, clamped to NIC_MIN_BITRATE
+ * 				through NIC_MAX_BITRATE
+ * Outputs:
+ * 		none
+ */
+void nic_init(uint32_t bitrate){
+	if(bitrate < NIC_MIN_BITRATE){
+		bitrate = NIC_MIN_BITRATE;
+	}else if(bitrate > NIC_MAX_BITRATE){
+		bitrate = NIC_MAX_BITRATE;
+	}
+	half_bit = SYSCLK_HZ/(2*bitrate);
+
+	enable_clock(NIC_TX_PORT);
+	set_pin_mode(NIC_TX_PORT, NIC_TX_PIN, ALTFUNC);
+	set_alt_func(NIC_TX_PORT, NIC_TX_PIN, NIC_TX_AF);
+	set_output_speed(NIC_TX_PORT, NIC_TX_PIN, FAST);
+	set_pin_output_type(NIC_TX_PORT, NIC_TX_PIN, OPEN_DRAIN);
+	set_pin_PUPDR(NIC_TX_PORT, NIC_TX_PIN, PULLUP);
+
+	//seed the backoff from the device's unique ID so nodes pick different slots
+	random_state = *(NIC_UID) ^ *(NIC_UID+1) ^ *(NIC_UID+2) ^ (uint32_t)now_cycles();
+	if(random_state == 0){
+		random_state = 1;
+	}
+
+	//enable clock for TIM5
+	*(RCC_APB1ENR) |= 1<<APB1ENR_TIM5_F;
+
+	tim5->CR1 = 0;
+	tim5->PSC = 0;
+	tim5->ARR = 0xFFFFFFFF;
+	tim5->CCMR1 = OCM_FORCE_ACTIVE<<4;		//idle high, no preload on CCR1, CC2 frozen
+	tim5->CCER |= 1;						//CC1 output enable
+	tim5->EGR = 1<<TIM_UG;
+	REG_WRITE(&tim5->SR, 0);
+	tim5->CR1 = 1<<TIM_CEN;
+
+	tx_put = tx_get = 0;
+	tx_state = TX_IDLE;
+	attempts = 0;
+
+	*(NVIC_ISER1) = 1<<(NIC_TIM5_IRQ-32);
+
+	rx_init();
+}
+
+/**
+ * Queues a frame for transmission by copying it into a packet buffer.
+ * The caller may reuse its buffer as soon as this returns. Never blocks.
+ * Inputs:
+ * 		*data - frame to send
+ * 		length - number of bytes, at most NIC_MAX_FRAME
+ * Outputs:
+ * 		1 - frame queued
+ * 		0 - frame too long, no free buffer or queue full
+ */
+int nic_send(const uint8_t* data, uint32_t length){
+	PacketBuf* p = NULL;
+	if(length <= NIC_MAX_FRAME){
+		p = pbuf_alloc();
+	}
+	if(p == NULL){
+		stats.frames_dropped++;
+		return 0;
+	}
+	memcpy(pbuf_append(p, length), data, length);
+	return nic_send_buf(p);
+}
+
+/**
+ * Queues a packet buffer for transmission without copying it. The NIC
+ * takes over the caller's reference, whether or not the frame is
+ * queued. Never blocks.
+ * Inputs:
+ * 		*buf - frame to send, at most NIC_MAX_FRAME bytes
+ * Outputs:
+ * 		1 - frame queued
+ * 		0 - frame too long or queue full, the buffer has been freed
+ */
+int nic_send_buf(PacketBuf* buf){
+	uint32_t p = tx_put;
+	if(buf->length > NIC_MAX_FRAME || (p - tx_get) >= NIC_TX_SLOTS
+			|| pbuf_push(buf, 1) == NULL){
+		pbuf_free(buf);
+		stats.frames_dropped++;
+		return 0;
+	}
+
+	*pbuf_data(buf) = MANCHESTER_PREAMBLE;
+	tx_slots[p & TX_SLOT_MASK] = buf;
+	__atomic_store_n(&tx_put, p+1, __ATOMIC_RELEASE);
+
+	uint32_t primask = irq_save();
+	if(tx_state == TX_IDLE){
+		try_start();
+	}
+	irq_restore(primask);
+
+	return 1;
+}
+
+/**
+ * Returns the number of frames queued or being sent
+ */
+uint32_t nic_tx_pending(){
+	return tx_put - tx_get;
+}
+
+/**
+ * Copies the oldest received frame out of the receive ring. Never blocks.
+ * Inputs:
+ * 		*data - destination for the frame
+ * 		capacity - size of data, longer frames are truncated
+ * Outputs:
+ * 		number of bytes copied, 0 if no frame is waiting
+ */
+uint32_t nic_receive(uint8_t* data, uint32_t capacity){
+	PacketBuf* p = nic_receive_buf();
+	if(p == NULL){
+		return 0;
+	}
+
+	uint32_t length = p->length;
+	if(length > capacity){
+		length = capacity;
+	}
+	memcpy(data, pbuf_data(p), length);
+	pbuf_free(p);
+	return length;
+}
+
+/**
+ * Takes the oldest received frame off the receive ring without copying
+ * it. Never blocks.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		the frame, which the caller must pbuf_free, or NULL if none is waiting
+ */
+PacketBuf* nic_receive_buf(){
+	uint32_t g = rx_get;
+	if(__atomic_load_n(&rx_put, __ATOMIC_ACQUIRE) == g){
+		return NULL;
+	}
+
+	PacketBuf* p = rx_slots[g & RX_SLOT_MASK];
+	__atomic_store_n(&rx_get, g+1, __ATOMIC_RELEASE);
+	return p;
+}
+
+/**
+ * Returns the number of received frames waiting to be read
+ */
+uint32_t nic_rx_pending(){
+	return rx_put - rx_get;
+}
+
+/**
+ * Returns the length of a half bit in core clock cycles
+ */
+uint32_t nic_half_bit_cycles(){
+	return half_bit;
+}
+
+/**
+ * Returns the state of the shared line as seen by the receiver
+ */
+ChannelState nic_channel_state(){
+	return channel;
+}
+
+/**
+ * Returns the transmit and receive counters
+ */
+const NIC_Stats* nic_stats(){
+	return &stats;
+}
+
+/**
+ * Installs a filter that is shown the first header_length bytes of every
+ * frame. Frames it rejects are dropped without decoding the rest.
+ * Inputs:
+ * 		header_length - bytes to collect before calling the filter
+ * 		filter - decision function, NULL to keep every frame
+ * Outputs:
+ * 		none
+ */
+void nic_set_rx_filter(uint32_t header_length, nic_rx_filter filter){
+	uint32_t primask = irq_save();
+	rx_header_length = header_length;
+	rx_filter = filter;
+	irq_restore(primask);
+}
+
+/**
+ * Registers a function to be called from interrupt context every time
+ * a frame is added to the receive ring. NULL removes the callback.
+ */
+void nic_set_rx_callback(nic_rx_callback callback){
+	rx_callback = callback;
+}
+
+/*
+ * Selects the level the pin takes at the next compare match.
+ */
+static void set_next_level(uint32_t level){
+	uint32_t mode = level ? OCM_ACTIVE : OCM_INACTIVE;
+	tim5->CCMR1 = (tim5->CCMR1 & ~(0b111<<4)) | (mode<<4);
+	next_level = level;
+}
+
+/*
+ * Starts the frame at the head of the queue if the channel is idle.
+ * If it is busy the frame waits for the receiver's idle timeout. If the
+ * queue is empty the transmitter goes idle. Called from an ISR or with
+ * interrupts masked.
+ */
+static void try_start(){
+	if(tx_put == tx_get){
+		tim5->DIER &= ~((1<<TIM_CC1IE)|(1<<TIM_CC2IE));
+		tx_state = TX_IDLE;
+		return;
+	}
+
+	if(channel != CH_IDLE){
+		tim5->DIER &= ~((1<<TIM_CC1IE)|(1<<TIM_CC2IE));
+		stats.deferrals++;
+		tx_state = TX_DEFER;
+		return;
+	}
+
+	uint32_t now = tim5->CNT;
+	tim5->CCR1 = now + half_bit;
+	tim5->CCR2 = now + (half_bit>>1);
+	REG_WRITE(&tim5->SR, ~((1<<TIM_CC1IF)|(1<<TIM_CC2IF)));
+	start_frame();
+	tim5->DIER |= (1<<TIM_CC1IE)|(1<<TIM_CC2IE);
+}
+
+/*
+ * Loads the frame at the head of the queue and programs its first half
+ * bit.
+ */
+static void start_frame(){
+	PacketBuf* buf = tx_slots[tx_get & TX_SLOT_MASK];
+	manchester_encoder_start(&encoder, pbuf_data(buf), buf->length);
+	line_level = MANCHESTER_IDLE_LEVEL;
+	set_next_level(manchester_encoder_next(&encoder));
+	channel = CH_BUSY;
+	tx_state = TX_SENDING;
+}
+
+/*
+ * Cuts the frame off, releases the line and schedules a retry after a
+ * random number of slots in [0, 2^attempts). The window stops growing
+ * at 2^NIC_BACKOFF_MAX_EXP and the frame is dropped after
+ * NIC_MAX_ATTEMPTS collisions.
+ */
+static void collision(){
+	tim5->CCMR1 = (tim5->CCMR1 & ~(0b111<<4)) | (OCM_FORCE_ACTIVE<<4);
+	tim5->DIER &= ~(1<<TIM_CC2IE);
+	channel = CH_COLLISION;
+	stats.collisions++;
+
+	uint32_t wait = NIC_GAP_BITS*2*half_bit;
+	if(++attempts >= NIC_MAX_ATTEMPTS){
+		tx_release();
+		stats.tx_aborted++;
+		attempts = 0;
+	}else{
+		uint32_t exp = attempts < NIC_BACKOFF_MAX_EXP ? attempts : NIC_BACKOFF_MAX_EXP;
+		uint32_t slots = backoff_random() & ((1<<exp)-1);
+		wait += slots*NIC_SLOT_BITS*2*half_bit;
+	}
+
+	tim5->CCR1 = tim5->CNT + wait;
+	REG_WRITE(&tim5->SR, ~(1<<TIM_CC1IF));
+	tx_state = TX_BACKOFF;
+}
+
+/*
+ * Frees the frame at the head of the queue and removes it.
+ */
+static void tx_release(){
+	uint32_t g = tx_get;
+	pbuf_free(tx_slots[g & TX_SLOT_MASK]);
+	__atomic_store_n(&tx_get, g+1, __ATOMIC_RELEASE);
+}
+
+/*
+ * xorshift32, enough to spread nodes across backoff slots
+ */
+static uint32_t backoff_random(){
+	uint32_t x = random_state;
+	x ^= x<<13;
+	x ^= x>>17;
+	x ^= x<<5;
+	random_state = x;
+	return x;
+}
+
+void TIM5_IRQHandler(void){
+	PROF_ISR_SCOPE(PROBE_NIC_TX_ISR);
+	uint32_t sr = tim5->SR & tim5->DIER;
+
+	//a quarter bit into a half bit: the line should match what is driven
+	if(sr & (1<<TIM_CC2IF)){
+		REG_WRITE(&tim5->SR, ~(1<<TIM_CC2IF));
+		uint32_t line = (rx_port->IDR >> NIC_RX_PIN) & 1;
+		if(tx_state == TX_SENDING && line_level && !line){
+			collision();
+			return;
+		}
+	}
+
+	if(!(sr & (1<<TIM_CC1IF))){
+		return;
+	}
+	REG_WRITE(&tim5->SR, ~(1<<TIM_CC1IF));
+
+	if(tx_state == TX_SENDING){
+		uint32_t match = tim5->CCR1;
+		line_level = next_level;
+		tim5->CCR2 = match + (half_bit>>1);
+		tim5->CCR1 = match + half_bit;
+
+		int level = manchester_encoder_next(&encoder);
+		if(level >= 0){
+			set_next_level(level);
+			return;
+		}
+
+		//frame done, return to idle at the end of the last half bit
+		set_next_level(MANCHESTER_IDLE_LEVEL);
+		tx_release();
+		stats.frames_sent++;
+		attempts = 0;
+		tim5->DIER &= ~(1<<TIM_CC2IE);
+		tx_state = TX_LAST;
+		return;
+	}
+
+	if(tx_state == TX_LAST){
+		//the line is back at idle, hold off for the inter frame gap
+		tim5->CCR1 += NIC_GAP_BITS*2*half_bit;
+		tx_state = TX_GAP;
+		return;
+	}
+
+	//end of the gap or the backoff
+	try_start();
+}
+
+/*
+ * Sets up PB6 as TIM4_CH1 capturing both edges and channel 2 as the
+ * idle timeout.
+ */
+static void rx_init(){
+	idle_ticks = half_bit*3;
+
+	enable_clock(NIC_RX_PORT);
+	set_pin_mode(NIC_RX_PORT, NIC_RX_PIN, ALTFUNC);
+	set_alt_func(NIC_RX_PORT, NIC_RX_PIN, NIC_RX_AF);
+	set_pin_PUPDR(NIC_RX_PORT, NIC_RX_PIN, PULLUP);
+
+	//enable clock for TIM4
+	*(RCC_APB1ENR) |= 1<<APB1ENR_TIM4_F;
+
+	tim4->CR1 = 0;
+	tim4->PSC = 0;
+	tim4->ARR = 0xFFFF;
+	tim4->CCMR1 = (0b01<<0) | (0b0010<<4);	//CC1 input on TI1, filter of 4 samples, CC2 frozen
+	tim4->CCER = (1<<0) | (1<<1) | (1<<3);	//capture enable, both edges
+	tim4->EGR = 1<<TIM_UG;
+	REG_WRITE(&tim4->SR, 0);
+
+	rx_put = rx_get = 0;
+	rx_arm();
+
+	tim4->DIER = 1<<TIM_CC1IE;
+	tim4->CR1 = 1<<TIM_CEN;
+	*(NVIC_ISER0) = 1<<NIC_TIM4_IRQ;
+}
+
+/*
+ * Points the decoder at a packet buffer. A buffer that was not used by
+ * the last frame is kept, otherwise one is taken from the pool if the
+ * ring has room. With no buffer the frame is decoded into rx_discard.
+ */
+static void rx_arm(){
+	if(rx_buf == NULL && (rx_put - __atomic_load_n(&rx_get, __ATOMIC_ACQUIRE)) < NIC_RX_SLOTS){
+		rx_buf = pbuf_alloc();
+	}
+	if(rx_buf != NULL){
+		manchester_decoder_start(&decoder, pbuf_data(rx_buf), NIC_MAX_FRAME);
+	}else{
+		manchester_decoder_start(&decoder, rx_discard, NIC_MAX_FRAME);
+	}
+	rx_header_checked = 0;
+}
+
+/*
+ * Called from the idle timeout. Publishes a good frame and re-arms.
+ */
+static void rx_frame_end(){
+	int length = manchester_decoder_idle(&decoder);
+	if(length > 0){
+		if(rx_buf != NULL){
+			rx_buf->length = length;
+			rx_buf->stamp = rtc_stamp_now();
+			rx_slots[rx_put & RX_SLOT_MASK] = rx_buf;
+			__atomic_store_n(&rx_put, rx_put+1, __ATOMIC_RELEASE);
+			rx_buf = NULL;
+			stats.frames_received++;
+			if(rx_callback){
+				rx_callback();
+			}
+		}else{
+			stats.rx_dropped++;
+		}
+	}else if(length < 0){
+		stats.rx_errors++;
+	}
+	rx_arm();
+}
+
+void TIM4_IRQHandler(void){
+	PROF_ISR_SCOPE(PROBE_NIC_RX_ISR);
+	uint32_t sr = tim4->SR;
+
+	if(sr & (1<<TIM_CC1IF)){
+		uint16_t now = REG_READ(&tim4->CCR1);	//reading CCR1 clears CC1IF
+		if(sr & (1<<TIM_CC1OF)){
+			//an edge was lost, the rest of this frame cannot be trusted
+			REG_WRITE(&tim4->SR, ~(1<<TIM_CC1OF));
+			manchester_decoder_skip(&decoder);
+			rx_header_checked = 0;
+			stats.rx_errors++;
+		}else if(manchester_decoder_edge(&decoder, (uint16_t)(now - last_edge)) < 0){
+			stats.rx_errors++;
+			rx_header_checked = 0;
+		}else if(!rx_header_checked && rx_filter && decoder.state == MD_DATA
+				&& decoder.length == rx_header_length){
+			rx_header_checked = 1;
+			if(!rx_filter(decoder.buf)){
+				manchester_decoder_skip(&decoder);
+				stats.rx_filtered++;
+			}
+		}
+		last_edge = now;
+		if(channel == CH_IDLE){
+			channel = CH_BUSY;
+		}
+
+		tim4->CCR2 = (uint16_t)(now + idle_ticks);
+		REG_WRITE(&tim4->SR, ~(1<<TIM_CC2IF));
+		tim4->DIER |= 1<<TIM_CC2IE;
+		return;
+	}
+
+	if(tim4->SR & (1<<TIM_CC2IF)){
+		REG_WRITE(&tim4->SR, ~(1<<TIM_CC2IF));
+		tim4->DIER &= ~(1<<TIM_CC2IE);
+		rx_frame_end();
+
+		channel = CH_IDLE;
+		if(tx_state == TX_DEFER){
+			try_start();
+		}
+	}
+}
@@ -0,0 +1,143 @@
+/*
+ * pbuf.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ *
+ * Free buffers are the set bits of a single word. Allocation clears the
+ * lowest set bit with a compare and swap and release sets it again, so
+ * both are O(1) and there is no list to suffer from ABA.
+ */
+
+#include "pbuf.h"
+#include <stddef.h>
+
+#define ALL_FREE ((PBUF_COUNT == 32) ? 0xFFFFFFFFu : ((1u<<PBUF_COUNT)-1))
+
+static PacketBuf pool[PBUF_COUNT];
+static volatile uint32_t free_mask = ALL_FREE;
+static PoolStats stats;
+
+/**
+ * Takes a buffer from the pool. The buffer is empty, has one reference
+ * and PBUF_HEADROOM bytes of headroom.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		the buffer, or NULL if the pool is empty
+ */
+PacketBuf* pbuf_alloc(){
+	uint32_t mask = __atomic_load_n(&free_mask, __ATOMIC_RELAXED);
+	uint32_t bit;
+	do{
+		if(mask == 0){
+			__atomic_fetch_add(&stats.alloc_failures, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+		bit = mask & -mask;
+	}while(!__atomic_compare_exchange_n(&free_mask, &mask, mask & ~bit, 1,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	PacketBuf* p = &pool[__builtin_ctz(bit)];
+	p->index = p - pool;
+	p->offset = PBUF_HEADROOM;
+	p->length = 0;
+	p->refs = 1;
+	p->stamp = 0;
+
+	uint32_t used = __atomic_add_fetch(&stats.in_use, 1, __ATOMIC_RELAXED);
+	uint32_t high = __atomic_load_n(&stats.high_water, __ATOMIC_RELAXED);
+	while(used > high && !__atomic_compare_exchange_n(&stats.high_water, &high, used, 1,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED)){}
+
+	return p;
+}
+
+/**
+ * Adds a reference so the buffer can be held by two owners
+ */
+void pbuf_ref(PacketBuf* p){
+	__atomic_add_fetch(&p->refs, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Drops a reference. The buffer returns to the pool with the last one.
+ * Inputs:
+ * 		*p - buffer, NULL is ignored
+ * Outputs:
+ * 		none
+ */
+void pbuf_free(PacketBuf* p){
+	if(p == NULL){
+		return;
+	}
+	if(__atomic_sub_fetch(&p->refs, 1, __ATOMIC_ACQ_REL) == 0){
+		__atomic_sub_fetch(&stats.in_use, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_or(&free_mask, 1u<<p->index, __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * Grows the data at the front into the headroom, for a header.
+ * Inputs:
+ * 		*p - buffer
+ * 		n - bytes to add
+ * Outputs:
+ * 		pointer to the new first byte, or NULL if there is not enough headroom
+ */
+uint8_t* pbuf_push(PacketBuf* p, uint32_t n){
+	if(n > p->offset){
+		return NULL;
+	}
+	p->offset -= n;
+	p->length += n;
+	return pbuf_data(p);
+}
+
+/**
+ * Removes bytes from the front, for stripping a header.
+ * Inputs:
+ * 		*p - buffer
+ * 		n - bytes to remove
+ * Outputs:
+ * 		pointer to the new first byte, or NULL if the data is shorter than n
+ */
+uint8_t* pbuf_pull(PacketBuf* p, uint32_t n){
+	if(n > p->length){
+		return NULL;
+	}
+	p->offset += n;
+	p->length -= n;
+	return pbuf_data(p);
+}
+
+/**
+ * Grows the data at the end.
+ * Inputs:
+ * 		*p - buffer
+ * 		n - bytes to add
+ * Outputs:
+ * 		pointer to the first added byte, or NULL if the buffer is full
+ */
+uint8_t* pbuf_append(PacketBuf* p, uint32_t n){
+	uint32_t end = p->offset + p->length;
+	if(n > PBUF_SIZE - end){
+		return NULL;
+	}
+	p->length += n;
+	return &p->data[end];
+}
+
+/**
+ * Removes up to n bytes from the end, for stripping a trailer
+ */
+void pbuf_trim(PacketBuf* p, uint32_t n){
+	p->length = n < p->length ? p->length - n : 0;
+}
+
+/**
+ * Returns the pool usage counters
+ */
+const PoolStats* pbuf_stats(){
+	return &stats;
+}
@@ -6,10 +6,10 @@
  */
  
 #include <inttypes.h>
-#include <math.h>
 #include "gpio.h"
 #include "timer.h"
 #include "piezo.h"
+#include "irq.h"
 
 typedef struct{
 	uint32_t CR1;
@@ -34,6 +34,37 @@ typedef struct{
 } TIM3;
 
 #define PRESCALAR 16
+#define PIEZO_TICK_HZ (SYSCLK_HZ/(PRESCALAR+1))
+
+/*
+ * TIM3 ticks per output half cycle for a note, rounded. The compare
+ * toggles PB4 once per timer period, so the period is half a cycle.
+ * mhz is the note's frequency in octave 4 in millihertz.
+ */
+#define NOTE_PERIOD(mhz, oct) \
+	((uint16_t)(((uint64_t)PIEZO_TICK_HZ*16000 + ((uint64_t)(mhz)<<(oct))) / (((uint64_t)(mhz)<<(oct))*2)))
+
+//the twelve semitones from C, equal tempered from C4=261.63 Hz
+#define OCTAVE(oct) { \
+	NOTE_PERIOD(261630, oct), NOTE_PERIOD(277187, oct), NOTE_PERIOD(293670, oct), \
+	NOTE_PERIOD(311132, oct), NOTE_PERIOD(329633, oct), NOTE_PERIOD(349234, oct), \
+	NOTE_PERIOD(370001, oct), NOTE_PERIOD(392002, oct), NOTE_PERIOD(415312, oct), \
+	NOTE_PERIOD(440007, oct), NOTE_PERIOD(466172, oct), NOTE_PERIOD(493892, oct)}
+
+//longest period TIM3 can count, its ARR is 16 bits
+#define MAX_PERIOD 65536
+
+_Static_assert((uint64_t)PIEZO_TICK_HZ*16000/(261630ULL*2) < MAX_PERIOD, "C0 does not fit in ARR, raise PRESCALAR");
+_Static_assert(PIEZO_OCTAVES == 9, "note_periods lists octaves 0-8");
+
+//timer periods for every note, worked out by the compiler for PRESCALAR
+static const uint16_t note_periods[PIEZO_OCTAVES][12] = {
+	OCTAVE(0), OCTAVE(1), OCTAVE(2), OCTAVE(3), OCTAVE(4),
+	OCTAVE(5), OCTAVE(6), OCTAVE(7), OCTAVE(8),
+};
+
+//semitones above C for each natural
+static const uint8_t letter_semitones[7] = {0, 2, 4, 5, 7, 9, 11};
 
 static volatile TIM3 *tim3 = (TIM3 *) 0x40000400;
 
@@ -42,7 +73,32 @@ void play_note(const Note *note);
 void play_tone(const Tone *tone);
 void play_note_sequence(const Note *notes, uint32_t length);
 void play_tone_sequence(const Tone *tones, uint32_t length);
-static Tone convert_note(const Note *note);
+int play_tones(const Tone *tones, uint32_t length, PiezoPriority priority, uint8_t loop);
+int play_notes(const Note *notes, uint32_t length, PiezoPriority priority, uint8_t loop);
+void piezo_stop();
+int piezo_busy();
+static uint32_t note_period(const Note *note);
+static uint32_t tone_period(uint32_t frequency);
+static int start(const Tone *tones, const Note *notes, uint32_t length, PiezoPriority priority, uint8_t loop);
+static void next_tone();
+static void step(void* arg);
+static void tone_on(uint32_t period);
+static void tone_off();
+
+//sequence being played, either tones or notes is set
+static const Tone *seqTones;
+static const Note *seqNotes;
+static uint32_t seqLength;
+static uint32_t seqIndex;
+static uint8_t seqLoop;
+static PiezoPriority seqPriority;
+static volatile uint8_t playing;
+static uint8_t inGap;				//the current step is the silence after a tone
+static SoftTimer stepTimer;
+
+//storage for single tones and notes, the caller's copy may go away
+static Tone singleTone;
+static Note singleNote;
 
 /**
  * This function will initialize the piezo buzzer in order to play
@@ -73,99 +129,246 @@ void init_piezo(){
 
 /**
  * This function will play a note specified by the caller of the
- * function. In reality, the note will converted to a tone, and
- * the function to play a tone will be called.
+ * function. The note is copied and played in the background, so the
+ * caller does not wait for it. It is dropped if an alarm is sounding.
  * Inputs:
  * 		*note - pointer to the note to be played
  * Outputs:
  * 		none
  */
 void play_note(const Note *note){
-	Tone temp = convert_note(note);
-	play_tone(&temp);
+	uint32_t primask = irq_save();
+	if(!playing || seqPriority <= PIEZO_BEEP){
+		piezo_stop();
+		singleNote = *note;
+		start(NULL, &singleNote, 1, PIEZO_BEEP, 0);
+	}
+	irq_restore(primask);
 }
 
 /**
  * This function will play a tone by causing the buzzer to vibrate
- * at the specified frequency for the specified amount of time.
- * To set the frequency, the ARR register must be set, with a
- * duty cycle of half the frequency set in the CCR1 register.
- * CNT is reset before playing the frequency to avoid a pause
- * in sound when the CNT register resets to 0.
+ * at the specified frequency for the specified amount of time. The
+ * tone is copied and played in the background like play_note.
  * Inputs:
  * 		*tone - pointer to the tone to be played
  * Outputs:
  * 		none
  */
 void play_tone(const Tone *tone){
-	tim3->CNT = 0;
-	uint32_t freq = ((1/(tone->frequency))*(1000000));
-	tim3->ARR = freq;
-	tim3->CCR1 = (int)(freq/2);			//set duty cycle in he CCR1
-	tim3->CR1 |= TIM3_ON;				//enable clock
-	delay_ms(tone->duration_ms);		//delay
-	tim3->CR1 &= ~(TIM3_ON);			//turn timer off
+	uint32_t primask = irq_save();
+	if(!playing || seqPriority <= PIEZO_BEEP){
+		piezo_stop();
+		singleTone = *tone;
+		start(&singleTone, NULL, 1, PIEZO_BEEP, 0);
+	}
+	irq_restore(primask);
+}
+
+/**
+ * Starts playing a sequence of tones in the background. Each tone is
+ * followed by PIEZO_GAP_MS of silence. The tones are read as they are
+ * played, so the array must stay valid until the sequence ends or is
+ * stopped.
+ * Inputs:
+ * 		*tones - array of tones
+ * 		length - number of tones
+ * 		priority - a sequence of higher priority is not interrupted
+ * 		loop - nonzero to repeat until stopped
+ * Outputs:
+ * 		0 - the sequence has started, replacing any playing before
+ * 		-1 - a sequence of higher priority is playing
+ */
+int play_tones(const Tone *tones, uint32_t length, PiezoPriority priority, uint8_t loop){
+	return start(tones, NULL, length, priority, loop);
 }
 
 /**
- * This is a helper function that performs the task of translating
- * a Note type to a Tone type. This function is based on
- * determining the number of steps the note is from note C4. Then
- * the frequency of C4 is multiplied by 2 to the power of steps/12.
- * To determine the number of steps a note is from C4, a piecewise
- * function is used since F sharp/E flat does not exist.
+ * Starts playing a sequence of notes in the background, as play_tones
+ * Inputs:
+ * 		*notes - array of notes
+ * 		length - number of notes
+ * 		priority - a sequence of higher priority is not interrupted
+ * 		loop - nonzero to repeat until stopped
+ * Outputs:
+ * 		0 - the sequence has started, replacing any playing before
+ * 		-1 - a sequence of higher priority is playing
+ */
+int play_notes(const Note *notes, uint32_t length, PiezoPriority priority, uint8_t loop){
+	return start(NULL, notes, length, priority, loop);
+}
+
+/**
+ * Silences the buzzer and drops the sequence being played, whatever its priority
+ */
+void piezo_stop(){
+	uint32_t primask = irq_save();
+	timer_stop(&stepTimer);
+	tone_off();
+	playing = 0;
+	irq_restore(primask);
+}
+
+/**
+ * Returns nonzero while a sequence is playing
+ */
+int piezo_busy(){
+	return playing;
+}
+
+/**
+ * This is a helper function that looks up the timer period of a note.
+ * The accidental may carry the note into the next or previous octave,
+ * as with B sharp or C flat.
  * Inputs:
  * 		*note - pointer to a note to be converted
  * Outputs:
- * 		Tone - the converted note in a Tone representation
- */
-static Tone convert_note(const Note *note){
-	//using a base of C4=261.63
-	double freq;
-	if(note->letter!=REST){
-		int octaveOffset = ((note->octave)-4);
-		int letterOffset = ((note->letter) - C);
-		double steps;
-		if(letterOffset<=2){
-			steps = ((letterOffset*2)+(12*octaveOffset))+(note->accidental);
-		}else{
-			steps = (((letterOffset*2)-1)+(12*octaveOffset))+(note->accidental);
-		}
-		freq = 261.63*pow((double)2,(steps/12));
-	}else{
-		freq = 0;
+ * 		uint32_t - TIM3 ticks per half cycle, 0 for a rest or a note out of range
+ */
+static uint32_t note_period(const Note *note){
+	if(note->letter >= REST){
+		return 0;
 	}
+	int semitone = letter_semitones[note->letter] + note->accidental;
+	int octave = note->octave;
+	if(semitone < 0){
+		semitone += 12;
+		octave--;
+	}else if(semitone >= 12){
+		semitone -= 12;
+		octave++;
+	}
+	if(octave < 0 || octave >= PIEZO_OCTAVES){
+		return 0;
+	}
+	return note_periods[octave][semitone];
+}
 
-	Tone tone = {freq,note->duration_ms};
-	return tone;
+/**
+ * This is a helper function that works out the timer period for any
+ * frequency with one integer divide.
+ * Inputs:
+ * 		frequency - Hz in Q8
+ * Outputs:
+ * 		uint32_t - TIM3 ticks per half cycle, 0 for silence or a frequency out of range
+ */
+static uint32_t tone_period(uint32_t frequency){
+	if(frequency == 0){
+		return 0;
+	}
+	uint32_t period = (uint32_t)((((uint64_t)PIEZO_TICK_HZ<<8) + frequency)/((uint64_t)frequency*2));
+	return (period >= 1 && period <= MAX_PERIOD) ? period : 0;
 }
 
 /**
  * This function accepts a array of tones and plays the sequence of
- * tones with a delay of 5 ms between tones to keep them distinct.
+ * tones with a delay of 5 ms between tones to keep them distinct. It
+ * returns at once, the array must stay valid until the sequence ends.
  * Inputs:
  * 		*tones - a pointer to an array of Tones
  * Outputs:
  * 		none
  */
 void play_tone_sequence(const Tone *tones, uint32_t length){
-	for(int i=0; i<length; i++){
-		play_tone(&tones[i]);
-		delay_ms(5);
-	}
+	play_tones(tones, length, PIEZO_BEEP, 0);
 }
 
 /**
  * This function accepts a array of notes and plays the sequence of
- * notes with a delay of 5 ms between notes to keep them distinct.
+ * notes with a delay of 5 ms between notes to keep them distinct. It
+ * returns at once, the array must stay valid until the sequence ends.
  * Inputs:
  * 		*notes - a pointer to an array of Notes
  * Outputs:
  * 		none
  */
 void play_note_sequence(const Note *notes, uint32_t length){
-	for(int i=0; i<length; i++){
-		play_note(&notes[i]);
-		delay_ms(5);
+	play_notes(notes, length, PIEZO_BEEP, 0);
+}
+
+/*
+ * Replaces the playing sequence unless it has a higher priority
+ */
+static int start(const Tone *tones, const Note *notes, uint32_t length, PiezoPriority priority, uint8_t loop){
+	uint32_t primask = irq_save();
+	if(playing && seqPriority > priority){
+		irq_restore(primask);
+		return -1;
+	}
+	timer_stop(&stepTimer);
+	seqTones = tones;
+	seqNotes = notes;
+	seqLength = length;
+	seqIndex = 0;
+	seqLoop = loop;
+	seqPriority = priority;
+	playing = 1;
+	next_tone();
+	irq_restore(primask);
+	return 0;
+}
+
+/*
+ * Sounds the next tone of the sequence and schedules its end. Runs with
+ * interrupts off or from the timer wheel.
+ */
+static void next_tone(){
+	if(seqIndex >= seqLength){
+		if(!seqLoop || seqLength == 0){
+			tone_off();
+			playing = 0;
+			return;
+		}
+		seqIndex = 0;
 	}
+
+	uint32_t period;
+	float duration_ms;
+	if(seqNotes){
+		period = note_period(&seqNotes[seqIndex]);
+		duration_ms = seqNotes[seqIndex].duration_ms;
+	}else{
+		period = tone_period(seqTones[seqIndex].frequency);
+		duration_ms = seqTones[seqIndex].duration_ms;
+	}
+	seqIndex++;
+	tone_on(period);
+	inGap = 0;
+
+	uint32_t duration = duration_ms > 1 ? (uint32_t)duration_ms : 1;
+	timer_start(&stepTimer, duration, 0, step, NULL);
+}
+
+/*
+ * Timer wheel callback, ends a tone with a gap or ends the gap with the next tone
+ */
+static void step(void* arg){
+	if(inGap){
+		next_tone();
+		return;
+	}
+	tone_off();
+	inGap = 1;
+	timer_start(&stepTimer, PIEZO_GAP_MS, 0, step, NULL);
+}
+
+/*
+ * To set the frequency, the ARR register must be set, with a duty
+ * cycle of half the frequency set in the CCR1 register. CNT is reset
+ * before playing the frequency to avoid a pause in sound when the CNT
+ * register resets to 0. A period of 0 is a rest.
+ */
+static void tone_on(uint32_t period){
+	if(period == 0){
+		tone_off();
+		return;
+	}
+	tim3->CNT = 0;
+	tim3->ARR = period-1;
+	tim3->CCR1 = period/2;				//set duty cycle in he CCR1
+	tim3->CR1 |= TIM3_ON;				//enable clock
+}
+
+static void tone_off(){
+	tim3->CR1 &= ~(TIM3_ON);			//turn timer off
 }
@@ -0,0 +1,72 @@
+/*
+ * prof.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ */
+
+#include "prof.h"
+
+#if PROFILE_ENABLED
+
+#include "irq.h"
+#include <stdio.h>
+
+static const char* const names[PROBE_COUNT] = {
+	"adc_isr",
+	"key_scan",
+	"nic_tx_isr",
+	"nic_rx_isr",
+	"lcd_execute",
+	"lcd_pump",
+};
+
+ProfData prof_data = {
+	.magic = PROF_MAGIC,
+	.probes = {[0 ... PROBE_COUNT-1] = {.min = UINT32_MAX}},
+};
+
+/**
+ * Clears every probe and the nesting depth high water mark
+ */
+void prof_reset(){
+	uint32_t primask = irq_save();
+	for(uint32_t i=0;i<PROBE_COUNT;i++){
+		prof_data.probes[i] = (ProbeStats){0};
+		prof_data.probes[i].min = UINT32_MAX;
+	}
+	prof_data.isr_depth_max = prof_data.isr_depth;
+	irq_restore(primask);
+}
+
+/**
+ * Prints every probe that has run on stdout, which is USART2, one line per probe with
+ * count, min, mean and max in cycles followed by the histogram. Each
+ * probe is copied with interrupts masked so its line is consistent.
+ * Inputs:
+ * 		none
+ * Outputs:
+ * 		none
+ */
+void prof_dump(){
+	printf("probe count min mean max | log2 buckets, isr depth max %lu\r\n",
+			(unsigned long)prof_data.isr_depth_max);
+
+	for(uint32_t i=0;i<PROBE_COUNT;i++){
+		uint32_t primask = irq_save();
+		ProbeStats p = prof_data.probes[i];
+		irq_restore(primask);
+		if(p.count == 0){
+			continue;
+		}
+
+		printf("%s %lu %lu %lu %lu |", names[i], (unsigned long)p.count, (unsigned long)p.min,
+				(unsigned long)(p.total/p.count), (unsigned long)p.max);
+		for(uint32_t b=0;b<PROF_BUCKETS;b++){
+			printf(" %lu", (unsigned long)p.buckets[b]);
+		}
+		printf("\r\n");
+	}
+}
+
+#endif /* PROFILE_ENABLED */
@@ -5,11 +5,28 @@
  *      Author: Mitchell Larson
  */
 #include "ringbuffer.h"
+#include <string.h>
 
 void put(volatile RingBuffer* buffer, uint8_t element);
 uint8_t get(volatile RingBuffer* buffer);
 int hasSpace(volatile RingBuffer* buffer);
 int hasElement(volatile RingBuffer* buffer);
+int rb_try_put(volatile RingBuffer* buffer, uint8_t element);
+int rb_try_get(volatile RingBuffer* buffer, uint8_t* element);
+unsigned int rb_put_n(volatile RingBuffer* buffer, const uint8_t* src, unsigned int n);
+unsigned int rb_get_n(volatile RingBuffer* buffer, uint8_t* dst, unsigned int n);
+unsigned int rb_count(volatile RingBuffer* buffer);
+unsigned int rb_space(volatile RingBuffer* buffer);
+
+/*
+ * The producer publishes put with release semantics after the data is
+ * written, and the consumer publishes get with release semantics after
+ * the data is read. Each side loads the other's index with acquire
+ * semantics so the slot contents are never read or overwritten early.
+ */
+#define LOAD_ACQ(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define LOAD_OWN(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STORE_REL(x,v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
 
 /**
  * This function adds an element to the buffer. If there
@@ -22,18 +39,8 @@ int hasElement(volatile RingBuffer* buffer);
  * 		none
  */
 void put(volatile RingBuffer* buffer, uint8_t element){
-		//block until the buffer has space
-		while(!hasSpace(buffer)){};
-
-		//add the element to the buffer.
-		buffer->buffer[buffer->put]=element;
-
-		//increment the put location in the buffer
-		if(((buffer->put)+1)==BUF_SIZE){
-			buffer->put=0;
-		}else{
-			(buffer->put)++;
-		}
+	//block until the buffer has space
+	while(!rb_try_put(buffer,element)){};
 }
 
 /**
@@ -46,18 +53,8 @@ void put(volatile RingBuffer* buffer, uint8_t element){
  * 		char - element contained in the buffer.
  */
 uint8_t get(volatile RingBuffer* buffer){
-	while(!hasElement(buffer)){};
-	
-	//retrieve element
-	uint8_t element = buffer->buffer[buffer->get];
-	
-	//increment the get location in the buffer
-	if(((buffer->get)+1)==BUF_SIZE){
-		buffer->get=0;
-	}else{
-		(buffer->get)++;
-	}
-
+	uint8_t element;
+	while(!rb_try_get(buffer,&element)){};
 	return element;
 }
 
@@ -70,19 +67,7 @@ uint8_t get(volatile RingBuffer* buffer){
  * 		int - 0-no room, non-zero-room for an element
  */
 int hasSpace(volatile RingBuffer* buffer){
-	if(((buffer->put)+1)== BUF_SIZE){	//if put is at the end of the buffer
-		if((buffer->get)==0){
-			return 0;
-		}else{
-			return 1;
-		}
-	}else{
-		if(((buffer->put)+1)==buffer->get){
-			return 0;
-		}else{
-			return 1;
-		}
-	}	
+	return rb_space(buffer) != 0;
 }
 
 /**
@@ -94,9 +79,128 @@ int hasSpace(volatile RingBuffer* buffer){
  * 		0-no elements, non-zero- at least 1 element.
  */
 int hasElement(volatile RingBuffer* buffer){
-	if(buffer->put==buffer->get){	//if put is at the end of the buffer
+	return rb_count(buffer) != 0;
+}
+
+/**
+ * This function adds an element to the buffer without blocking.
+ * Inputs:
+ * 		*buffer - pointer to buffer to add element to
+ * 		element - character to add to buffer
+ * Outputs:
+ * 		int - 1 if the element was added, 0 if the buffer was full
+ */
+int rb_try_put(volatile RingBuffer* buffer, uint8_t element){
+	unsigned int p = LOAD_OWN(buffer->put);
+	if((p - LOAD_ACQ(buffer->get)) >= BUF_SIZE){
+		return 0;
+	}
+
+	buffer->buffer[p & RB_MASK] = element;
+	STORE_REL(buffer->put, p+1);
+	return 1;
+}
+
+/**
+ * This function removes an element from the buffer without blocking.
+ * Inputs:
+ * 		*buffer - pointer to the buffer to retrieve a char from
+ * 		*element - location to store the element in
+ * Outputs:
+ * 		int - 1 if an element was removed, 0 if the buffer was empty
+ */
+int rb_try_get(volatile RingBuffer* buffer, uint8_t* element){
+	unsigned int g = LOAD_OWN(buffer->get);
+	if(LOAD_ACQ(buffer->put) == g){
 		return 0;
-	}else{
-		return 1;
 	}
+
+	*element = buffer->buffer[g & RB_MASK];
+	STORE_REL(buffer->get, g+1);
+	return 1;
+}
+
+/**
+ * This function copies up to n bytes into the buffer. The copy is done
+ * in at most two memcpy calls (before and after the wrap point) and the
+ * put index is published once for the whole block.
+ * Inputs:
+ * 		*buffer - pointer to buffer to add elements to
+ * 		*src - bytes to add
+ * 		n - number of bytes to add
+ * Outputs:
+ * 		unsigned int - number of bytes actually added
+ */
+unsigned int rb_put_n(volatile RingBuffer* buffer, const uint8_t* src, unsigned int n){
+	unsigned int p = LOAD_OWN(buffer->put);
+	unsigned int space = BUF_SIZE - (p - LOAD_ACQ(buffer->get));
+	if(n > space){
+		n = space;
+	}
+
+	unsigned int start = p & RB_MASK;
+	unsigned int first = BUF_SIZE - start;
+	if(first > n){
+		first = n;
+	}
+
+	//the indexes carry the ordering, so the data copy can ignore volatile
+	uint8_t* data = (uint8_t*)buffer->buffer;
+	memcpy(&data[start], src, first);
+	memcpy(data, src+first, n-first);
+
+	STORE_REL(buffer->put, p+n);
+	return n;
+}
+
+/**
+ * This function copies up to n bytes out of the buffer in FIFO order.
+ * Inputs:
+ * 		*buffer - pointer to the buffer to retrieve bytes from
+ * 		*dst - location to copy bytes to
+ * 		n - maximum number of bytes to copy
+ * Outputs:
+ * 		unsigned int - number of bytes actually copied
+ */
+unsigned int rb_get_n(volatile RingBuffer* buffer, uint8_t* dst, unsigned int n){
+	unsigned int g = LOAD_OWN(buffer->get);
+	unsigned int count = LOAD_ACQ(buffer->put) - g;
+	if(n > count){
+		n = count;
+	}
+
+	unsigned int start = g & RB_MASK;
+	unsigned int first = BUF_SIZE - start;
+	if(first > n){
+		first = n;
+	}
+
+	const uint8_t* data = (const uint8_t*)buffer->buffer;
+	memcpy(dst, &data[start], first);
+	memcpy(dst+first, data, n-first);
+
+	STORE_REL(buffer->get, g+n);
+	return n;
+}
+
+/**
+ * Returns the number of elements currently in the buffer.
+ * Inputs:
+ * 		*buffer - buffer to check
+ * Outputs:
+ * 		unsigned int - elements available to get
+ */
+unsigned int rb_count(volatile RingBuffer* buffer){
+	return LOAD_ACQ(buffer->put) - LOAD_ACQ(buffer->get);
+}
+
+/**
+ * Returns the number of free slots in the buffer.
+ * Inputs:
+ * 		*buffer - buffer to check
+ * Outputs:
+ * 		unsigned int - elements that can be put without blocking
+ */
+unsigned int rb_space(volatile RingBuffer* buffer){
+	return BUF_SIZE - rb_count(buffer);
 }
@@ -48,6 +48,7 @@
  * 	1. Modified _read function to get correct behavior of fgets
  * 	2. Commented out the _sbrk function since it will be redefined in sysmem.c
  * 	3. Commented out lines from original implementation
+ * 	4. _write queues whole blocks to the DMA driven usart2 driver
  */
 
 /* Includes */
@@ -117,12 +118,13 @@ int _read (int file, char *ptr, int len)
 
 int _write(int file, char *ptr, int len)
 {
-	int DataIdx;
+	int sent = 0;
 
-	for (DataIdx = 0; DataIdx < len; DataIdx++)
+	// Queue as much as fits, only waiting when the driver's TX queue is full
+	while (sent < len)
 	{
 		//__io_putchar(*ptr++);
-		usart2_putch(*ptr++);
+		sent += usart2_write(ptr + sent, len - sent);
 	}
 	return len;
 }
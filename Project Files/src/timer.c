@@ -1,59 +1,209 @@
+/*
+ * timer.c
+ *
+ *  Created on: Jan. 5 2017
+ *      Author: Mitchell Larson
+ *
+ * Time base for the system. Delays and timestamps come from the DWT
+ * cycle counter, which runs freely at the core clock. SysTick raises a
+ * 1 ms tick that extends the cycle counter to 64 bits and drives a
+ * hashed timer wheel for scheduled callbacks.
+ */
+
 #include "timer.h"
+#include "irq.h"
+#include "mmio.h"
+
+#define WHEEL_MASK (TIMER_WHEEL_SLOTS-1)
+
+_Static_assert((TIMER_WHEEL_SLOTS & WHEEL_MASK) == 0, "TIMER_WHEEL_SLOTS must be a power of two");
+
+static volatile uint32_t ticks;
+static volatile uint32_t cycles_hi;
+static volatile uint32_t cycles_last;
+static SoftTimer* wheel[TIMER_WHEEL_SLOTS];
+
+static void cycle_counter_on();
+static void wheel_insert(SoftTimer* timer);
+static void wheel_remove(SoftTimer* timer);
+
+/*
+ *	Starts the cycle counter and a 1 ms SysTick interrupt. The delay
+ *	functions work before this is called, timestamps above 32 bits and
+ *	software timers do not.
+ *	inputs:
+ *			none
+ *	outputs:
+ *			none
+*/
+void timer_init(){
+	cycle_counter_on();
+
+	REG_WRITE(STK_CTRL, 0);
+	*(STK_LOAD) = (SYSCLK_HZ/1000)-1;	//1ms
+	REG_WRITE(STK_VAL, 0);
+	REG_WRITE(STK_CTRL, (1<<STK_ENABLE_F) | (1<<STK_TICKINT_F) | (1<<STK_CLKSOURCE_F));
+}
 
 /*
  *	Delay the processor by t_ms by
- *	polling the Systick timer.
+ *	polling the cycle counter.
  *	inputs:
  *			t_ms - number of miliseconds to delay
  *	outputs:
  *			none
 */
 void delay_ms(uint32_t t_ms){
-	//ensure counter is off
-	*(STK_CTRL) &= ~(1<<STK_ENABLE_F);
-	//t_ms time 
+	//one millisecond at a time so long delays cannot overflow the cycle count
 	for(uint32_t i=0; i<t_ms; i++){
-		
-	
-		//load 16000 into STK_LOAD
-		*(STK_LOAD) = 16000;//1ms
-		
-		//turn on counter
-		*(STK_CTRL) |= ((1<<STK_ENABLE_F) | (1<<STK_CLKSOURCE_F));
-		
-		//wait for flag to go to 16
-		while((*STK_CTRL & (1<<STK_CNTFLAG_F)) != (1<<STK_CNTFLAG_F)){}
-		
-		//turn off counter
-		*(STK_CTRL) &= ~(1<<STK_ENABLE_F);
+		delay_us(1000);
 	}
 }
 
 /*
  *	Delay the processor by t_us by
- *	polling the Systick timer.
+ *	polling the cycle counter. The start is sampled once so loop
+ *	overhead does not accumulate.
  *	inputs:
- *			t_us - number of miliseconds to delay
+ *			t_us - number of microseconds to delay
  *	outputs:
  *			none
 */
 void delay_us(uint32_t t_us){
-	//ensure counter is off
-	*(STK_CTRL) &= ~(1<<STK_ENABLE_F);
-	//t_ms time 
-	for(uint32_t i=0; i<t_us; i++){
-		
-	
-		//load 16 into STK_LOAD
-		*(STK_LOAD) = 16;//1us
-		
-		//turn on counter
-		*(STK_CTRL) |= ((1<<STK_ENABLE_F) | (1<<STK_CLKSOURCE_F));
-		
-		//wait for flag to go to 16
-		while((*STK_CTRL & (1<<STK_CNTFLAG_F)) != (1<<STK_CNTFLAG_F)){}
-		
-		//turn off counter
-		*(STK_CTRL) &= ~(1<<STK_ENABLE_F);
+	cycle_counter_on();
+	uint32_t start = REG_READ(DWT_CYCCNT);
+	uint32_t cycles = t_us*CYCLES_PER_US;
+	while((REG_READ(DWT_CYCCNT) - start) < cycles){}
+}
+
+/*
+ *	Returns the number of core cycles since the cycle counter started.
+ *	The 32 bit counter wraps every 268 s at 16 MHz. Wraps are detected
+ *	here and at least once per SysTick.
+ *	inputs:
+ *			none
+ *	outputs:
+ *			64 bit cycle count
+*/
+uint64_t now_cycles(){
+	uint32_t primask = irq_save();
+	uint32_t lo = REG_READ(DWT_CYCCNT);
+	if(lo < cycles_last){
+		cycles_hi++;
+	}
+	cycles_last = lo;
+	uint32_t hi = cycles_hi;
+	irq_restore(primask);
+
+	return ((uint64_t)hi<<32) | lo;
+}
+
+/*
+ *	Returns microseconds since the cycle counter started.
+*/
+uint64_t now_us(){
+	return now_cycles()/CYCLES_PER_US;
+}
+
+/*
+ *	Returns milliseconds since timer_init, counted by SysTick.
+*/
+uint32_t now_ms(){
+	return ticks;
+}
+
+/*
+ *	Schedules a callback. A timer that is already running is
+ *	rescheduled.
+ *	inputs:
+ *			timer - storage for the timer
+ *			delay_ms - ms until the first call, 0 fires on the next tick
+ *			period_ms - ms between later calls, 0 for one shot
+ *			callback - function called from the SysTick interrupt
+ *			arg - passed to the callback
+ *	outputs:
+ *			none
+*/
+void timer_start(SoftTimer* timer, uint32_t delay_ms, uint32_t period_ms,
+		timer_callback callback, void* arg){
+	uint32_t primask = irq_save();
+	if(timer->active){
+		wheel_remove(timer);
+	}
+	timer->callback = callback;
+	timer->arg = arg;
+	timer->period = period_ms;
+	timer->expires = ticks + (delay_ms ? delay_ms : 1);
+	wheel_insert(timer);
+	irq_restore(primask);
+}
+
+/*
+ *	Cancels a timer. Safe to call on a timer that is not running.
+*/
+void timer_stop(SoftTimer* timer){
+	uint32_t primask = irq_save();
+	if(timer->active){
+		wheel_remove(timer);
+	}
+	irq_restore(primask);
+}
+
+static void cycle_counter_on(){
+	if((REG_READ(DWT_CTRL) & (1<<DWT_CYCCNTENA_F)) == 0){
+		*(DEMCR) |= (1<<DEMCR_TRCENA_F);
+		REG_WRITE(DWT_CYCCNT, 0);
+		REG_SET(DWT_CTRL, 1<<DWT_CYCCNTENA_F);
+	}
+}
+
+static void wheel_insert(SoftTimer* timer){
+	SoftTimer** slot = &wheel[timer->expires & WHEEL_MASK];
+	timer->next = *slot;
+	*slot = timer;
+	timer->active = 1;
+}
+
+static void wheel_remove(SoftTimer* timer){
+	SoftTimer** link = &wheel[timer->expires & WHEEL_MASK];
+	while(*link){
+		if(*link == timer){
+			*link = timer->next;
+			break;
+		}
+		link = &(*link)->next;
+	}
+	timer->active = 0;
+}
+
+void SysTick_Handler(void){
+	uint32_t now = ++ticks;
+	now_cycles();		//keep the 64 bit cycle count in step
+
+	//take the due timers off the slot one at a time and look again from
+	//the head after each callback, which may start or stop any timer.
+	//A periodic timer goes back with a later expiry, so it is not seen
+	//twice even when it lands in the same slot.
+	for(;;){
+		SoftTimer* timer = 0;
+		SoftTimer** link = &wheel[now & WHEEL_MASK];
+		while(*link){
+			if((*link)->expires == now){
+				timer = *link;
+				*link = timer->next;
+				break;
+			}
+			link = &(*link)->next;
+		}
+		if(timer == 0){
+			break;
+		}
+
+		timer->active = 0;
+		if(timer->period){
+			timer->expires = now + timer->period;
+			wheel_insert(timer);
+		}
+		timer->callback(timer->arg);
 	}
 }
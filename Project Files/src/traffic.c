@@ -0,0 +1,190 @@
+/*
+ * traffic.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ */
+
+#include "traffic.h"
+
+_Static_assert(sizeof(TrafficStats) == TRAFFIC_BYTES, "TRAFFIC_BYTES does not match TrafficStats");
+
+static void ring_init(TrafficRing* ring, uint32_t* counts, uint16_t size, uint32_t period);
+static void ring_advance(TrafficRing* ring, uint32_t period);
+static void ring_add(TrafficRing* ring, uint32_t period, uint32_t count);
+static void ring_rescan(TrafficRing* ring);
+static void ring_load(TrafficRing* ring, uint32_t latest, const uint32_t* counts);
+
+/**
+ * Clears a statistics store and starts its clock.
+ * Inputs:
+ * 		*stats - store to clear
+ * 		minute - current minute count
+ * Outputs:
+ * 		none
+ */
+void traffic_init(TrafficStats* stats, uint32_t minute){
+	ring_init(&stats->minutes, stats->minute_counts, TRAFFIC_MINUTES, minute);
+	ring_init(&stats->hours, stats->hour_counts, TRAFFIC_HOURS, minute/60);
+	ring_init(&stats->days, stats->day_counts, TRAFFIC_DAYS, minute/(24*60));
+	stats->all_time = 0;
+}
+
+/**
+ * Moves the clock forward, clearing the buckets it passes, so the window
+ * totals drop old traffic even while no breaks come in. A time earlier
+ * than the newest bucket is ignored.
+ * Inputs:
+ * 		*stats - store to update
+ * 		minute - current minute count
+ * Outputs:
+ * 		none
+ */
+void traffic_advance(TrafficStats* stats, uint32_t minute){
+	ring_advance(&stats->minutes, minute);
+	ring_advance(&stats->hours, minute/60);
+	ring_advance(&stats->days, minute/(24*60));
+}
+
+/**
+ * Counts breaks at a point in time. Breaks older than the newest bucket
+ * go into the newest bucket.
+ * Inputs:
+ * 		*stats - store to update
+ * 		minute - minute count when the breaks happened
+ * 		count - number of breaks
+ * Outputs:
+ * 		none
+ */
+void traffic_record(TrafficStats* stats, uint32_t minute, uint32_t count){
+	ring_add(&stats->minutes, minute, count);
+	ring_add(&stats->hours, minute/60, count);
+	ring_add(&stats->days, minute/(24*60), count);
+	stats->all_time += count;
+}
+
+/**
+ * Returns the hour of the day, 0-23, with the most breaks in the last
+ * 24 hours. Ties go to the earliest hour of the day.
+ */
+uint32_t traffic_busiest_hour(const TrafficStats* stats){
+	return stats->hours.max_index;
+}
+
+/**
+ * Returns the average count per bucket over a ring's window, in tenths,
+ * e.g. breaks per minute over the last hour from stats->minutes.
+ */
+uint32_t traffic_average_x10(const TrafficRing* ring){
+	return (ring->total*10 + ring->size/2)/ring->size;
+}
+
+/**
+ * Copies the state worth keeping across a reset. The minute ring is left
+ * out, it covers less time than a reset usually takes.
+ * Inputs:
+ * 		*stats - store to save
+ * 		*words - TRAFFIC_SNAPSHOT_WORDS words
+ * Outputs:
+ * 		none
+ */
+void traffic_save(const TrafficStats* stats, uint32_t* words){
+	*words++ = stats->minutes.latest;
+	*words++ = stats->hours.latest;
+	for(uint32_t i=0;i<TRAFFIC_HOURS;i++){
+		*words++ = stats->hour_counts[i];
+	}
+	*words++ = stats->days.latest;
+	for(uint32_t i=0;i<TRAFFIC_DAYS;i++){
+		*words++ = stats->day_counts[i];
+	}
+	*words = stats->all_time;
+}
+
+/**
+ * Loads a store from traffic_save words. The minute ring starts empty.
+ * traffic_advance afterwards clears what went stale during the reset.
+ * Inputs:
+ * 		*stats - store to load
+ * 		*words - TRAFFIC_SNAPSHOT_WORDS words
+ * Outputs:
+ * 		none
+ */
+void traffic_restore(TrafficStats* stats, const uint32_t* words){
+	traffic_init(stats, words[0]);
+	ring_load(&stats->hours, words[1], &words[2]);
+	ring_load(&stats->days, words[2+TRAFFIC_HOURS], &words[3+TRAFFIC_HOURS]);
+	stats->all_time = words[3+TRAFFIC_HOURS+TRAFFIC_DAYS];
+}
+
+static void ring_init(TrafficRing* ring, uint32_t* counts, uint16_t size, uint32_t period){
+	ring->counts = counts;
+	ring->size = size;
+	ring->latest = period;
+	ring->total = 0;
+	ring->max_count = 0;
+	ring->max_index = 0;
+	for(uint32_t i=0;i<size;i++){
+		counts[i] = 0;
+	}
+}
+
+/*
+ * Clears every bucket between the newest one and period. At most one
+ * lap of the ring is cleared however far the clock jumped.
+ */
+static void ring_advance(TrafficRing* ring, uint32_t period){
+	if((int32_t)(period - ring->latest) <= 0){
+		return;
+	}
+
+	uint32_t steps = period - ring->latest;
+	if(steps > ring->size){
+		steps = ring->size;
+	}
+	int lost_max = 0;
+	for(uint32_t i=1;i<=steps;i++){
+		uint32_t index = (ring->latest + i) % ring->size;
+		ring->total -= ring->counts[index];
+		ring->counts[index] = 0;
+		lost_max |= index == ring->max_index;
+	}
+	ring->latest = period;
+
+	if(lost_max){
+		ring_rescan(ring);
+	}
+}
+
+static void ring_add(TrafficRing* ring, uint32_t period, uint32_t count){
+	ring_advance(ring, period);
+	uint32_t index = ring->latest % ring->size;
+	ring->counts[index] += count;
+	ring->total += count;
+	if(ring->counts[index] > ring->max_count ||
+			(ring->counts[index] == ring->max_count && index < ring->max_index)){
+		ring->max_count = ring->counts[index];
+		ring->max_index = index;
+	}
+}
+
+static void ring_rescan(TrafficRing* ring){
+	ring->max_count = 0;
+	ring->max_index = 0;
+	for(uint32_t i=0;i<ring->size;i++){
+		if(ring->counts[i] > ring->max_count){
+			ring->max_count = ring->counts[i];
+			ring->max_index = i;
+		}
+	}
+}
+
+static void ring_load(TrafficRing* ring, uint32_t latest, const uint32_t* counts){
+	ring->latest = latest;
+	ring->total = 0;
+	for(uint32_t i=0;i<ring->size;i++){
+		ring->counts[i] = counts[i];
+		ring->total += counts[i];
+	}
+	ring_rescan(ring);
+}
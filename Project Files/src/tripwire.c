@@ -0,0 +1,140 @@
+/*
+ * tripwire.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Mitchell Larson
+ */
+
+#include "tripwire.h"
+
+#define LOG_MASK (TRIP_LOG_SIZE-1)
+
+_Static_assert((TRIP_LOG_SIZE & LOG_MASK) == 0, "TRIP_LOG_SIZE must be a power of two");
+
+static TripEvent events[TRIP_LOG_SIZE];
+static volatile uint32_t log_put;		//written by the ADC ISR
+static volatile uint32_t log_get;		//written by tripwire_next
+static uint32_t dropped;
+
+static int log_event(uint8_t lane, TripState state, RTC_Stamp stamp);
+
+/**
+ * Prepares a detector. The beam is assumed clear.
+ * Inputs:
+ * 		*det - detector state
+ * 		lane - reported with every event
+ * 		*config - thresholds and dwell, copied
+ * Outputs:
+ * 		none
+ */
+void tripwire_init(TripDetector* det, uint8_t lane, const TripConfig* config){
+	det->config = *config;
+	if(det->config.dwell == 0){
+		det->config.dwell = 1;
+	}
+	det->state = TRIP_CLEAR;
+	det->run = 0;
+	det->lane = lane;
+	det->breaks = 0;
+	det->unlogged = 0;
+}
+
+/*
+ * Feeds one sample to a detector. While the level stays on the current
+ * side this is a single compare. Returns 1 when a break is confirmed.
+ */
+static inline uint32_t step(TripDetector* det, uint16_t s, uint32_t age, RTC_Stamp end){
+	int toward = det->state == TRIP_CLEAR ? s < det->config.low : s > det->config.high;
+	if(!toward){
+		det->run = 0;
+		return 0;
+	}
+	if(++det->run < det->config.dwell){
+		return 0;
+	}
+
+	//the change started dwell samples before this one
+	RTC_Stamp stamp = end - (RTC_Stamp)(age+det->config.dwell-1)*TRIP_SAMPLE_STAMP;
+	uint32_t broke = det->state == TRIP_CLEAR;
+	det->state = broke ? TRIP_BROKEN : TRIP_CLEAR;
+	det->breaks += broke;
+	det->run = 0;
+	if(log_event(det->lane, det->state, stamp) < 0){
+		det->unlogged += broke;
+	}
+	return broke;
+}
+
+/**
+ * Runs a block of interleaved samples through one detector per lane.
+ * The block is read once in memory order, each frame handing its
+ * samples to the lanes in turn, so no copy per lane is made. Runs
+ * towards a change carry over between blocks.
+ * Inputs:
+ * 		*dets - one detector per lane, in the order of the samples
+ * 		lanes - samples per frame
+ * 		*block - raw samples, oldest frame first
+ * 		frames - number of frames
+ * 		end - RTC time of the last frame in the block
+ * Outputs:
+ * 		number of breaks confirmed in this block, all lanes
+ */
+uint32_t tripwire_process(TripDetector* dets, uint32_t lanes, const uint16_t* block, uint32_t frames, RTC_Stamp end){
+	uint32_t breaks = 0;
+
+	if(lanes == 1){
+		for(uint32_t i=0;i<frames;i++){
+			breaks += step(dets, block[i], frames-1-i, end);
+		}
+		return breaks;
+	}
+
+	for(uint32_t i=0;i<frames;i++){
+		uint32_t age = frames-1-i;
+		for(uint32_t lane=0;lane<lanes;lane++){
+			breaks += step(&dets[lane], *block++, age, end);
+		}
+	}
+	return breaks;
+}
+
+/**
+ * Takes the oldest event off the log. Never blocks.
+ * Inputs:
+ * 		*event - destination
+ * Outputs:
+ * 		1 - an event was copied
+ * 		0 - the log is empty
+ */
+int tripwire_next(TripEvent* event){
+	uint32_t g = log_get;
+	if(__atomic_load_n(&log_put, __ATOMIC_ACQUIRE) == g){
+		return 0;
+	}
+	*event = events[g & LOG_MASK];
+	__atomic_store_n(&log_get, g+1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/**
+ * Returns the number of events lost because the log was full. Break
+ * counts in the detectors are kept regardless, and the breaks among
+ * the lost events are counted in TripDetector.unlogged.
+ */
+uint32_t tripwire_dropped(){
+	return dropped;
+}
+
+static int log_event(uint8_t lane, TripState state, RTC_Stamp stamp){
+	uint32_t p = log_put;
+	if(p - __atomic_load_n(&log_get, __ATOMIC_ACQUIRE) >= TRIP_LOG_SIZE){
+		dropped++;
+		return -1;
+	}
+	TripEvent* e = &events[p & LOG_MASK];
+	e->stamp = stamp;
+	e->lane = lane;
+	e->state = state;
+	__atomic_store_n(&log_put, p+1, __ATOMIC_RELEASE);
+	return 0;
+}
@@ -3,33 +3,238 @@
  *
  *  Created on: Nov 8, 2016
  *      Author: barnekow
+ *
+ * USART2 driver. Transmit data is queued in a ring and drained by DMA1
+ * stream 6, one contiguous chunk per transfer. Packet buffers can be
+ * queued as well; the DMA sends them straight from the buffer once the
+ * ring bytes written before them are out. Receive data is written
+ * by DMA1 stream 5 into a circular buffer that the reader drains by
+ * comparing its tail against NDTR, so no interrupt is taken per byte.
+ * NDTR only gives the position within the buffer, so the half and full
+ * transfer interrupts advance a free running head at least twice per
+ * lap. A reader that falls a whole buffer behind finds the head more
+ * than a buffer ahead of its tail, skips the overwritten bytes and
+ * counts them as dropped. Echo never blocks the reader, so echoed bytes
+ * that do not fit in the transmit queue are counted and dropped too.
  */
 #include "uart_driver.h"
+#include "irq.h"
+#include "mmio.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
+
+#define TX_MASK (USART2_TX_SIZE-1)
+#define RX_MASK (USART2_RX_SIZE-1)
+
+_Static_assert((USART2_TX_SIZE & TX_MASK) == 0, "USART2_TX_SIZE must be a power of two");
+_Static_assert((USART2_RX_SIZE & RX_MASK) == 0, "USART2_RX_SIZE must be a power of two");
+_Static_assert((USART2_TX_BUFS & (USART2_TX_BUFS-1)) == 0, "USART2_TX_BUFS must be a power of two");
+
+static uint8_t tx_buf[USART2_TX_SIZE];
+static volatile uint32_t tx_put;		//free running, written by thread
+static volatile uint32_t tx_get;		//free running, written by DMA ISR
+static volatile uint32_t tx_inflight;	//bytes currently owned by DMA
+
+static PacketBuf* tx_bufs[USART2_TX_BUFS];
+static uint32_t tx_marks[USART2_TX_BUFS];	//tx_put when each buffer was queued
+static volatile uint32_t buf_put;		//written by thread
+static volatile uint32_t buf_get;		//written by DMA ISR
+static PacketBuf* buf_inflight;			//buffer currently owned by DMA
+static uint32_t tx_errors;
+
+static uint8_t rx_buf[USART2_RX_SIZE];
+static volatile uint32_t rx_head;		//free running, advanced by rx_sync
+static uint32_t rx_tail;				//free running, written by thread
+static uint32_t rx_dropped;
+
+static int echo = 1;
+static uint32_t echo_dropped;
+static usart2_rx_callback rx_callback;
 
+static void tx_kick();
+static void tx_start(const uint8_t* data, uint32_t count);
+static void echo_bytes(const uint8_t* data, uint32_t len);
+static uint32_t rx_pending();
+static void rx_sync();
+
+/**
+ * Returns the next character received. Blocks until a character is
+ * available. If echo is enabled the character is echoed back. A CR is
+ * returned as LF so that fgets terminates on enter.
+ */
 char usart2_getch(){
 	char c;
-	while((*(USART_SR)&(1<<RXNE)) != (1<<RXNE));
-	c = ((char) *USART_DR);  // Read character from usart
-	usart2_putch(c);  // Echo back
+	while(usart2_read(&c,1)==0){}
 
 	if (c == '\r'){  // If character is CR
-		usart2_putch('\n');  // send it
 		c = '\n';   // Return LF. fgets is terminated by LF
 	}
 
 	return c;
 }
 
+/**
+ * Queues a single character for transmission. Only blocks if the
+ * transmit queue is full.
+ */
 void usart2_putch(char c){
-	while((*(USART_SR)&(1<<TXE)) != (1<<TXE));
-	*(USART_DR) = c;
+	while(usart2_write(&c,1)==0){}
+}
+
+/**
+ * Queues up to len bytes for transmission and starts the DMA if it is
+ * idle. Never blocks.
+ * Inputs:
+ * 		data - bytes to send
+ * 		len - number of bytes to send
+ * Outputs:
+ * 		number of bytes queued, which is less than len if the queue filled
+ */
+uint32_t usart2_write(const void* data, uint32_t len){
+	uint32_t p = tx_put;
+	uint32_t space = USART2_TX_SIZE - (p - tx_get);
+	if(len > space){
+		len = space;
+	}
+
+	uint32_t start = p & TX_MASK;
+	uint32_t first = USART2_TX_SIZE - start;
+	if(first > len){
+		first = len;
+	}
+	memcpy(&tx_buf[start], data, first);
+	memcpy(tx_buf, (const uint8_t*)data+first, len-first);
+	__atomic_store_n(&tx_put, p+len, __ATOMIC_RELEASE);
+
+	uint32_t primask = irq_save();
+	tx_kick();
+	irq_restore(primask);
+
+	return len;
+}
+
+/**
+ * Queues a packet buffer for transmission without copying it. The
+ * driver takes over the caller's reference and frees the buffer once
+ * it has been sent. Never blocks.
+ * Inputs:
+ * 		*p - data to send
+ * Outputs:
+ * 		1 - buffer queued
+ * 		0 - too many buffers queued, the buffer has been freed
+ */
+int usart2_write_buf(PacketBuf* p){
+	uint32_t b = buf_put;
+	if(b - buf_get >= USART2_TX_BUFS){
+		pbuf_free(p);
+		return 0;
+	}
+
+	tx_bufs[b & (USART2_TX_BUFS-1)] = p;
+	tx_marks[b & (USART2_TX_BUFS-1)] = tx_put;
+	__atomic_store_n(&buf_put, b+1, __ATOMIC_RELEASE);
+
+	uint32_t primask = irq_save();
+	tx_kick();
+	irq_restore(primask);
+
+	return 1;
+}
+
+/**
+ * Copies up to len received bytes into data. Never blocks.
+ * Inputs:
+ * 		data - destination for received bytes
+ * 		len - maximum number of bytes to copy
+ * Outputs:
+ * 		number of bytes copied
+ */
+uint32_t usart2_read(void* data, uint32_t len){
+	uint32_t avail = rx_pending();
+	if(len > avail){
+		len = avail;
+	}
+
+	uint32_t start = rx_tail & RX_MASK;
+	uint32_t first = USART2_RX_SIZE - start;
+	if(first > len){
+		first = len;
+	}
+	memcpy(data, &rx_buf[start], first);
+	memcpy((uint8_t*)data+first, rx_buf, len-first);
+	rx_tail += len;
+
+	if(echo && len){
+		echo_bytes(data,len);
+	}
+
+	return len;
+}
+
+/**
+ * Returns the number of received bytes waiting to be read
+ */
+uint32_t usart2_rx_available(){
+	return rx_pending();
+}
+
+/**
+ * Returns the number of received bytes overwritten before they were read
+ */
+uint32_t usart2_rx_dropped(){
+	return rx_dropped;
+}
+
+/**
+ * Returns the number of echoed bytes dropped because the transmit queue
+ * was full
+ */
+uint32_t usart2_echo_dropped(){
+	return echo_dropped;
+}
+
+/**
+ * Returns the number of transmit transfers abandoned after a DMA
+ * transfer error
+ */
+uint32_t usart2_tx_errors(){
+	return tx_errors;
+}
+
+/**
+ * Returns the number of bytes that can be queued without blocking
+ */
+uint32_t usart2_tx_space(){
+	return USART2_TX_SIZE - (tx_put - tx_get);
+}
+
+/**
+ * Blocks until every queued byte has left the shift register
+ */
+void usart2_flush(){
+	while(tx_put != tx_get || buf_put != buf_get){}
+	while((REG_READ(USART_SR)&(1<<TC)) != (1<<TC)){}
+}
+
+/**
+ * Enables or disables echoing received characters back to the sender
+ */
+void usart2_set_echo(int enable){
+	echo = enable;
+}
+
+/**
+ * Registers a function to be called from interrupt context when the
+ * line goes idle or the receive buffer is half or completely filled.
+ */
+void usart2_set_rx_callback(usart2_rx_callback callback){
+	rx_callback = callback;
 }
 
 void init_usart2(uint32_t baud, uint32_t sysclk){
-	// Enable clocks for GPIOA and USART2
-	*(RCC_AHB1ENR) |= (1<<GPIOAEN);
+	// Enable clocks for GPIOA, USART2 and DMA1
+	*(RCC_AHB1ENR) |= (1<<GPIOAEN)|(1<<DMA1EN);
 	*(RCC_APB1ENR) |= (1<<USART2EN);
 
 	// Function 7 of PORTA pins is USART
@@ -38,20 +243,187 @@ void init_usart2(uint32_t baud, uint32_t sysclk){
 	*(GPIOA_MODER) &= (0xFFFFFF0F);  // Clear mode bits for PA3 and PA2
 	*(GPIOA_MODER) |= (0b1010<<4);  // Both PA3 and PA2 in alt function mode
 
+	// RX stream: peripheral to memory, circular, channel 4
+	*(DMA1_S5CR) = 0;
+	while(*(DMA1_S5CR) & (1<<DMA_EN)){}
+	*(DMA1_HIFCR) = DMA_S5_FLAGS;
+	*(DMA1_S5PAR) = (uint32_t)(uintptr_t)USART_DR;
+	*(DMA1_S5M0AR) = (uint32_t)(uintptr_t)rx_buf;
+	*(DMA1_S5NDTR) = USART2_RX_SIZE;
+	*(DMA1_S5CR) = (4<<DMA_CHSEL)|(1<<DMA_MINC)|(1<<DMA_CIRC)|(1<<DMA_HTIE)|(1<<DMA_TCIE);
+	*(DMA1_S5CR) |= (1<<DMA_EN);
+	rx_head = rx_tail = 0;
+	rx_dropped = 0;
+
+	// TX stream: memory to peripheral, channel 4, started by tx_kick
+	*(DMA1_S6CR) = 0;
+	while(*(DMA1_S6CR) & (1<<DMA_EN)){}
+	*(DMA1_HIFCR) = DMA_S6_FLAGS;
+	*(DMA1_S6PAR) = (uint32_t)(uintptr_t)USART_DR;
+	tx_put = tx_get = tx_inflight = 0;
+	buf_put = buf_get = 0;
+	buf_inflight = NULL;
+	tx_errors = 0;
+	echo_dropped = 0;
+
 	// Set up USART2
-	//USART2_init();  //8n1 no flow control
 	// over8 = 0..oversample by 16
 	// M = 0..1 start bit, data size is 8, 1 stop bit
 	// PCE= 0..Parity check not enabled
-	// no interrupts... using polling
-	*(USART_CR1) = (1<<UE)|(1<<TE)|(1<<RE); // Enable UART, Tx and Rx
+	// data moved by DMA, idle line interrupt signals end of a burst
 	*(USART_CR2) = 0;  // This is the default, but do it anyway
-	*(USART_CR3) = 0;  // This is the default, but do it anyway
+	*(USART_CR3) = (1<<DMAT)|(1<<DMAR);
 	*(USART_BRR) = sysclk/baud;
+	*(USART_CR1) = (1<<UE)|(1<<TE)|(1<<RE)|(1<<IDLEIE); // Enable UART, Tx and Rx
+
+	// DMA1 stream 5/6 are IRQ 16/17, USART2 is IRQ 38
+	*(NVIC_ISER0) = (1<<16)|(1<<17);
+	*(NVIC_ISER1) = (1<<(38-32));
+
+	// stdout is already buffered by the driver
+	setvbuf(stdout, NULL, _IONBF, 0);
+}
 
-	/* I'm not sure if this is needed for standard IO*/
-	 //setvbuf(stderr, NULL, _IONBF, 0);
-	 //setvbuf(stdin, NULL, _IONBF, 0);
-	 setvbuf(stdout, NULL, _IONBF, 0);
+/**
+ * Starts a DMA transfer of the next contiguous chunk of the transmit
+ * queue, or of the next packet buffer once the ring has caught up with
+ * it, if the stream is idle. Must be called with interrupts masked or
+ * from the DMA ISR.
+ */
+static void tx_kick(){
+	if(tx_inflight != 0 || buf_inflight != NULL){
+		return;
+	}
+
+	uint32_t g = tx_get;
+	uint32_t end = __atomic_load_n(&tx_put, __ATOMIC_ACQUIRE);
+	uint32_t b = buf_get;
+	if(__atomic_load_n(&buf_put, __ATOMIC_ACQUIRE) != b){
+		end = tx_marks[b & (USART2_TX_BUFS-1)];
+		if(end == g){
+			PacketBuf* p = tx_bufs[b & (USART2_TX_BUFS-1)];
+			if(p->length == 0){
+				pbuf_free(p);
+				__atomic_store_n(&buf_get, b+1, __ATOMIC_RELEASE);
+				tx_kick();
+				return;
+			}
+			buf_inflight = p;
+			tx_start(pbuf_data(p), p->length);
+			return;
+		}
+	}
+
+	uint32_t count = end - g;
+	if(count == 0){
+		return;
+	}
+
+	uint32_t start = g & TX_MASK;
+	if(count > USART2_TX_SIZE - start){
+		count = USART2_TX_SIZE - start;	//stop at the wrap, rest goes next
+	}
+
+	tx_inflight = count;
+	tx_start(&tx_buf[start], count);
+}
+
+/**
+ * Points DMA1 stream 6 at a block of memory and starts it
+ */
+static void tx_start(const uint8_t* data, uint32_t count){
+	*(DMA1_HIFCR) = DMA_S6_FLAGS;
+	*(DMA1_S6M0AR) = (uint32_t)(uintptr_t)data;
+	*(DMA1_S6NDTR) = count;
+	*(DMA1_S6CR) = (4<<DMA_CHSEL)|(1<<DMA_MINC)|(0b01<<DMA_DIR)|(1<<DMA_TCIE)|(1<<DMA_TEIE)|(1<<DMA_EN);
 }
 
+/**
+ * Brings the head up to date and drops whatever the DMA has overwritten
+ * since the reader last caught up. Only the thread moves the tail.
+ * Outputs:
+ * 		number of bytes waiting, at most USART2_RX_SIZE
+ */
+static uint32_t rx_pending(){
+	uint32_t primask = irq_save();
+	rx_sync();
+	uint32_t avail = rx_head - rx_tail;
+	irq_restore(primask);
+
+	if(avail > USART2_RX_SIZE){
+		rx_dropped += avail - USART2_RX_SIZE;
+		rx_tail += avail - USART2_RX_SIZE;
+		avail = USART2_RX_SIZE;
+	}
+	return avail;
+}
+
+/**
+ * Advances the free running head to the DMA write position. The DMA
+ * must not have gone a whole lap since the last call, which the half
+ * and full transfer interrupts ensure. Must be called with interrupts
+ * masked or from an ISR.
+ */
+static void rx_sync(){
+	uint32_t pos = (USART2_RX_SIZE - *(DMA1_S5NDTR)) & RX_MASK;
+	uint32_t head = rx_head;
+	rx_head = head + ((pos - head) & RX_MASK);
+}
+
+/**
+ * Queues received characters to be echoed. CR is echoed as CR LF. Bytes
+ * that do not fit, including the LF of a CR LF cut short, are dropped
+ * and counted.
+ */
+static void echo_bytes(const uint8_t* data, uint32_t len){
+	for(uint32_t i=0;i<len;i++){
+		if(data[i] == '\r'){
+			echo_dropped += 2 - usart2_write("\r\n",2);
+		}else{
+			echo_dropped += 1 - usart2_write(&data[i],1);
+		}
+	}
+}
+
+void DMA1_Stream5_IRQHandler(void){
+	*(DMA1_HIFCR) = DMA_S5_HTIF | DMA_S5_TCIF;
+	rx_sync();
+	if(rx_callback){
+		rx_callback();
+	}
+}
+
+/*
+ * A transfer error disables the stream part way through. The transfer
+ * is counted and abandoned like a finished one so that the queue keeps
+ * moving; retrying a bad address would fail the same way.
+ */
+void DMA1_Stream6_IRQHandler(void){
+	uint32_t flags = *(DMA1_HISR);
+	*(DMA1_HIFCR) = DMA_S6_FLAGS;
+
+	if(flags & DMA_S6_TEIF){
+		tx_errors++;
+	}
+	if(flags & (DMA_S6_TCIF|DMA_S6_TEIF)){
+		if(buf_inflight != NULL){
+			pbuf_free(buf_inflight);
+			buf_inflight = NULL;
+			__atomic_store_n(&buf_get, buf_get+1, __ATOMIC_RELEASE);
+		}else{
+			__atomic_store_n(&tx_get, tx_get + tx_inflight, __ATOMIC_RELEASE);
+			tx_inflight = 0;
+		}
+		tx_kick();
+	}
+}
+
+void USART2_IRQHandler(void){
+	if(REG_READ(USART_SR) & (1<<IDLE)){
+		(void)REG_READ(USART_DR);	//SR then DR read clears IDLE
+		rx_sync();
+		if(rx_callback){
+			rx_callback();
+		}
+	}
+}